@@ -21,6 +21,12 @@ float iso = 1600.f;
 layout(location = 0) in vec2 fragUV;
 layout(set = 0, binding = 0) uniform sampler2D litSampler;
 
+// DebugOutput in DeferredRenderSystem.h, one pipeline per value. 0 shows the lit image, the others the G-buffer target bound
+layout(constant_id = 0) const uint DEBUG_OUTPUT = 0u;
+const uint DEBUG_OUTPUT_METAL_ROUGH = 4u;
+const uint DEBUG_OUTPUT_OCCLUSION = 5u;
+const uint DEBUG_OUTPUT_DEPTH = 6u;
+
 layout(location = 0) out vec4 outColor;
 
 void main() {
@@ -34,5 +40,15 @@ void main() {
     vec3 mapped     = Uncharted2ToneMapping(litColor * exposure);
     mapped          = pow(mapped, vec3(1.0 / GAMMA)); 
 
+    // single channel targets as grey, metallic / roughness in red / green
+    if (DEBUG_OUTPUT == DEBUG_OUTPUT_OCCLUSION || DEBUG_OUTPUT == DEBUG_OUTPUT_DEPTH)
+    {
+        litColor = litColor.rrr;
+    }
+    else if (DEBUG_OUTPUT == DEBUG_OUTPUT_METAL_ROUGH)
+    {
+        litColor = vec3(litColor.rg, 0.0);
+    }
+
     outColor = vec4(litColor, 1.0);
 }
\ No newline at end of file
@@ -1,24 +1,18 @@
 //DepthPrepass.frag
 #version 450
 #extension GL_EXT_nonuniform_qualifier : require
+#extension GL_GOOGLE_include_directive : enable
+#include "MaterialTable.glsl"
 
-layout(set = 0, binding = 0) uniform sampler2D bindlessTextures[];
 layout(location = 0) in vec2 vUV;
 
 layout(push_constant) uniform PC {
     mat4 mvp;
-    uint  albedoIndex;
+    uint  materialIndex;
 } pc;
 
-const float alphaThreshold = 0.95;
-
 void main() {
-    uint mi = pc.albedoIndex;
-    if (mi != 0xFFFFFFFFu) {
-        float alpha = texture(bindlessTextures[ nonuniformEXT(mi) ], vUV).a;
-        if (alpha < alphaThreshold) {
-            discard;
-        }
+    if (MaterialBaseColor(materials[pc.materialIndex], vUV).a < alphaThreshold) {
+        discard;
     }
-    
 }
@@ -3,15 +3,19 @@
 
 layout(push_constant) uniform PC {
     mat4 mvp;       // projection * view * model
-    uint  maskIndex;
+    uint  materialIndex;
 } pc;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 3) in vec2 inUV;             // we just need UV for mask test
+// the compact vertex layout keeps position as floats and stores UVs as half floats,
+// the vertex fetch widens those to vec2 so this shader serves both layouts unchanged
+
+layout(location = 6) in mat4 inInstance;     // node transform, same binding as GeometryPass.vert
 
 layout(location = 0) out vec2 vUV;
 
 void main() {
-    gl_Position = pc.mvp * vec4(inPosition, 1.0);
+    gl_Position = pc.mvp * (inInstance * vec4(inPosition, 1.0));
     vUV         = inUV;
 }
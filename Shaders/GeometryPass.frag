@@ -1,5 +1,7 @@
 #version 450
 #extension GL_EXT_nonuniform_qualifier : require
+#extension GL_GOOGLE_include_directive : enable
+#include "MaterialTable.glsl"
 
 layout(early_fragment_tests) in;
 
@@ -17,48 +19,45 @@ layout(location = 2) out vec4 outAlbedoMap;
 layout(location = 3) out vec4 outMetalRoughnessMap;
 layout(location = 4) out vec4 outOcclusionMap;
 
-layout(set = 0, binding = 0) uniform sampler2D bindlessTextures[];
-
 layout(push_constant) uniform PC {
     mat4 transform;
     mat4 modelMatrix;
-    uint albedoIndex; 
-    uint normalIndex;
-    uint metalRoughIndex;
-    uint occlusionIndex;
+    uint materialIndex;
 } pc;
 
-const float alphaThreshold = 0.95;
-
 void main() {
- vec4 base = vec4(fragColor, 1.0);
-    if (pc.albedoIndex != 0xFFFFFFFFu) {
-        base *= texture(bindlessTextures[ nonuniformEXT(pc.albedoIndex) ], fragUV);
-    }
+    Material mat = materials[pc.materialIndex];
+
+    // same alpha test as DepthPrepass.frag; the vertex color carries no alpha
+    vec4 base = MaterialBaseColor(mat, fragUV);
     if (base.a < alphaThreshold) {
         discard;
     }
-    vec3 albedo = base.rgb;
+    vec3 albedo = fragColor * base.rgb;
 
-    vec2 mr = vec2(0.0, 1.0);
-    if (pc.metalRoughIndex != 0xFFFFFFFFu) {
-        mr = texture(bindlessTextures[ nonuniformEXT(pc.metalRoughIndex) ], fragUV).bg;
+    // glTF: the factors scale the texture, or are the value itself without one
+    vec2 mr = vec2(mat.metallicFactor, mat.roughnessFactor);
+    if (mat.metalRoughIndex != NO_TEXTURE) {
+        mr *= texture(bindlessTextures[ nonuniformEXT(mat.metalRoughIndex) ], fragUV).bg;
         }
 
     float occ = 1.0;
-    if (pc.occlusionIndex != 0xFFFFFFFFu) {
-        occ = texture(bindlessTextures[ nonuniformEXT(pc.occlusionIndex) ], fragUV).r;
+    if (mat.occlusionIndex != NO_TEXTURE) {
+        float sampledOcc = texture(bindlessTextures[ nonuniformEXT(mat.occlusionIndex) ], fragUV).r;
+        occ = 1.0 + mat.occlusionStrength * (sampledOcc - 1.0);
     }
 
     vec3 normal = vec3(0.0); 
-    if(pc.normalIndex != 0xFFFFFFFFu) {
+    if(mat.normalIndex != NO_TEXTURE) {
         mat3 TBN = mat3(
         normalize(fragTangent),
         normalize(fragBiTangent),
         normalize(fragNormal)
         );
 
-        vec3 sampledNormal = texture(bindlessTextures[nonuniformEXT(pc.normalIndex)], fragUV).rgb * 2.0 - 1.0;        
+        // z is rebuilt from xy so BC5 (two channel) normal maps work too
+        vec2 sampledXY = texture(bindlessTextures[nonuniformEXT(mat.normalIndex)], fragUV).rg * 2.0 - 1.0;
+        vec3 sampledNormal = vec3(sampledXY, sqrt(max(1.0 - dot(sampledXY, sampledXY), 0.0)));
         normal = normalize(TBN * sampledNormal); 
      }
  
@@ -5,18 +5,35 @@
 layout(push_constant) uniform PC {
     mat4 transform;
     mat4 modelMatrix;
-    uint albedoIndex;
-    uint normalIndex;
-    uint metalRoughIndex;
-    uint occlusionIndex;
+    uint materialIndex;
 } pc;
 
+// compiled twice, GeometryPassCompact.vert.spv is built with -DCOMPACT_VERTICES for Model::CompactVertex
+#ifdef COMPACT_VERTICES
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec4 inColor;      // separate stream, stride 0 white when the model has no colors
+layout(location = 2) in vec2 inNormal;     // octahedral
+layout(location = 3) in vec2 inUV;         // half floats, widened by the fetch
+layout(location = 4) in vec4 inTangent;    // xy octahedral, z bitangent sign
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+#else
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec2 inUV;
 layout(location = 4) in vec3 inTangent;
 layout(location = 5) in vec3 inBiTangent;
+#endif
+
+// node transform of the instance (Model::INSTANCE_BINDING), identity for flattened imports
+layout(location = 6) in mat4 inInstance;
 
 layout(location = 0) out vec3 fragPos;
 layout(location = 1) out vec3 fragNorm;
@@ -27,16 +44,30 @@ layout(location = 5) out vec3 fragBiTangent;
 
 void main() {
 
+#ifdef COMPACT_VERTICES
+    vec3 normal    = OctDecode(inNormal);
+    vec3 tangent   = OctDecode(inTangent.xy);
+    vec3 biTangent = cross(normal, tangent) * (inTangent.z < 0.0 ? -1.0 : 1.0);
+    vec3 color     = inColor.rgb;
+#else
+    vec3 normal    = inNormal;
+    vec3 tangent   = inTangent;
+    vec3 biTangent = inBiTangent;
+    vec3 color     = inColor;
+#endif
+
     // clip-space
-    gl_Position = pc.transform * vec4(inPosition, 1.0);
+    vec4 position = inInstance * vec4(inPosition, 1.0);
+    gl_Position = pc.transform * position;
 
     // world-space position & normal
-    fragPos   = (pc.modelMatrix * vec4(inPosition, 1.0)).xyz;
-    mat3 normalMatrix = transpose(inverse(mat3(pc.modelMatrix)));
-    fragNorm  = normalize((normalMatrix * inNormal));
-    fragTangent   = normalize((pc.modelMatrix * vec4(inTangent,   0.0)).xyz);
-    fragBiTangent = normalize((pc.modelMatrix * vec4(inBiTangent, 0.0)).xyz);
-    fragColor = inColor;
+    mat4 modelMatrix = pc.modelMatrix * inInstance;
+    fragPos   = (pc.modelMatrix * position).xyz;
+    mat3 normalMatrix = transpose(inverse(mat3(modelMatrix)));
+    fragNorm  = normalize((normalMatrix * normal));
+    fragTangent   = normalize((modelMatrix * vec4(tangent,   0.0)).xyz);
+    fragBiTangent = normalize((modelMatrix * vec4(biTangent, 0.0)).xyz);
+    fragColor = color;
     fragUV    = inUV;
 
 }
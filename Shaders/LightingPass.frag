@@ -47,6 +47,13 @@ const float MIN_ROUGHNESS = 0.045;
 const uint LIGHT_TYPE_POINT = 0;
 const uint LIGHT_TYPE_DIRECTIONAL = 1;
 
+// LightingVariant in DeferredRenderSystem.h: bit 0 = point lights, bit 1 = directional lights, 0 = image based lighting only.
+// With a single light type the per light branch folds away, without lights the loop does
+layout(constant_id = 0) const uint LIGHT_TYPES = 3u;
+const bool HAS_POINT_LIGHTS = (LIGHT_TYPES & 1u) != 0u;
+const bool HAS_DIRECTIONAL_LIGHTS = (LIGHT_TYPES & 2u) != 0u;
+const bool SINGLE_LIGHT_TYPE = LIGHT_TYPES == 1u || LIGHT_TYPES == 2u;
+
 
 
 void main() {
@@ -75,11 +82,11 @@ void main() {
     vec3 litColor = vec3(0.0); 
 
 
-    for(int i = 0; i < pc.lightCount; ++i)
+    for(int i = 0; LIGHT_TYPES != 0u && i < pc.lightCount; ++i)
     {
         Light light = LightsData.lights[i]; 
 
-        if(light.type == LIGHT_TYPE_POINT)
+        if(HAS_POINT_LIGHTS && (SINGLE_LIGHT_TYPE || light.type == LIGHT_TYPE_POINT))
         {
             vec3 L = light.position - worldPosSample; 
             float distance = length(L); 
@@ -89,7 +96,7 @@ void main() {
                 litColor += CalculatePBR_Point(albedoSample, normalSample, metallic, roughness, worldPosSample, light.position, light.lightColor, light.lightIntensity * attenuation, pc.cameraPos);
             }
         }
-        else if(light.type == LIGHT_TYPE_DIRECTIONAL)
+        else if(HAS_DIRECTIONAL_LIGHTS && (SINGLE_LIGHT_TYPE || light.type == LIGHT_TYPE_DIRECTIONAL))
         {
             litColor += CalculatePBR_Directional(albedoSample, normalSample, metallic, roughness, worldPosSample, light.direction, light.lightColor, light.lightIntensity, pc.cameraPos);   
         }
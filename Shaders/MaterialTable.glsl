@@ -0,0 +1,35 @@
+//MATERIAL TABLE------------------------------------------
+// one row per loaded material, mirrors MaterialTable::GpuMaterial (std430, 48 bytes)
+struct Material
+{
+    vec4  baseColorFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    float occlusionStrength;
+    uint  baseColorIndex;      // bindless texture slots, 0xFFFFFFFF = no texture
+    uint  metalRoughIndex;
+    uint  normalIndex;
+    uint  occlusionIndex;
+    uint  _pad0;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer MaterialBuffer {
+    Material materials[];
+};
+
+const uint NO_TEXTURE = 0xFFFFFFFFu;
+
+layout(set = 0, binding = 0) uniform sampler2D bindlessTextures[];
+
+// alpha mask cutoff; the depth prepass and the geometry pass must agree on coverage
+// exactly, so both take base color and alpha from MaterialBaseColor
+const float alphaThreshold = 0.95;
+
+vec4 MaterialBaseColor(Material mat, vec2 uv)
+{
+    vec4 base = mat.baseColorFactor;
+    if (mat.baseColorIndex != NO_TEXTURE) {
+        base *= texture(bindlessTextures[ nonuniformEXT(mat.baseColorIndex) ], uv);
+    }
+    return base;
+}
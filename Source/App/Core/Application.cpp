@@ -2,6 +2,10 @@
 #include "Camera.h"
 #include "UserInput.h"
 #include "HDRImage.h" 
+#include "AssetPackage.h"
+#include "TextureRegistry.h"
+#include "MaterialTable.h"
+#include "GeometryArena.h"
 
 //libs
 #define GLM_FORCE_RADIANS
@@ -11,24 +15,56 @@
 
 //std
 #include <stdexcept>
+#include <algorithm>
 #include <array>
 #include <iostream>
 #include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <thread>
 
 namespace cve {
 
+bool Application::s_StreamAssets = true;
+std::string Application::s_FrameTracePath;
 
-Application::Application()
+Application::Application(std::string scenePath)
+    :m_ScenePath{std::move(scenePath)}
 {
+    //the cooked KTX2 textures are BC, fall back to the source images when the device cannot sample those
+    if (!m_Device.textureCompressionBC) TextureDecoder::s_UseCompressedTextures = false;
+    //before anything is uploaded or a pipeline layout references the bindless set or the material table
+    TextureRegistry::Init(m_Device);
+    MaterialTable::Init(m_Device);
+    GeometryArena::Init(m_Device);
+    //streaming backs off while the device memory is over budget, see UploadStreamedAssets
+    m_Device.onMemoryBudgetChange([this](bool overBudget)
+        {
+            m_OverMemoryBudget = overBudget;
+            std::cout << "\n[Memory] " << (overBudget ? "over budget, streaming paused" : "back under budget, streaming resumed") << std::endl;
+        });
 	LoadGameObjects(); 
 }
 Application::~Application()
 {
+    //the models release their texture slots, material rows and geometry ranges, then the tables go with this device
+    m_Device.waitForUploads();
+    vkDeviceWaitIdle(m_Device.device());
+    m_UploadingGameObjects.clear();
+    m_UploadingHDRImage.reset();
+    m_GameObjects.clear();
+    GeometryArena::Cleanup(m_Device);
+    MaterialTable::Cleanup(m_Device);
+    TextureRegistry::Cleanup(m_Device);
 }
-void Application::run()
+void Application::run(uint32_t maxFrames)
 {
     VkExtent2D currentExtent = m_Window.GetExtent();
-    DeferredRenderSystem deferredRenderSystem = { m_Device, currentExtent, m_Renderer.GetSwapChainImageFormat(),m_HDRImage,  m_Lights };
+    //created once the environment and the first model are uploaded, it takes over once its pipelines are built
+    std::unique_ptr<DeferredRenderSystem> deferredRenderSystem;
+    std::unique_ptr<DeferredRenderSystem> pendingRenderSystem;
 	Camera camera{};
     camera.SetViewTarget(glm::vec3(-1.f, -2.f, 2.f), glm::vec3(0.f, 0.f, 2.5f)); 
 
@@ -38,33 +74,104 @@ void Application::run()
     auto currentTime = std::chrono::high_resolution_clock::now(); 
      
     float fpsTimer = 0.0f;
+    float memoryLogTimer = 0.0f;
     int   frameCount = 0;
     bool  debugKeyPressed = false;
+    bool  cullingKeyPressed = false;
+    bool  lodKeyPressed = false;
+
+    //frames before this one are warm up and not part of the average, only frames that show the scene count
+    const uint32_t benchmarkStartFrame = maxFrames / 10;
+    uint32_t renderedFrames = 0;
+    uint64_t benchmarkTriangles = 0;
+    uint64_t benchmarkGeometryBinds = 0;
+    uint64_t benchmarkModelSwitches = 0;
+    double benchmarkGeometryMs = 0.0;
+    double benchmarkLightingMs = 0.0;
+    auto benchmarkStart = currentTime;
+    bool firstFrameReported = false;
+
+    //one entry per scene frame when s_FrameTracePath is set
+    struct FrameTrace
+    {
+        float        frameMs;
+        float        geometryMs;
+        uint32_t     uploadsInFlight;
+        VkDeviceSize stagedBytes;
+    };
+    std::vector<FrameTrace> frameTrace;
+    VkDeviceSize stagedBytes = m_Device.stagingRing().getStats().allocatedBytes;
 
      
     //main loop
-	while (!m_Window.ShouldClose())
+	while (!m_Window.ShouldClose() && (maxFrames == 0 || renderedFrames < maxFrames))
 	{
         //TODO: to make the resizing smoother find a way to continue to draw frames while resizing,this is probably blocked now.
         // Use the "window refresh callback" to redraw the contents of your window when necessary during resizing
         //glfwSetWindowRefreshCallback() ?
 
         glfwPollEvents();
+        UploadStreamedAssets();
+        m_Device.collectUploads();
+        m_Device.updateMemoryBudget();
+        AddFinishedUploads();
+        const uint32_t uploadsInFlight = m_Device.getUploadsInFlight();
+        if (!deferredRenderSystem && !pendingRenderSystem && m_HDRImage && !m_GameObjects.empty())
+        {
+            pendingRenderSystem = std::make_unique<DeferredRenderSystem>(m_Device, m_PipelineBuilder, currentExtent, m_Renderer.GetSwapChainImageFormat(), m_HDRImage, m_Lights);
+        }
+        //the loading screen stays up while the pipelines build
+        if (pendingRenderSystem && pendingRenderSystem->ArePipelinesReady())
+        {
+            deferredRenderSystem = std::move(pendingRenderSystem);
+            deferredRenderSystem->SetLodBias(m_LodBias);
+            m_Device.memoryAllocator().printStats(std::cout);
+            m_Device.printMemoryBudget(std::cout);
+        }
+
         VkExtent2D newExtent = m_Window.GetExtent();
-        if (glfwGetKey(m_Window.GetGLFWwindow(), GLFW_KEY_F4) == GLFW_PRESS) {
-            if (!debugKeyPressed) {
-                deferredRenderSystem.CycleDebugOutput();
-                debugKeyPressed = true;
+        if (deferredRenderSystem)
+        {
+            if (glfwGetKey(m_Window.GetGLFWwindow(), GLFW_KEY_F4) == GLFW_PRESS) {
+                if (!debugKeyPressed) {
+                    deferredRenderSystem->CycleDebugOutput();
+                    debugKeyPressed = true;
+                }
+            }
+            else if (glfwGetKey(m_Window.GetGLFWwindow(), GLFW_KEY_F4) == GLFW_RELEASE) {
+                debugKeyPressed = false;
+            }
+            if (glfwGetKey(m_Window.GetGLFWwindow(), GLFW_KEY_F5) == GLFW_PRESS) {
+                if (!cullingKeyPressed) {
+                    deferredRenderSystem->ToggleMeshletCulling();
+                    cullingKeyPressed = true;
+                }
+            }
+            else if (glfwGetKey(m_Window.GetGLFWwindow(), GLFW_KEY_F5) == GLFW_RELEASE) {
+                cullingKeyPressed = false;
+            }
+            //F6 halves the LOD bias (finer), F7 doubles it (coarser), going below 1/8 switches LODs off
+            const bool lodFiner = glfwGetKey(m_Window.GetGLFWwindow(), GLFW_KEY_F6) == GLFW_PRESS;
+            const bool lodCoarser = glfwGetKey(m_Window.GetGLFWwindow(), GLFW_KEY_F7) == GLFW_PRESS;
+            if (lodFiner || lodCoarser) {
+                if (!lodKeyPressed) {
+                    float bias = deferredRenderSystem->GetLodBias();
+                    if (lodCoarser) bias = bias == 0.0f ? 0.125f : bias * 2.0f;
+                    else bias = bias <= 0.125f ? 0.0f : bias * 0.5f;
+                    deferredRenderSystem->SetLodBias(bias);
+                    lodKeyPressed = true;
+                }
+            }
+            else {
+                lodKeyPressed = false;
             }
-        }
-        else if (glfwGetKey(m_Window.GetGLFWwindow(), GLFW_KEY_F4) == GLFW_RELEASE) {
-            debugKeyPressed = false;
         }
 
 
 
         if (newExtent.width != currentExtent.width || newExtent.height != currentExtent.height) {
-            deferredRenderSystem.RecreateGBuffer(newExtent, m_Renderer.GetSwapChainImageFormat());
+            if (deferredRenderSystem) deferredRenderSystem->RecreateGBuffer(newExtent, m_Renderer.GetSwapChainImageFormat());
+            if (pendingRenderSystem) pendingRenderSystem->RecreateGBuffer(newExtent, m_Renderer.GetSwapChainImageFormat());
             currentExtent = newExtent;
         }
 
@@ -81,42 +188,113 @@ void Application::run()
 
 		if (auto commandBuffer = m_Renderer.BeginFrame())
 		{
+            if (!deferredRenderSystem)
+            {
+                //still streaming: clear and present so the window shows up and stays responsive
+                m_Renderer.BeginRenderingBlittingPass(commandBuffer, true);
+                m_Renderer.EndRenderingBlittingPass(commandBuffer);
+                m_Renderer.EndFrame();
+                ReportStartupTime(m_FirstFrameMs, "first frame");
+                continue;
+            }
+
+            deferredRenderSystem->CullMeshlets(m_GameObjects, camera, m_Renderer.GetSwapChainExtent());
+
             //depth prepass
 
-            m_Renderer.BeginRenderingDepthPrepass(commandBuffer, deferredRenderSystem.GetGBuffer());
-            deferredRenderSystem.RenderDepthPrepass(commandBuffer, m_GameObjects, camera);
+            m_Renderer.BeginRenderingDepthPrepass(commandBuffer, deferredRenderSystem->GetGBuffer());
+            deferredRenderSystem->RenderDepthPrepass(commandBuffer, m_GameObjects, camera);
             m_Renderer.EndRenderingDepthPrepass(commandBuffer);
 
-			m_Renderer.BeginRenderingGeometry(commandBuffer,deferredRenderSystem.GetGBuffer() ); 
-			deferredRenderSystem.RenderGeometry(commandBuffer,m_GameObjects, camera); 
-            deferredRenderSystem.UpdateGeometry(m_GameObjects, elapsedSec); 
-			m_Renderer.EndRenderingGeometry(commandBuffer, deferredRenderSystem.GetGBuffer());
+            deferredRenderSystem->BeginGeometryTimer(commandBuffer, m_Renderer.GetFrameIndex());
+			m_Renderer.BeginRenderingGeometry(commandBuffer,deferredRenderSystem->GetGBuffer(), deferredRenderSystem->GetDebugOutput() != DebugOutput::Lighting); 
+			deferredRenderSystem->RenderGeometry(commandBuffer,m_GameObjects, camera); 
+            deferredRenderSystem->UpdateGeometry(m_GameObjects, elapsedSec); 
+			m_Renderer.EndRenderingGeometry(commandBuffer, deferredRenderSystem->GetGBuffer());
+            deferredRenderSystem->EndGeometryTimer(commandBuffer, m_Renderer.GetFrameIndex());
 
 
-            m_Renderer.BeginRenderingLighting(commandBuffer, deferredRenderSystem.GetLightBuffer());
-            deferredRenderSystem.RenderLighting(commandBuffer, camera, m_Renderer.GetSwapChainExtent());
-            m_Renderer.EndRenderingLighting(commandBuffer, deferredRenderSystem.GetLightBuffer());
+            deferredRenderSystem->BeginLightingTimer(commandBuffer, m_Renderer.GetFrameIndex());
+            m_Renderer.BeginRenderingLighting(commandBuffer, deferredRenderSystem->GetLightBuffer());
+            deferredRenderSystem->RenderLighting(commandBuffer, camera, m_Renderer.GetSwapChainExtent());
+            m_Renderer.EndRenderingLighting(commandBuffer, deferredRenderSystem->GetLightBuffer());
+            deferredRenderSystem->EndLightingTimer(commandBuffer, m_Renderer.GetFrameIndex());
 
             m_Renderer.BeginRenderingBlittingPass(commandBuffer);
-            deferredRenderSystem.RenderBlit(commandBuffer);
+            deferredRenderSystem->RenderBlit(commandBuffer);
             m_Renderer.EndRenderingBlittingPass(commandBuffer); 
 
 
 			m_Renderer.EndFrame(); 
+
+            if (!firstFrameReported)
+            {
+                ReportStartupTime(m_FirstFrameMs, "first frame");
+                ReportStartupTime(m_FirstSceneFrameMs, "first scene frame");
+                m_Device.printPipelineCacheStats(std::cout);
+                m_PipelineBuilder.GetRegistry().PrintStats(std::cout);
+                firstFrameReported = true;
+                if (!m_StreamedScenePath.empty()) StreamModel(m_StreamedScenePath);
+            }
+            else if (!s_FrameTracePath.empty())
+            {
+                //the first scene frame includes the render system setup
+                const VkDeviceSize staged = m_Device.stagingRing().getStats().allocatedBytes;
+                frameTrace.push_back({ elapsedSec * 1000.0f, deferredRenderSystem->GetGeometryPassMs(), uploadsInFlight, staged - stagedBytes });
+                stagedBytes = staged;
+            }
+
+            if (++renderedFrames == benchmarkStartFrame)
+            {
+                benchmarkStart = std::chrono::high_resolution_clock::now();
+            }
+            else if (renderedFrames > benchmarkStartFrame)
+            {
+                const auto& culling = deferredRenderSystem->GetCullingStats();
+                benchmarkTriangles += culling.trianglesDrawn;
+                benchmarkGeometryBinds += culling.geometryBinds;
+                benchmarkModelSwitches += culling.modelSwitches;
+                benchmarkGeometryMs += deferredRenderSystem->GetGeometryPassMs();
+                benchmarkLightingMs += deferredRenderSystem->GetLightingPassMs();
+            }
 		}
 
 
         //fps
         ++frameCount;
         fpsTimer += elapsedSec;
-		if (fpsTimer >= 1.0f) {
+        memoryLogTimer += elapsedSec;
+		if (fpsTimer >= 1.0f && deferredRenderSystem) {
             float fps = frameCount / fpsTimer;
+            const auto& culling = deferredRenderSystem->GetCullingStats();
+            VkDeviceSize vramUsage = 0;
+            VkDeviceSize vramBudget = 0;
+            for (const auto& heap : m_Device.getMemoryBudget().heaps)
+            {
+                if (!heap.deviceLocal) continue;
+                vramUsage += heap.usage;
+                vramBudget += heap.budget;
+            }
             std::cout
                 << "\rFPS: "
                 << std::fixed << std::setprecision(1)
                 << fps
+                << "   clusters drawn/tested: " << culling.clustersDrawn << "/" << culling.clustersTested
+                << "   draws: " << culling.drawCalls
+                << "   binds: " << culling.geometryBinds
+                << "   triangles: " << culling.trianglesDrawn
+                << "   LOD bias: " << std::setprecision(3) << deferredRenderSystem->GetLodBias()
+                << "   lighting: " << std::setprecision(2) << deferredRenderSystem->GetLightingPassMs() << " ms ("
+                << DeferredRenderSystem::GetLightingVariantName(deferredRenderSystem->GetLightingVariant()) << ")"
+                << "   VRAM: " << vramUsage / (1024 * 1024) << "/" << vramBudget / (1024 * 1024) << " MB"
                 << "   "         
                 << std::flush;
+            if (memoryLogTimer >= MEMORY_LOG_INTERVAL_SEC)
+            {
+                std::cout << "\n";
+                m_Device.printMemoryBudget(std::cout);
+                memoryLogTimer = 0.0f;
+            }
 
             fpsTimer -= 1.0f;
             frameCount = 0;
@@ -124,19 +302,602 @@ void Application::run()
 	}
 
 	vkDeviceWaitIdle(m_Device.device());
+
+    if (maxFrames > 0 && renderedFrames > benchmarkStartFrame)
+    {
+        auto totalMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - benchmarkStart).count();
+        m_AverageFrameMs = totalMs / static_cast<float>(renderedFrames - benchmarkStartFrame);
+        m_AverageTriangles = benchmarkTriangles / (renderedFrames - benchmarkStartFrame);
+        m_AverageGeometryBinds = static_cast<float>(benchmarkGeometryBinds) / static_cast<float>(renderedFrames - benchmarkStartFrame);
+        m_AverageModelSwitches = static_cast<float>(benchmarkModelSwitches) / static_cast<float>(renderedFrames - benchmarkStartFrame);
+        m_AverageGeometryMs = static_cast<float>(benchmarkGeometryMs / (renderedFrames - benchmarkStartFrame));
+        m_AverageLightingMs = static_cast<float>(benchmarkLightingMs / (renderedFrames - benchmarkStartFrame));
+    }
+
+    if (!s_FrameTracePath.empty())
+    {
+        std::ofstream file{ s_FrameTracePath };
+        file << "frame,frame_ms,geometry_gpu_ms,uploads_in_flight,staged_kb\n";
+        double idleMs = 0.0;
+        double uploadMs = 0.0;
+        uint32_t idleFrames = 0;
+        for (size_t i = 0; i < frameTrace.size(); ++i)
+        {
+            const auto& frame = frameTrace[i];
+            file << i << "," << frame.frameMs << "," << frame.geometryMs << "," << frame.uploadsInFlight << "," << frame.stagedBytes / 1024 << "\n";
+            if (frame.uploadsInFlight > 0)
+            {
+                uploadMs += frame.frameMs;
+                ++m_UploadFrames;
+                m_WorstUploadFrameMs = std::max(m_WorstUploadFrameMs, frame.frameMs);
+            }
+            else
+            {
+                idleMs += frame.frameMs;
+                ++idleFrames;
+            }
+        }
+        m_IdleFrameMs = idleFrames > 0 ? static_cast<float>(idleMs / idleFrames) : 0.0f;
+        m_UploadFrameMs = m_UploadFrames > 0 ? static_cast<float>(uploadMs / m_UploadFrames) : 0.0f;
+        std::cout << "\nframe trace written to " << s_FrameTracePath << std::endl;
+    }
 }
 
-void Application::LoadGameObjects()
+void Application::ReportStartupTime(float& outMs, const char* what)
+{
+    if (outMs >= 0.0f) return;
+
+    outMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - m_StartTime).count();
+    std::cout << "[Streaming] " << what << " after " << std::fixed << std::setprecision(1) << outMs << " ms"
+        << (s_StreamAssets ? "" : " (synchronous load)") << std::endl;
+}
+
+void Application::UploadStreamedAssets()
+{
+    //over budget the scene keeps what it has, further assets wait in the queue until memory frees up
+    const bool holdBack = m_OverMemoryBudget && m_HDRImage && !m_GameObjects.empty();
+
+    StreamedAsset asset{};
+    while (!holdBack && m_StreamedAssets.TryPop(asset))
+    {
+        if (auto* environment = std::get_if<HDRImage::DecodedImage>(&asset))
+        {
+            m_UploadingHDRImage = std::make_shared<HDRImage>(m_Device, m_PipelineBuilder, *environment);
+        }
+        else if (auto* model = std::get_if<Model::DecodedModel>(&asset))
+        {
+            auto gameObj = GameObject::CreateGameObject(); 
+            gameObj.m_Model = Model::CreateModel(m_Device, std::move(*model));
+            gameObj.m_Transform.translation = { 0.f,0.f,0.f }; 
+            gameObj.m_Transform.scale = glm::vec3(1.f); 
+            gameObj.m_Transform.rotation = { 0.f, glm::radians(-90.f),glm::radians(180.f) };
+            m_UploadingGameObjects.push_back(std::move(gameObj));
+        }
+        asset = {};
+    }
+
+    //rethrows load errors on the render thread
+    std::erase_if(m_LoadJobs, [](std::future<void>& job)
+        {
+            if (job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+            job.get();
+            return true;
+        });
+}
+
+void Application::AddFinishedUploads()
+{
+    //the graphics half of an upload on the transfer queue is only submitted once its copies finished, rendering before
+    //that would sample images the graphics queue does not own yet
+    if (m_UploadingHDRImage && m_Device.isUploadComplete(m_UploadingHDRImage->GetUploadToken()))
+    {
+        m_HDRImage = std::move(m_UploadingHDRImage);
+    }
+    for (auto it = m_UploadingGameObjects.begin(); it != m_UploadingGameObjects.end();)
+    {
+        if (!m_Device.isUploadComplete(it->m_Model->GetUploadToken()))
+        {
+            ++it;
+            continue;
+        }
+        m_GameObjects.push_back(std::move(*it));
+        it = m_UploadingGameObjects.erase(it);
+    }
+}
+
+void Application::RunVertexLayoutBenchmark(const std::string& scenePath, uint32_t frameCount)
+{
+    struct Result
+    {
+        const char*  name;
+        VkDeviceSize vertexBytes;
+        float        frameMs;
+    };
+    std::vector<Result> results;
+
+    for (auto layout : { Model::VertexLayout::Full, Model::VertexLayout::Compact })
+    {
+        Model::s_VertexLayout = layout;
+
+        Application app{ scenePath };
+        app.run(frameCount);
+        VkDeviceSize vertexBytes = 0;
+        for (const auto& gameObject : app.m_GameObjects)
+        {
+            vertexBytes += gameObject.m_Model->GetVertexMemorySize();
+        }
+        results.push_back({ layout == Model::VertexLayout::Full ? "full (68 B)" : "compact (24 B)", vertexBytes, app.m_AverageFrameMs });
+    }
+
+    //frame times are capped by the present mode when the swapchain falls back to FIFO
+    std::cout << "\n" << scenePath << ", " << frameCount << " frames\n";
+    std::cout << "layout            vertex memory (MB)   frame (ms)\n";
+    for (const auto& result : results)
+    {
+        std::cout << std::left << std::setw(18) << result.name << std::right
+            << std::fixed << std::setprecision(2)
+            << std::setw(18) << static_cast<double>(result.vertexBytes) / (1024.0 * 1024.0)
+            << std::setw(13) << result.frameMs << std::endl;
+    }
+}
+
+void Application::RunLodBenchmark(const std::string& scenePath, uint32_t frameCount)
+{
+    struct Result
+    {
+        float    bias;
+        uint64_t triangles;
+        float    frameMs;
+    };
+    std::vector<Result> results;
+
+    //bias 0 is the LOD 0 baseline
+    for (float bias : { 0.0f, 0.5f, 1.0f, 2.0f, 4.0f, 8.0f })
+    {
+        Application app{ scenePath };
+        app.m_LodBias = bias;
+        app.run(frameCount);
+        results.push_back({ bias, app.m_AverageTriangles, app.m_AverageFrameMs });
+    }
+
+    std::cout << "\n" << scenePath << ", " << frameCount << " frames\n";
+    std::cout << "LOD bias   triangles/frame   vs LOD 0   frame (ms)\n";
+    for (const auto& result : results)
+    {
+        std::cout << std::fixed << std::setprecision(2)
+            << std::setw(8) << result.bias
+            << std::setw(18) << result.triangles
+            << std::setw(10) << 100.0 * static_cast<double>(result.triangles) / static_cast<double>(std::max<uint64_t>(results.front().triangles, 1)) << "%"
+            << std::setw(13) << result.frameMs << std::endl;
+    }
+}
+
+void Application::RunTextureCompressionBenchmark(const std::string& scenePath, uint32_t frameCount)
+{
+    struct Result
+    {
+        const char*  name;
+        VkDeviceSize textureBytes;
+        uint32_t     compressedTextures;
+        uint32_t     textures;
+        float        geometryMs;
+        float        frameMs;
+    };
+    std::vector<Result> results;
+
+    //packages bake in whatever the cooker wrote, so both runs load the textures directly (source images or their .ktx2)
+    const bool loadPackages = AssetPackage::s_LoadPackages;
+    const bool useCompressed = TextureDecoder::s_UseCompressedTextures;
+    AssetPackage::s_LoadPackages = false;
+    for (bool compressed : { false, true })
+    {
+        TextureDecoder::s_UseCompressedTextures = compressed;
+
+        Application app{ scenePath };
+        app.run(frameCount);
+        Result result{ compressed ? "BC7/BC5/BC4" : "RGBA8", 0, 0, 0, app.m_AverageGeometryMs, app.m_AverageFrameMs };
+        for (const auto& gameObject : app.m_GameObjects)
+        {
+            result.textureBytes += gameObject.m_Model->GetTextureMemorySize();
+            result.compressedTextures += gameObject.m_Model->GetCompressedTextureCount();
+            result.textures += static_cast<uint32_t>(gameObject.m_Model->getData().textureSlots.size());
+        }
+        results.push_back(result);
+    }
+    AssetPackage::s_LoadPackages = loadPackages;
+    TextureDecoder::s_UseCompressedTextures = useCompressed;
+
+    //textures without a .ktx2 (not cooked, or a device without BC support) stay RGBA8 in the second run
+    std::cout << "\n" << scenePath << ", " << frameCount << " frames\n";
+    std::cout << "textures       texture memory (MB)   compressed   geometry pass (ms)   frame (ms)\n";
+    for (const auto& result : results)
+    {
+        std::cout << std::left << std::setw(15) << result.name << std::right
+            << std::fixed << std::setprecision(2)
+            << std::setw(19) << static_cast<double>(result.textureBytes) / (1024.0 * 1024.0)
+            << std::setw(10) << result.compressedTextures << "/" << result.textures
+            << std::setw(21) << result.geometryMs
+            << std::setw(13) << result.frameMs << std::endl;
+    }
+}
+
+void Application::RunUploadBenchmark()
+{
+    struct Case
+    {
+        const char*  name;
+        VkDeviceSize payloadSize;
+        uint32_t     uploadCount;
+    };
+    const Case cases[] = { { "4 KB", 4ull << 10, 4096 }, { "256 KB", 256ull << 10, 512 }, { "32 MB", 32ull << 20, 8 } };
+
+    //no scene needed, a window is only there for the device
+    Window window{ "Upload benchmark" };
+    Device device{ window };
+
+    auto toMbPerSecond = [](VkDeviceSize bytes, float ms) { return static_cast<double>(bytes) / (1024.0 * 1024.0) / (ms / 1000.0); };
+
+    std::cout << "\npayload   uploads   temporary buffer (MB/s)   staging ring (MB/s)\n";
+    for (const auto& c : cases)
+    {
+        const std::vector<char> payload(static_cast<size_t>(c.payloadSize), 1);
+
+        //every upload lands in its own slice of the destination, like the vertex / index buffers of different models
+        const VkDeviceSize slices = std::min<VkDeviceSize>(c.uploadCount, 8);
+        VkBuffer destination;
+        MemoryAllocation destinationMemory;
+        device.createBuffer(c.payloadSize * slices, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, destination, destinationMemory);
+
+        auto record = [&](VkBuffer source, VkDeviceSize sourceOffset, uint32_t upload)
+        {
+            VkCommandBuffer cmd = device.beginSingleTimeCommands();
+            VkBufferCopy region{ sourceOffset, c.payloadSize * (upload % slices), c.payloadSize };
+            vkCmdCopyBuffer(cmd, source, destination, 1, &region);
+            return device.endSingleTimeCommands(cmd);
+        };
+
+        float ms[2]{};
+        for (bool ring : { false, true })
+        {
+            const auto start = std::chrono::high_resolution_clock::now();
+            UploadToken token = 0;
+            for (uint32_t upload = 0; upload < c.uploadCount; ++upload)
+            {
+                if (ring)
+                {
+                    const StagingRing::Region staging = device.stagingRing().allocate(c.payloadSize);
+                    std::memcpy(staging.mapped, payload.data(), payload.size());
+                    token = record(staging.buffer, staging.offset, upload);
+                }
+                else
+                {
+                    VkBuffer staging;
+                    MemoryAllocation stagingMemory;
+                    device.createBuffer(c.payloadSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging, stagingMemory);
+                    std::memcpy(stagingMemory.mapped, payload.data(), payload.size());
+                    device.waitForUpload(record(staging, 0, upload));
+                    device.destroyBuffer(staging, stagingMemory);
+                }
+            }
+            device.waitForUpload(token);
+            ms[ring ? 1 : 0] = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+
+        device.destroyBuffer(destination, destinationMemory);
+
+        const VkDeviceSize totalBytes = c.payloadSize * c.uploadCount;
+        std::cout << std::left << std::setw(10) << c.name << std::right
+            << std::setw(7) << c.uploadCount
+            << std::fixed << std::setprecision(1)
+            << std::setw(26) << toMbPerSecond(totalBytes, ms[0])
+            << std::setw(22) << toMbPerSecond(totalBytes, ms[1]) << std::endl;
+    }
+
+    const auto& stats = device.stagingRing().getStats();
+    std::cout << "staging ring: " << stats.ringAllocations << " regions, " << stats.overflowAllocations << " temporary buffers, "
+        << stats.waits << " waits, peak " << std::setprecision(2) << static_cast<double>(stats.peakUsedBytes) / (1024.0 * 1024.0)
+        << " of " << static_cast<double>(device.stagingRing().getSize()) / (1024.0 * 1024.0) << " MB" << std::endl;
+}
+
+void Application::RunModelUploadBenchmark(const std::string& scenePath)
 {
-    m_HDRImage = std::make_unique<HDRImage>(m_Device, "Resources/HDRImages/circus_arena_4k.hdr");
+    Window window{ "Upload benchmark" };
+    Device device{ window };
+    TextureRegistry::Init(device);
+    MaterialTable::Init(device);
+    GeometryArena::Init(device);
+
+    struct Result
+    {
+        const char* name;
+        float       uploadMs;
+        uint64_t    submits;
+    };
+    std::vector<Result> results;
+
+    const bool batchUploads = Device::s_BatchUploads;
+    for (bool batched : { false, true })
+    {
+        Device::s_BatchUploads = batched;
+
+        //decoding is not part of the measurement, only CreateModel until the GPU finished the uploads
+        Model::DecodedModel decoded = Model::DecodeModelFromFile(scenePath);
+        const uint64_t submitsBefore = device.getUploadSubmitCount();
+        const auto start = std::chrono::high_resolution_clock::now();
+        auto model = Model::CreateModel(device, std::move(decoded));
+        device.waitForUpload(model->GetUploadToken());
+        const float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        results.push_back({ batched ? "batched" : "submit + wait each", ms, device.getUploadSubmitCount() - submitsBefore });
+
+        //releases the textures again, the second run uploads them too
+        model.reset();
+    }
+    Device::s_BatchUploads = batchUploads;
+
+    GeometryArena::Cleanup(device);
+    MaterialTable::Cleanup(device);
+    TextureRegistry::Cleanup(device);
+
+    std::cout << "\n" << scenePath << "\n";
+    std::cout << "uploads              submits   load (ms)\n";
+    for (const auto& result : results)
+    {
+        std::cout << std::left << std::setw(19) << result.name << std::right
+            << std::setw(10) << result.submits
+            << std::fixed << std::setprecision(1) << std::setw(12) << result.uploadMs << std::endl;
+    }
+}
 
-    std::shared_ptr<Model> newSponza = Model::CreateModelFromFile(m_Device, "Resources/MetalRoughSpheres/glTF/MetalRoughSpheres.gltf");
-    auto gameObj = GameObject::CreateGameObject(); 
-    gameObj.m_Model = newSponza;
-    gameObj.m_Transform.translation = { 0.f,0.f,0.f }; 
-    gameObj.m_Transform.scale = glm::vec3(1.f); 
-    gameObj.m_Transform.rotation = { 0.f, glm::radians(-90.f),glm::radians(180.f) };
-    m_GameObjects.push_back(std::move(gameObj));
+void Application::PushStreamedAsset(StreamedAsset&& asset)
+{
+    while (!m_StreamedAssets.TryPush(std::move(asset)))
+    {
+        std::this_thread::yield();
+    }
+}
+
+void Application::StreamModel(const std::string& path)
+{
+    m_LoadJobs.push_back(m_LoadPool.Submit([this, path] { PushStreamedAsset(Model::DecodeModelFromFile(path)); }));
+}
+
+void Application::RunStreamingBenchmark(const std::string& scenePath, const std::string& streamedPath, uint32_t frameCount)
+{
+    struct Result
+    {
+        std::string name;
+        std::string tracePath;
+        uint32_t    uploadFrames;
+        float       idleMs;
+        float       uploadMs;
+        float       worstUploadMs;
+    };
+    std::vector<Result> results;
+
+    const bool useTransferQueue = Device::s_UseTransferQueue;
+    const std::string tracePath = s_FrameTracePath;
+    for (bool transferQueue : { false, true })
+    {
+        Device::s_UseTransferQueue = transferQueue;
+        s_FrameTracePath = transferQueue ? "upload_trace_transfer.csv" : "upload_trace_graphics.csv";
+
+        Application app{ scenePath };
+        app.m_StreamedScenePath = streamedPath;
+        app.run(frameCount);
+        //a device without a transfer only family runs both on the graphics queue
+        results.push_back({ app.m_Device.hasTransferQueue() ? "transfer queue" : "graphics queue", s_FrameTracePath,
+            app.m_UploadFrames, app.m_IdleFrameMs, app.m_UploadFrameMs, app.m_WorstUploadFrameMs });
+    }
+    Device::s_UseTransferQueue = useTransferQueue;
+    s_FrameTracePath = tracePath;
+
+    std::cout << "\n" << scenePath << " + " << streamedPath << " streamed in, " << frameCount << " frames\n";
+    std::cout << "uploads on        upload frames   idle frame (ms)   upload frame (ms)   worst (ms)   trace\n";
+    for (const auto& result : results)
+    {
+        std::cout << std::left << std::setw(17) << result.name << std::right
+            << std::setw(14) << result.uploadFrames
+            << std::fixed << std::setprecision(2)
+            << std::setw(18) << result.idleMs
+            << std::setw(20) << result.uploadMs
+            << std::setw(13) << result.worstUploadMs
+            << "   " << result.tracePath << std::endl;
+    }
+}
+
+void Application::RunGeometryArenaBenchmark(const std::vector<std::string>& scenePaths, uint32_t frameCount)
+{
+    Application app{ scenePaths.front() };
+    for (size_t i = 1; i < scenePaths.size(); ++i) app.StreamModel(scenePaths[i]);
+
+    //every model is in the scene before the first measured frame
+    for (auto& job : app.m_LoadJobs) job.wait();
+    app.UploadStreamedAssets();
+    app.m_Device.waitForUploads();
+    app.AddFinishedUploads();
+    app.run(frameCount);
+
+    auto toMb = [](VkDeviceSize bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+    const auto& stats = GeometryArena::GetStats();
+    std::cout << "\n" << app.m_GameObjects.size() << " models, " << frameCount << " frames\n";
+    for (const auto& path : scenePaths) std::cout << "  " << path << "\n";
+    std::cout << std::fixed << std::setprecision(1)
+        << "geometry binds/frame    arena: " << std::setw(8) << app.m_AverageGeometryBinds
+        << "   buffers per model: " << std::setw(8) << app.m_AverageModelSwitches << "\n"
+        << std::setprecision(2)
+        << "geometry memory (MB)    arena: " << std::setw(8) << toMb(stats.usedBytes)
+        << "   buffers per model: " << std::setw(8) << toMb(stats.separateBytes) << "   (" << stats.rangeCount << " ranges)\n"
+        << "frame (ms): " << app.m_AverageFrameMs << std::endl;
+}
+
+void Application::RunAttachmentMemoryReport()
+{
+    //no scene needed, a window is only there for the device and the swapchain image count
+    Window window{ "Attachment memory report" };
+    Device device{ window };
+    SwapChain swapChain{ device, window.GetExtent() };
+
+    auto renderTargetBytes = [&device]() { return device.memoryAllocator().getStats().categories[static_cast<size_t>(MemoryCategory::RenderTarget)].usedBytes; };
+    auto toMb = [](VkDeviceSize bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+
+    const VkExtent2D extents[] = { { 1920, 1080 }, { 3840, 2160 } };
+    std::cout << "\n" << swapChain.imageCount() << " swapchain images, bytes taken from the allocator including rounding\n"
+        << "resolution   G-buffer (MB)   light buffer (MB)   before (MB)   after (MB)   saved (MB)\n";
+    for (const auto& extent : extents)
+    {
+        VkDeviceSize base = renderTargetBytes();
+        GBuffer gBuffer;
+        gBuffer.create(device, extent.width, extent.height);
+        const VkDeviceSize gBufferBytes = renderTargetBytes() - base;
+
+        base = renderTargetBytes();
+        LightBuffer lightBuffer;
+        lightBuffer.create(device, extent.width, extent.height);
+        const VkDeviceSize lightBufferBytes = renderTargetBytes() - base;
+
+        //what the attachments used to be: the light buffer in RGBA32F and a depth image per swapchain image nothing rendered to
+        base = renderTargetBytes();
+        std::vector<std::unique_ptr<Texture>> previous;
+        previous.push_back(std::make_unique<Texture>(device, extent.width, extent.height, VK_FORMAT_R32G32B32A32_SFLOAT,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, false));
+        for (size_t i = 0; i < swapChain.imageCount(); ++i)
+        {
+            previous.push_back(std::make_unique<Texture>(device, extent.width, extent.height, swapChain.findDepthFormat(),
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, false));
+        }
+        const VkDeviceSize previousBytes = renderTargetBytes() - base;
+
+        const VkDeviceSize before = gBufferBytes + previousBytes;
+        const VkDeviceSize after = gBufferBytes + lightBufferBytes;
+        std::cout << std::fixed << std::setprecision(1)
+            << std::setw(4) << extent.width << "x" << std::left << std::setw(7) << extent.height << std::right
+            << std::setw(13) << toMb(gBufferBytes) << std::setw(20) << toMb(lightBufferBytes)
+            << std::setw(14) << toMb(before) << std::setw(13) << toMb(after) << std::setw(13) << toMb(before - after) << "\n";
+
+        previous.clear();
+        lightBuffer.cleanup();
+        gBuffer.cleanup();
+    }
+    std::cout << std::flush;
+}
+
+void Application::RunPipelineCacheBenchmark(const std::string& scenePath)
+{
+    if (Device::s_PipelineCachePath.empty())
+    {
+        std::cout << "the pipeline cache file is disabled, nothing to compare" << std::endl;
+        return;
+    }
+    std::error_code ec;
+    std::filesystem::remove(Device::s_PipelineCachePath, ec);
+
+    //a fresh device per run: the first starts without a cache file and saves one when it is destroyed, the second loads it
+    Device::PipelineCacheStats stats[2]{};
+    for (auto& runStats : stats)
+    {
+        Application app{ scenePath };
+        app.run(1);
+        runStats = app.m_Device.getPipelineCacheStats();
+    }
+
+    //wall time is what startup pays, the summed time adds up every build thread
+    const float coldMs = stats[0].wallMs;
+    const float warmMs = stats[1].wallMs;
+    std::cout << "\npipelines   cold (ms)   warm (ms)   speedup   cold summed (ms)   warm summed (ms)   cache (KB)\n" << std::fixed << std::setprecision(2)
+        << std::setw(9) << stats[1].pipelineCount << std::setw(12) << coldMs << std::setw(12) << warmMs
+        << std::setw(9) << coldMs / std::max(warmMs, 0.001f) << "x" << std::setw(19) << stats[0].creationMs << std::setw(19) << stats[1].creationMs
+        << std::setw(13) << static_cast<double>(stats[1].loadedBytes) / 1024.0 << std::endl;
+}
+
+void Application::RunLightingVariantBenchmark(const std::string& scenePath, uint32_t frameCount)
+{
+    //a grid of point lights through the scene, added by the point light setups
+    std::vector<Light> pointLights;
+    for (int x = 0; x < 8; ++x)
+    {
+        for (int z = 0; z < 4; ++z)
+        {
+            Light light{};
+            light.type = LightType::Point;
+            light.position = { -10.0f + x * (20.0f / 7.0f), 2.0f, -4.0f + z * (8.0f / 3.0f) };
+            light.radius = 6.0f;
+            light.lightColor = { 1.0f, 0.8f, 0.6f };
+            light.lightIntensity = 50.0f;
+            pointLights.push_back(light);
+        }
+    }
+
+    struct Setup
+    {
+        const char* name;
+        bool        sun;
+        bool        pointLights;
+    };
+    const Setup setups[] = {
+        { "IBL only", false, false },
+        { "sun", true, false },
+        { "32 point lights", false, true },
+        { "sun + 32 point", true, true }
+    };
+
+    struct Result
+    {
+        const char*     name;
+        LightingVariant variant;
+        float           specializedMs;
+        float           mixedMs;
+    };
+    std::vector<Result> results;
+
+    const bool specializedLighting = DeferredRenderSystem::s_SpecializedLighting;
+    for (const auto& setup : setups)
+    {
+        Result result{ setup.name, LightingVariant::IBLOnly, 0.0f, 0.0f };
+        for (bool specialized : { true, false })
+        {
+            DeferredRenderSystem::s_SpecializedLighting = specialized;
+
+            //LoadGameObjects added the sun, run() hands the lights to the render system when it creates it
+            Application app{ scenePath };
+            if (!setup.sun) app.m_Lights.clear();
+            if (setup.pointLights) app.m_Lights.insert(app.m_Lights.end(), pointLights.begin(), pointLights.end());
+            app.run(frameCount);
+            (specialized ? result.specializedMs : result.mixedMs) = app.m_AverageLightingMs;
+
+            uint32_t lightTypes = 0;
+            for (const auto& light : app.m_Lights) lightTypes |= 1u << static_cast<uint32_t>(light.type);
+            result.variant = static_cast<LightingVariant>(lightTypes);
+        }
+        results.push_back(result);
+    }
+    DeferredRenderSystem::s_SpecializedLighting = specializedLighting;
+
+    std::cout << "\n" << scenePath << ", " << frameCount << " frames, lighting pass GPU time\n";
+    std::cout << "lights            variant              specialized (ms)   mixed (ms)   speedup\n";
+    for (const auto& result : results)
+    {
+        std::cout << std::left << std::setw(18) << result.name << std::setw(21) << DeferredRenderSystem::GetLightingVariantName(result.variant) << std::right
+            << std::fixed << std::setprecision(3)
+            << std::setw(16) << result.specializedMs
+            << std::setw(13) << result.mixedMs
+            << std::setw(9) << std::setprecision(2) << result.mixedMs / std::max(result.specializedMs, 0.001f) << "x" << std::endl;
+    }
+}
+
+void Application::LoadGameObjects()
+{
+    //decode on the load pool, finished assets go through the queue and the render thread uploads them in UploadStreamedAssets
+    m_LoadJobs.push_back(m_LoadPool.Submit([this] { PushStreamedAsset(HDRImage::decode("Resources/HDRImages/circus_arena_4k.hdr")); }));
+    StreamModel(m_ScenePath);
+
+    if (!s_StreamAssets)
+    {
+        for (auto& job : m_LoadJobs) job.wait();
+        UploadStreamedAssets();
+        m_Device.waitForUploads();
+        AddFinishedUploads();
+    }
 
     // Add a red point light at (10,10,10):
 
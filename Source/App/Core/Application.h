@@ -4,8 +4,16 @@
 #include "GameObject.h"
 #include "Renderer.h"
 #include "Texture.h"
+#include "HDRImage.h"
+#include "LockFreeQueue.h"
+#include "ThreadPool.h"
+#include "PipelineBuilder.h"
 //std 
+#include <chrono>
+#include <future>
 #include <memory>
+#include <string>
+#include <variant>
 #include <vector>
 
 #include "DeferredRenderSystem.h"
@@ -15,7 +23,7 @@ namespace cve {
 class Application
 {
 public: 
-	Application(); 
+	explicit Application(std::string scenePath = "Resources/MetalRoughSpheres/glTF/MetalRoughSpheres.gltf"); 
 	~Application(); 
 
 	Application(const Application& other) = delete;
@@ -23,9 +31,87 @@ public:
 	Application(const Application&& other) = delete;
 	Application& operator=(const Application&& rhs) = delete;
 
-	void run();
+	//true: the scene decodes on background threads while run() already presents frames. false: the constructor waits for it
+	static bool s_StreamAssets;
+	//run() writes a CSV line per scene frame there when set: frame time, geometry pass GPU time, uploads in flight, staged KB
+	static std::string s_FrameTracePath;
+
+	//maxFrames 0 = run until the window closes
+	void run(uint32_t maxFrames = 0);
+
+	//renders the scene with the full and the compact vertex layout, prints vertex buffer memory and average frame time
+	static void RunVertexLayoutBenchmark(const std::string& scenePath, uint32_t frameCount);
+
+	//renders the scene at a range of LOD bias values, prints triangles per frame and average frame time for each
+	static void RunLodBenchmark(const std::string& scenePath, uint32_t frameCount);
+
+	//renders the scene with the source textures and with the cooked BC7/BC5/BC4 KTX2 textures, prints texture memory,
+	//geometry pass GPU time and average frame time of both
+	static void RunTextureCompressionBenchmark(const std::string& scenePath, uint32_t frameCount);
+
+	//uploads many small and a few large payloads, once with a temporary staging buffer per upload and once through the
+	//device's staging ring, prints the throughput of both
+	static void RunUploadBenchmark();
+
+	//loads the scene's model once with a submit and wait per upload step and once with one upload batch for the whole
+	//model, prints the number of submits and the wall time until the GPU finished
+	static void RunModelUploadBenchmark(const std::string& scenePath);
+
+	//renders the scene while streamedPath is loaded once the first scene frame is on screen, once with the uploads on the
+	//graphics queue and once on the transfer queue. Prints frame times with and without uploads in flight and writes a
+	//frame trace of each run
+	static void RunStreamingBenchmark(const std::string& scenePath, const std::string& streamedPath, uint32_t frameCount);
+
+	//renders all given scenes at once out of the GeometryArena, prints the geometry binds per frame against the binds a
+	//vertex / index buffer per model took (one per drawn model and pass) and the memory of both
+	static void RunGeometryArenaBenchmark(const std::vector<std::string>& scenePaths, uint32_t frameCount);
+
+	//creates the G-buffer and light buffer at 1080p and 4K, prints the render target memory they take against what the
+	//RGBA32F light buffer and the swapchain's depth images took on top of the same G-buffer
+	static void RunAttachmentMemoryReport();
+
+	//loads the scene twice, first without a pipeline cache file and then with the one the first run saved. Prints the time
+	//spent creating pipelines in both runs
+	static void RunPipelineCacheBenchmark(const std::string& scenePath);
+
+	//renders the scene lit by IBL only, the sun, point lights and the sun plus point lights. Prints the lighting pass GPU time
+	//of the specialized lighting variant and of the generic (mixed) one for each
+	static void RunLightingVariantBenchmark(const std::string& scenePath, uint32_t frameCount);
+
 private: 
+	//decoded on the load pool, uploaded on the render thread
+	using StreamedAsset = std::variant<std::monostate, HDRImage::DecodedImage, Model::DecodedModel>;
+
 	void LoadGameObjects(); 
+	void StreamModel(const std::string& path);
+	void PushStreamedAsset(StreamedAsset&& asset);
+	void UploadStreamedAssets();
+	//moves uploads the GPU finished into the scene
+	void AddFinishedUploads();
+	void ReportStartupTime(float& outMs, const char* what);
+
+	//first member so startup times include window and device creation
+	const std::chrono::high_resolution_clock::time_point m_StartTime = std::chrono::high_resolution_clock::now();
+	float m_FirstFrameMs = -1.0f;
+	float m_FirstSceneFrameMs = -1.0f;
+
+	std::string m_ScenePath;
+	float m_AverageFrameMs = 0.0f;	//filled by run() when it stops after maxFrames
+	uint64_t m_AverageTriangles = 0;
+	float m_AverageGeometryMs = 0.0f;	//GPU time of the geometry pass
+	float m_AverageLightingMs = 0.0f;	//GPU time of the lighting pass
+	float m_AverageGeometryBinds = 0.0f;
+	float m_AverageModelSwitches = 0.0f;
+	float m_LodBias = 1.0f;	//starting value for the render system, F6/F7 change it at runtime
+	std::string m_StreamedScenePath;	//loaded once the scene is on screen, its upload overlaps with rendering
+	//filled by run() when it writes a frame trace
+	float m_IdleFrameMs = 0.0f;
+	float m_UploadFrameMs = 0.0f;	//frames with uploads in flight
+	float m_WorstUploadFrameMs = 0.0f;
+	uint32_t m_UploadFrames = 0;
+
+	static constexpr float MEMORY_LOG_INTERVAL_SEC = 10.0f;	//full memory budget line, the FPS line shows the VRAM total every second
+	bool m_OverMemoryBudget = false;
 
 	static constexpr int m_WIDTH = 1080; 
 	static constexpr int m_HEIGHT = 720; 
@@ -33,9 +119,19 @@ private:
 	Window m_Window{"Graphics_Programming_2_VulkanRenderer"};
 	Device m_Device{m_Window}; 
 	Renderer m_Renderer{ m_Window, m_Device }; 
+	//builds the render system's and the environment's pipelines next to the render thread
+	PipelineBuilder m_PipelineBuilder{ m_Device };
 	std::vector<GameObject> m_GameObjects;
 	std::vector<Light> m_Lights;
 	std::shared_ptr<HDRImage> m_HDRImage; 
+	//uploaded but not finished on the GPU yet, they join the scene once their upload token completed
+	std::vector<GameObject> m_UploadingGameObjects;
+	std::shared_ptr<HDRImage> m_UploadingHDRImage;
+
+	//declared after everything the load jobs touch, the pool finishes its jobs before those are destroyed
+	LockFreeQueue<StreamedAsset> m_StreamedAssets{ 8 };
+	std::vector<std::future<void>> m_LoadJobs;
+	ThreadPool m_LoadPool{ 2 };
 
 };
 
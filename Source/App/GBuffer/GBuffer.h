@@ -15,8 +15,6 @@ namespace cve
 		static constexpr VkFormat METALROUGH_FORMAT = VK_FORMAT_R8G8B8A8_UNORM; //r metal, g roughness
 		static constexpr VkFormat OCCLUSION_FORMAT = VK_FORMAT_R8G8B8A8_SRGB; 
 
-
-
 		static constexpr VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
 
 		void create(Device& device, uint32_t width, uint32_t height);
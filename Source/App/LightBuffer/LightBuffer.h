@@ -9,7 +9,8 @@ namespace cve {
     {
     public:
 
-        static constexpr VkFormat HDR_FORMAT = VK_FORMAT_R32G32B32A32_SFLOAT; 
+        // half floats cover the lit HDR range up to 65504, half the memory and bandwidth of RGBA32F
+        static constexpr VkFormat HDR_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT; 
 
         void create(Device& device, uint32_t width, uint32_t height); 
         void cleanup();
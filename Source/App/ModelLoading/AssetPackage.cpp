@@ -0,0 +1,226 @@
+#include "AssetPackage.h"
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "SourceDependencies.h"
+
+//std
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace cve
+{
+	bool AssetPackage::s_LoadPackages = true;
+
+	namespace
+	{
+		constexpr char     MAGIC[4] = { 'C', 'V', 'E', 'P' };
+		constexpr uint64_t ALIGNMENT = 16;
+
+		struct PackageHeader
+		{
+			char     magic[4];
+			uint32_t version;
+			uint64_t sourceHash;	//contents of the scene file
+			uint64_t sourceSize;
+			uint64_t dependencyCount;	//buffers and images the scene references, one SourceDependencies::Entry each
+			uint64_t dependencyTableOffset;
+			uint64_t geometryOffset;	//MeshCache entry
+			uint64_t textureCount;
+			uint64_t textureTableOffset;
+			uint64_t fileSize;
+		};
+
+		struct TextureEntry
+		{
+			uint32_t format;
+			int32_t  width;
+			int32_t  height;
+			int32_t  channels;
+			uint32_t mipLevels;
+			uint32_t blockBytes;	//0 for uncompressed pixels
+			uint64_t dataOffset;	//all levels back to back, level 0 first
+			uint64_t dataSize;
+		};
+
+		uint64_t AlignUp(uint64_t value)
+		{
+			return (value + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+		}
+
+		void PadTo(std::ostream& out, uint64_t offset)
+		{
+			static const char zeros[ALIGNMENT]{};
+			out.write(zeros, static_cast<std::streamsize>(offset - static_cast<uint64_t>(out.tellp())));
+		}
+	}
+
+	std::string AssetPackage::GetPackagePath(const std::string& sourcePath)
+	{
+		return std::filesystem::path{ sourcePath }.replace_extension(EXTENSION).string();
+	}
+
+	bool AssetPackage::Load(const std::string& sourcePath, ModelImport::DecodedModel& outModel)
+	{
+		const std::string packagePath = GetPackagePath(sourcePath);
+		if (!std::filesystem::exists(packagePath) || !std::filesystem::exists(sourcePath)) return false;
+
+		auto loadStart = std::chrono::high_resolution_clock::now();
+		const std::filesystem::path fp{ sourcePath };
+		const std::string name = fp.filename().string();
+
+		auto file = std::make_shared<MappedFile>(packagePath);
+		if (!file->IsValid() || file->GetSize() < sizeof(PackageHeader)) return false;
+
+		PackageHeader header{};
+		std::memcpy(&header, file->GetData(), sizeof(PackageHeader));
+		if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+			header.version != VERSION ||
+			header.fileSize != file->GetSize() ||
+			header.dependencyTableOffset > header.fileSize ||
+			header.dependencyCount > (header.fileSize - header.dependencyTableOffset) / sizeof(SourceDependencies::Entry) ||
+			header.textureTableOffset > header.fileSize ||
+			header.textureCount > (header.fileSize - header.textureTableOffset) / sizeof(TextureEntry))
+		{
+			std::cout << "[AssetPackage] " << name << ": unreadable package, recook it" << std::endl;
+			return false;
+		}
+
+		const MeshCache::EntryKey key{ 0, 0, ModelImport::s_ImportOptions.GetImportFlags(), ModelImport::s_ImportOptions.GetProcessFlags() };
+		ModelImport::Data data{};
+		if (header.sourceSize != std::filesystem::file_size(sourcePath) ||
+			header.sourceHash != SourceDependencies::HashFile(sourcePath) ||
+			!MeshCache::ReadEntry(file, header.geometryOffset, key, data))
+		{
+			std::cout << "[AssetPackage] " << name << ": package is stale (source or import options changed), importing the source" << std::endl;
+			return false;
+		}
+
+		// the geometry and textures came from these buffers and images, any of them changing invalidates the package
+		if (!SourceDependencies::Match(sourcePath, file->GetSpan<SourceDependencies::Entry>(header.dependencyTableOffset, header.dependencyCount)))
+		{
+			std::cout << "[AssetPackage] " << name << ": package is stale (a buffer or image changed), importing the source" << std::endl;
+			return false;
+		}
+
+		// same texture order as the cooker, the table only has to agree on count and format
+		auto textureFiles = ModelImport::GatherTextureFiles(data, fp.parent_path().string() + "/");
+		if (textureFiles.size() != header.textureCount) return false;
+
+		std::vector<TextureDecoder::DecodedImage> images;
+		images.reserve(textureFiles.size());
+		uint64_t textureBytes = 0;
+		for (size_t i = 0; i < textureFiles.size(); ++i)
+		{
+			TextureEntry entry{};
+			std::memcpy(&entry, file->GetData() + header.textureTableOffset + i * sizeof(TextureEntry), sizeof(TextureEntry));
+			// the cooker stores either format, compressed entries are only usable when the device samples BC
+			const auto& textureFile = textureFiles[i];
+			const bool compressed = entry.format == static_cast<uint32_t>(textureFile.compressedFormat);
+			if ((entry.format != static_cast<uint32_t>(textureFile.format) && !compressed) || entry.width <= 0 || entry.height <= 0 ||
+				entry.dataOffset > header.fileSize || entry.dataSize > header.fileSize - entry.dataOffset)
+			{
+				return false;
+			}
+			if (compressed && !TextureDecoder::s_UseCompressedTextures)
+			{
+				std::cout << "[AssetPackage] " << name << ": package holds compressed textures but compression is disabled, importing the source" << std::endl;
+				return false;
+			}
+
+			auto image = TextureDecoder::allocate(textureFile.path, static_cast<VkFormat>(entry.format), entry.width, entry.height, entry.channels,
+				entry.mipLevels, entry.blockBytes);
+			if (image.getSize() != entry.dataSize) return false;
+
+			std::memcpy(image.pixels.get(), file->GetData() + entry.dataOffset, static_cast<size_t>(entry.dataSize));
+			textureBytes += entry.dataSize;
+			images.emplace_back(std::move(image));
+		}
+
+		auto loadMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+		std::cout << std::fixed << std::setprecision(2) << "[AssetPackage] " << name << ": " << images.size() << " textures ("
+			<< static_cast<double>(textureBytes) / (1024.0 * 1024.0) << " MB with mips) and geometry in " << loadMs << " ms" << std::endl;
+
+		outModel = { name, std::move(data), std::move(images), loadMs, 1 };
+		return true;
+	}
+
+	uint64_t AssetPackage::Write(const std::string& sourcePath, const ModelImport::Data& data, const std::vector<std::shared_ptr<const TextureDecoder::DecodedImage>>& images)
+	{
+		const std::string packagePath = GetPackagePath(sourcePath);
+		const std::string tempPath = packagePath + ".tmp";
+
+		PackageHeader header{};
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.sourceHash = SourceDependencies::HashFile(sourcePath);
+		header.sourceSize = std::filesystem::file_size(sourcePath);
+
+		const auto dependencies = SourceDependencies::DescribeAll(sourcePath);
+		header.dependencyCount = dependencies.size();
+		header.dependencyTableOffset = AlignUp(sizeof(PackageHeader));
+		header.geometryOffset = AlignUp(header.dependencyTableOffset + dependencies.size() * sizeof(SourceDependencies::Entry));
+		header.textureCount = images.size();
+
+		{
+			std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!file.is_open())
+			{
+				throw std::runtime_error("Failed to open package for writing: " + tempPath);
+			}
+
+			// header is rewritten once the offsets are known
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			PadTo(file, header.dependencyTableOffset);
+			file.write(reinterpret_cast<const char*>(dependencies.data()), static_cast<std::streamsize>(dependencies.size() * sizeof(SourceDependencies::Entry)));
+			PadTo(file, header.geometryOffset);
+
+			const MeshCache::EntryKey key{ 0, 0, ModelImport::s_ImportOptions.GetImportFlags(), ModelImport::s_ImportOptions.GetProcessFlags() };
+			uint64_t geometrySize = MeshCache::WriteEntry(file, key, data);
+			if (geometrySize == 0)
+			{
+				throw std::runtime_error("Failed to write package geometry: " + tempPath);
+			}
+
+			header.textureTableOffset = AlignUp(header.geometryOffset + geometrySize);
+			std::vector<TextureEntry> entries(images.size());
+			uint64_t dataOffset = AlignUp(header.textureTableOffset + entries.size() * sizeof(TextureEntry));
+			for (size_t i = 0; i < images.size(); ++i)
+			{
+				const auto& image = *images[i];
+				entries[i] = { static_cast<uint32_t>(image.format), image.width, image.height, image.channels, image.mipLevels, image.blockBytes,
+					dataOffset, image.getSize() };
+				dataOffset = AlignUp(dataOffset + image.getSize());
+			}
+
+			PadTo(file, header.textureTableOffset);
+			file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(TextureEntry)));
+			for (size_t i = 0; i < images.size(); ++i)
+			{
+				PadTo(file, entries[i].dataOffset);
+				file.write(reinterpret_cast<const char*>(images[i]->pixels.get()), static_cast<std::streamsize>(entries[i].dataSize));
+			}
+
+			header.fileSize = static_cast<uint64_t>(file.tellp());
+			file.seekp(0);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			if (!file.good())
+			{
+				throw std::runtime_error("Failed to write package: " + tempPath);
+			}
+		}
+
+		// same temp file + rename as the mesh cache so a killed cooker never leaves a half written package behind
+		std::error_code ec;
+		std::filesystem::rename(tempPath, packagePath, ec);
+		if (ec)
+		{
+			throw std::runtime_error("Failed to finalize package " + packagePath + ": " + ec.message());
+		}
+		return header.fileSize;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "ModelImport.h"
+
+//std
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cve
+{
+	// Cooked, memory-mappable form of a scene written by the AssetCooker tool next to its source (Sponza.gltf -> Sponza.cvepkg).
+	// Holds a MeshCache entry with the processed geometry and material table plus every material texture with its full mip chain,
+	// so loading it needs no Assimp import, no image decoding and no mip blits. Bump VERSION whenever the layout changes.
+	class AssetPackage final
+	{
+	public:
+		static constexpr uint32_t VERSION = 3;
+		static constexpr const char* EXTENSION = ".cvepkg";
+
+		// false ignores packages and always imports the source files
+		static bool s_LoadPackages;
+
+		static std::string GetPackagePath(const std::string& sourcePath);
+
+		// returns false when there is no package or it is stale (scene, its buffers or images changed, other ImportOptions), the caller then imports the source
+		static bool Load(const std::string& sourcePath, ModelImport::DecodedModel& outModel);
+
+		// images are indexed like ModelImport::GatherTextureFiles returns them for data and may be shared with other scenes' packages,
+		// returns the package size in bytes
+		static uint64_t Write(const std::string& sourcePath, const ModelImport::Data& data, const std::vector<std::shared_ptr<const TextureDecoder::DecodedImage>>& images);
+	};
+}
@@ -0,0 +1,211 @@
+#include "GeometryArena.h"
+#include "Model.h"
+
+//std
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace cve
+{
+	namespace
+	{
+		constexpr const char* STREAM_NAMES[] = { "vertex", "index", "instance" };
+		static_assert(std::size(STREAM_NAMES) == static_cast<size_t>(GeometryArena::Stream::COUNT));
+
+		//buddy size the allocator would have taken for a buffer of its own, dedicated above BUDDY_MAX_SIZE
+		VkDeviceSize GetSeparateBufferSize(VkDeviceSize size)
+		{
+			if (size > MemoryAllocator::BUDDY_MAX_SIZE) return size;
+			return std::bit_ceil(std::max(size, MemoryAllocator::BUDDY_MIN_SIZE));
+		}
+	}
+
+	std::array<GeometryArena::Arena, static_cast<size_t>(GeometryArena::Stream::COUNT)> GeometryArena::s_Arenas{};
+	VkBuffer              GeometryArena::s_ColorBuffer            = VK_NULL_HANDLE;
+	MemoryAllocation      GeometryArena::s_ColorBufferMemory      = {};
+	VkBuffer              GeometryArena::s_WhiteColorBuffer       = VK_NULL_HANDLE;
+	MemoryAllocation      GeometryArena::s_WhiteColorBufferMemory = {};
+	bool                  GeometryArena::s_CompactLayout          = false;
+	GeometryArena::Stats  GeometryArena::s_Stats                  = {};
+
+	void GeometryArena::Init(Device& device)
+	{
+		auto& vertexArena = s_Arenas[static_cast<size_t>(Stream::Vertex)];
+		if (vertexArena.buffer != VK_NULL_HANDLE) return;
+
+		s_CompactLayout = Model::s_VertexLayout == Model::VertexLayout::Compact;
+		const VkDeviceSize strides[] = { s_CompactLayout ? sizeof(Model::CompactVertex) : sizeof(Model::Vertex), sizeof(uint32_t), sizeof(glm::mat4) };
+		const VkDeviceSize sizes[] = { VERTEX_ARENA_SIZE, INDEX_ARENA_SIZE, INSTANCE_ARENA_SIZE };
+		const VkBufferUsageFlags usages[] = { VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT };
+
+		for (size_t i = 0; i < s_Arenas.size(); ++i)
+		{
+			auto& arena = s_Arenas[i];
+			arena.stride = strides[i];
+			arena.capacity = static_cast<uint32_t>(sizes[i] / arena.stride);
+			device.createBuffer(
+				arena.capacity * arena.stride,
+				usages[i] | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				arena.buffer,
+				arena.memory,
+				true);
+			arena.freeRanges = { { 0, arena.capacity } };
+		}
+
+		if (s_CompactLayout)
+		{
+			//read with stride 0 by models without vertex colors, whatever their first vertex is
+			const uint32_t white = UINT32_MAX;
+			device.createBuffer(
+				sizeof(uint32_t),
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				s_WhiteColorBuffer,
+				s_WhiteColorBufferMemory,
+				true);
+			CopyToBuffer(device, s_WhiteColorBuffer, 0, &white, sizeof(uint32_t));
+		}
+		s_Stats = {};
+	}
+
+	void GeometryArena::Cleanup(Device& device)
+	{
+		for (auto& arena : s_Arenas)
+		{
+			if (arena.buffer != VK_NULL_HANDLE)
+			{
+				device.destroyBuffer(arena.buffer, arena.memory);
+			}
+			arena.freeRanges.clear();
+		}
+		if (s_ColorBuffer != VK_NULL_HANDLE)
+		{
+			device.destroyBuffer(s_ColorBuffer, s_ColorBufferMemory);
+		}
+		if (s_WhiteColorBuffer != VK_NULL_HANDLE)
+		{
+			device.destroyBuffer(s_WhiteColorBuffer, s_WhiteColorBufferMemory);
+		}
+		s_Stats = {};
+	}
+
+	uint32_t GeometryArena::Allocate(Device& device, Stream stream, const void* data, uint32_t count)
+	{
+		auto& arena = s_Arenas[static_cast<size_t>(stream)];
+		assert(arena.buffer != VK_NULL_HANDLE && "GeometryArena::Init was not called");
+		if (count == 0) return 0;
+
+		// first fit
+		auto range = std::find_if(arena.freeRanges.begin(), arena.freeRanges.end(), [count](const Range& r) { return r.count >= count; });
+		if (range == arena.freeRanges.end())
+		{
+			throw std::runtime_error(std::string("geometry arena is full (") + STREAM_NAMES[static_cast<size_t>(stream)] + " stream, " +
+				std::to_string((arena.capacity * arena.stride) >> 20) + " MB), can't add " + std::to_string(count) + " elements");
+		}
+		const uint32_t first = range->first;
+		range->first += count;
+		range->count -= count;
+		if (range->count == 0) arena.freeRanges.erase(range);
+
+		const VkDeviceSize size = arena.stride * count;
+		CopyToBuffer(device, arena.buffer, arena.stride * first, data, size);
+
+		++s_Stats.rangeCount;
+		s_Stats.usedBytes += size;
+		s_Stats.separateBytes += GetSeparateBufferSize(size);
+		return first;
+	}
+
+	void GeometryArena::Free(Stream stream, uint32_t first, uint32_t count)
+	{
+		// frees after Cleanup (models outliving the arena at shutdown) have nothing to return
+		auto& arena = s_Arenas[static_cast<size_t>(stream)];
+		if (count == 0 || arena.buffer == VK_NULL_HANDLE) return;
+
+		auto next = std::lower_bound(arena.freeRanges.begin(), arena.freeRanges.end(), first, [](const Range& r, uint32_t value) { return r.first < value; });
+		next = arena.freeRanges.insert(next, { first, count });
+		if (next + 1 != arena.freeRanges.end() && next->first + next->count == (next + 1)->first)
+		{
+			next->count += (next + 1)->count;
+			arena.freeRanges.erase(next + 1);
+		}
+		if (next != arena.freeRanges.begin() && (next - 1)->first + (next - 1)->count == next->first)
+		{
+			(next - 1)->count += next->count;
+			arena.freeRanges.erase(next);
+		}
+
+		const VkDeviceSize size = arena.stride * count;
+		--s_Stats.rangeCount;
+		s_Stats.usedBytes -= size;
+		s_Stats.separateBytes -= GetSeparateBufferSize(size);
+	}
+
+	void GeometryArena::WriteColors(Device& device, uint32_t firstVertex, const uint32_t* colors, uint32_t count)
+	{
+		assert(s_CompactLayout && "only the compact layout has a color stream");
+		if (s_ColorBuffer == VK_NULL_HANDLE)
+		{
+			const auto& vertexArena = s_Arenas[static_cast<size_t>(Stream::Vertex)];
+			device.createBuffer(
+				sizeof(uint32_t) * vertexArena.capacity,
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				s_ColorBuffer,
+				s_ColorBufferMemory,
+				true);
+		}
+
+		CopyToBuffer(device, s_ColorBuffer, sizeof(uint32_t) * firstVertex, colors, sizeof(uint32_t) * count);
+	}
+
+	void GeometryArena::Bind(VkCommandBuffer commandBuffer)
+	{
+		static_assert(Model::INSTANCE_BINDING == 2, "the compact bind below passes bindings 0..2 in one call");
+		const VkBuffer vertexBuffer = s_Arenas[static_cast<size_t>(Stream::Vertex)].buffer;
+		const VkBuffer instanceBuffer = s_Arenas[static_cast<size_t>(Stream::Instance)].buffer;
+		if (s_CompactLayout)
+		{
+			//the compact pipelines take the strides dynamically, see BindColorStream
+			VkBuffer buffers[] = { vertexBuffer, s_WhiteColorBuffer, instanceBuffer };
+			VkDeviceSize offsets[] = { 0, 0, 0 };
+			VkDeviceSize strides[] = { sizeof(Model::CompactVertex), 0, sizeof(glm::mat4) };
+			vkCmdBindVertexBuffers2(commandBuffer, 0, 3, buffers, offsets, nullptr, strides);
+		}
+		else
+		{
+			VkDeviceSize offsets[] = { 0 };
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, offsets);
+			vkCmdBindVertexBuffers(commandBuffer, Model::INSTANCE_BINDING, 1, &instanceBuffer, offsets);
+		}
+		vkCmdBindIndexBuffer(commandBuffer, s_Arenas[static_cast<size_t>(Stream::Index)].buffer, 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	void GeometryArena::BindColorStream(VkCommandBuffer commandBuffer, bool perVertex)
+	{
+		if (!s_CompactLayout) return;
+
+		VkBuffer buffer = perVertex ? s_ColorBuffer : s_WhiteColorBuffer;
+		VkDeviceSize offset = 0;
+		VkDeviceSize stride = perVertex ? sizeof(uint32_t) : 0;
+		vkCmdBindVertexBuffers2(commandBuffer, 1, 1, &buffer, &offset, nullptr, &stride);
+	}
+
+	void GeometryArena::CopyToBuffer(Device& device, VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size)
+	{
+		const StagingRing::Region staging = device.stagingRing().allocate(size);
+		std::memcpy(staging.mapped, data, static_cast<size_t>(size));
+
+		// ranges of other models stay untouched, so frames in flight reading them are not affected. The buffers are
+		// concurrent, there is no ownership to hand over and the batch's graphics half waits for the copy
+		VkCommandBuffer commandBuffer = device.beginTransferCommands();
+		VkBufferCopy region{ staging.offset, offset, size };
+		vkCmdCopyBuffer(commandBuffer, staging.buffer, buffer, 1, &region);
+		device.endTransferCommands(commandBuffer);
+	}
+}
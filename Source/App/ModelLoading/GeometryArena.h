@@ -0,0 +1,82 @@
+#pragma once
+#include "Device.h"
+
+//std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace cve
+{
+	// The vertices, indices and instance transforms of every model in one vertex, one index and one instance buffer, so a
+	// pass binds the geometry once instead of once per model. Each model gets a contiguous range of every stream and draws
+	// with its first vertex (vertexOffset), first index and first instance added, see Model::Draw. The compact layout's
+	// color stream shares the vertex ranges and is created with the first model that has vertex colors.
+	// The buffers are shared with the transfer queue, uploads into one range don't disturb frames reading the others.
+	// Fixed size like the MaterialTable, Allocate throws once a stream is full. Render thread only, Init/Cleanup alongside
+	// the MaterialTable, after Model::s_VertexLayout was picked.
+	class GeometryArena final
+	{
+	public:
+		static constexpr VkDeviceSize VERTEX_ARENA_SIZE = 128ull << 20;
+		static constexpr VkDeviceSize INDEX_ARENA_SIZE = 64ull << 20;
+		static constexpr VkDeviceSize INSTANCE_ARENA_SIZE = 4ull << 20;
+
+		enum class Stream : uint32_t
+		{
+			Vertex = 0,	//Model::Vertex or Model::CompactVertex, depending on the layout at Init
+			Index,		//uint32_t
+			Instance,	//glm::mat4
+			COUNT
+		};
+
+		struct Stats
+		{
+			uint32_t     rangeCount = 0;		//live ranges over all streams, the color stream is not counted
+			VkDeviceSize usedBytes = 0;			//bytes of the live ranges
+			VkDeviceSize separateBytes = 0;		//what the same ranges took as one buffer each, with the allocator's rounding
+		};
+
+		static void Init(Device& device);
+		static void Cleanup(Device& device);
+
+		// copies count elements into a free range of the stream, returns its first element
+		static uint32_t Allocate(Device& device, Stream stream, const void* data, uint32_t count);
+		static void Free(Stream stream, uint32_t first, uint32_t count);
+		// packed colors (compact layout) of the vertex range starting at firstVertex
+		static void WriteColors(Device& device, uint32_t firstVertex, const uint32_t* colors, uint32_t count);
+
+		// vertex, instance and index buffers plus the white color, once per pass
+		static void Bind(VkCommandBuffer commandBuffer);
+		// compact layout: switches binding 1 between the color stream and the white color (stride 0), no-op otherwise
+		static void BindColorStream(VkCommandBuffer commandBuffer, bool perVertex);
+
+		static const Stats& GetStats() { return s_Stats; }
+
+	private:
+		struct Range
+		{
+			uint32_t first;
+			uint32_t count;
+		};
+
+		struct Arena
+		{
+			VkBuffer           buffer = VK_NULL_HANDLE;
+			MemoryAllocation   memory{};
+			VkDeviceSize       stride = 0;
+			uint32_t           capacity = 0;	//elements
+			std::vector<Range> freeRanges;	//sorted by first, neighbours are merged on Free
+		};
+
+		static void CopyToBuffer(Device& device, VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size);
+
+		static std::array<Arena, static_cast<size_t>(Stream::COUNT)> s_Arenas;
+		static VkBuffer         s_ColorBuffer;
+		static MemoryAllocation s_ColorBufferMemory;
+		static VkBuffer         s_WhiteColorBuffer;
+		static MemoryAllocation s_WhiteColorBufferMemory;
+		static bool             s_CompactLayout;
+		static Stats            s_Stats;
+	};
+}
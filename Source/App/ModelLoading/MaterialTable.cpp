@@ -0,0 +1,170 @@
+#include "MaterialTable.h"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace cve
+{
+	VkBuffer              MaterialTable::s_Buffer        = VK_NULL_HANDLE;
+	MemoryAllocation      MaterialTable::s_BufferMemory  = {};
+	VkDescriptorSetLayout MaterialTable::s_SetLayout     = VK_NULL_HANDLE;
+	VkDescriptorPool      MaterialTable::s_Pool          = VK_NULL_HANDLE;
+	VkDescriptorSet       MaterialTable::s_DescriptorSet = VK_NULL_HANDLE;
+
+	std::vector<MaterialTable::Range> MaterialTable::s_FreeRanges;
+	uint32_t                          MaterialTable::s_MaterialCount = 0;
+
+	void MaterialTable::Init(Device& device)
+	{
+		if (s_Pool != VK_NULL_HANDLE) return;
+
+		device.createBuffer(
+			sizeof(GpuMaterial) * MAX_MATERIALS,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			s_Buffer,
+			s_BufferMemory);
+
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		binding.descriptorCount = 1;
+		binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+		if (vkCreateDescriptorSetLayout(device.device(), &layoutInfo, nullptr, &s_SetLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create material table set layout!");
+		}
+
+		VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 };
+		VkDescriptorPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		poolInfo.maxSets = 1;
+		if (vkCreateDescriptorPool(device.device(), &poolInfo, nullptr, &s_Pool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create material table pool!");
+		}
+
+		VkDescriptorSetAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+		allocInfo.descriptorPool = s_Pool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &s_SetLayout;
+		if (vkAllocateDescriptorSets(device.device(), &allocInfo, &s_DescriptorSet) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate material table set!");
+		}
+
+		// the whole buffer is bound once, rows are only ever written through transfers
+		VkDescriptorBufferInfo bufferInfo{ s_Buffer, 0, VK_WHOLE_SIZE };
+		VkWriteDescriptorSet write{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+		write.dstSet = s_DescriptorSet;
+		write.dstBinding = 0;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.pBufferInfo = &bufferInfo;
+		vkUpdateDescriptorSets(device.device(), 1, &write, 0, nullptr);
+
+		s_FreeRanges = { { 0, MAX_MATERIALS } };
+		s_MaterialCount = 0;
+	}
+
+	void MaterialTable::Cleanup(Device& device)
+	{
+		if (s_Pool != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorPool(device.device(), s_Pool, nullptr);
+			s_Pool = VK_NULL_HANDLE;
+		}
+		if (s_SetLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorSetLayout(device.device(), s_SetLayout, nullptr);
+			s_SetLayout = VK_NULL_HANDLE;
+		}
+		if (s_Buffer != VK_NULL_HANDLE)
+		{
+			device.destroyBuffer(s_Buffer, s_BufferMemory);
+		}
+		s_DescriptorSet = VK_NULL_HANDLE;
+		s_FreeRanges.clear();
+		s_MaterialCount = 0;
+	}
+
+	uint32_t MaterialTable::Allocate(Device& device, std::span<const Model::MaterialInfo> materials)
+	{
+		assert(s_Pool != VK_NULL_HANDLE && "MaterialTable::Init was not called");
+		if (materials.empty()) return 0;
+
+		// first fit
+		const uint32_t count = static_cast<uint32_t>(materials.size());
+		auto range = std::find_if(s_FreeRanges.begin(), s_FreeRanges.end(), [count](const Range& r) { return r.count >= count; });
+		if (range == s_FreeRanges.end())
+		{
+			throw std::runtime_error("material table is full (" + std::to_string(MAX_MATERIALS) + " materials), can't add " + std::to_string(count));
+		}
+		const uint32_t first = range->first;
+		range->first += count;
+		range->count -= count;
+		if (range->count == 0) s_FreeRanges.erase(range);
+
+		std::vector<GpuMaterial> rows(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const auto& mi = materials[i];
+			rows[i] = { mi.baseColorFactor, mi.metallicFactor, mi.roughnessFactor, mi.occlusionStrength,
+				mi.baseColorIndex, mi.metallicRoughIndex, mi.normalIndex, mi.occlusionIndex, 0 };
+		}
+
+		const VkDeviceSize size = sizeof(GpuMaterial) * count;
+		const StagingRing::Region staging = device.stagingRing().allocate(size);
+		std::memcpy(staging.mapped, rows.data(), static_cast<size_t>(size));
+
+		// rows of other models stay untouched, so frames in flight reading them are not affected
+		VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+		VkBufferCopy region{ staging.offset, sizeof(GpuMaterial) * first, size };
+		vkCmdCopyBuffer(commandBuffer, staging.buffer, s_Buffer, 1, &region);
+		device.endSingleTimeCommands(commandBuffer);
+
+		s_MaterialCount += count;
+		return first;
+	}
+
+	void MaterialTable::Free(uint32_t first, uint32_t count)
+	{
+		// frees after Cleanup (models outliving the table at shutdown) have nothing to return
+		if (count == 0 || s_Pool == VK_NULL_HANDLE) return;
+
+		auto next = std::lower_bound(s_FreeRanges.begin(), s_FreeRanges.end(), first, [](const Range& r, uint32_t value) { return r.first < value; });
+		next = s_FreeRanges.insert(next, { first, count });
+		if (next + 1 != s_FreeRanges.end() && next->first + next->count == (next + 1)->first)
+		{
+			next->count += (next + 1)->count;
+			s_FreeRanges.erase(next + 1);
+		}
+		if (next != s_FreeRanges.begin() && (next - 1)->first + (next - 1)->count == next->first)
+		{
+			(next - 1)->count += next->count;
+			s_FreeRanges.erase(next);
+		}
+		s_MaterialCount -= count;
+	}
+
+	void MaterialTable::Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout)
+	{
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			pipelineLayout,
+			1, 1,
+			&s_DescriptorSet,
+			0, nullptr
+		);
+	}
+}
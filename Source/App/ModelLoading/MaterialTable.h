@@ -0,0 +1,66 @@
+#pragma once
+#include "Device.h"
+#include "Model.h"
+
+//libs
+#include <glm\glm.hpp>
+
+//std
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace cve
+{
+	// Every loaded material in one device local storage buffer (set 1, binding 0), so a draw only needs the index of its material
+	// instead of pushing texture indices and factors. Each model gets a contiguous range, Model::GetFirstMaterial() + the
+	// submesh material index is the row the shaders read. Render thread only, Init/Cleanup alongside TextureRegistry.
+	class MaterialTable final
+	{
+	public:
+		static constexpr uint32_t MAX_MATERIALS = 4096;
+		static constexpr uint32_t INVALID_RANGE = UINT32_MAX;
+
+		// std430 row, mirrors the Material struct in the shaders
+		struct GpuMaterial
+		{
+			glm::vec4 baseColorFactor;
+			float     metallicFactor;
+			float     roughnessFactor;
+			float     occlusionStrength;
+			uint32_t  baseColorIndex;	//TextureRegistry slots, UINT32_MAX when the material has no such texture
+			uint32_t  metallicRoughIndex;
+			uint32_t  normalIndex;
+			uint32_t  occlusionIndex;
+			uint32_t  padding;
+		};
+		static_assert(sizeof(GpuMaterial) == 48, "GpuMaterial has to match the std430 layout in the shaders");
+
+		static void Init(Device& device);
+		static void Cleanup(Device& device);
+
+		// copies the materials (with their texture indices already remapped to registry slots) into a free range, returns its first row
+		static uint32_t Allocate(Device& device, std::span<const Model::MaterialInfo> materials);
+		static void Free(uint32_t first, uint32_t count);
+
+		static uint32_t GetMaterialCount() { return s_MaterialCount; }
+		static VkDescriptorSetLayout GetSetLayout() { return s_SetLayout; }
+		static void Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout);
+
+	private:
+		struct Range
+		{
+			uint32_t first;
+			uint32_t count;
+		};
+
+		static VkBuffer              s_Buffer;
+		static MemoryAllocation      s_BufferMemory;
+		static VkDescriptorSetLayout s_SetLayout;
+		static VkDescriptorPool      s_Pool;
+		static VkDescriptorSet       s_DescriptorSet;
+
+		static std::vector<Range> s_FreeRanges;	//sorted by first, neighbours are merged on Free
+		static uint32_t           s_MaterialCount;
+	};
+}
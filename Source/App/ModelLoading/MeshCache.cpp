@@ -0,0 +1,392 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "SourceDependencies.h"
+#include "Utils.h"
+
+//std
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace cve
+{
+	namespace
+	{
+		constexpr char     MAGIC[4] = { 'C', 'V', 'E', 'M' };
+		constexpr uint64_t ALIGNMENT = 16;
+
+		struct CacheHeader
+		{
+			char     magic[4];
+			uint32_t version;
+			uint64_t sourcePathHash;
+			int64_t  sourceWriteTime;
+			uint32_t importFlags;
+			uint32_t processFlags;
+			uint32_t vertexStride;
+			uint32_t padding;
+			uint64_t vertexCount;
+			uint64_t indexCount;
+			uint64_t submeshCount;
+			uint64_t meshletCount;
+			uint64_t instanceCount;
+			uint64_t materialCount;
+			uint64_t dependencyCount;	//files the scene references, 0 for entries inside a package which keeps its own table
+			uint64_t vertexOffset;
+			uint64_t indexOffset;
+			uint64_t submeshOffset;
+			uint64_t meshletOffset;
+			uint64_t instanceOffset;
+			uint64_t dependencyOffset;
+			uint64_t materialOffset;
+			uint64_t entrySize;
+		};
+
+		uint64_t AlignUp(uint64_t value)
+		{
+			return (value + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+		}
+
+		uint64_t HashSourcePath(const std::string& sourcePath)
+		{
+			return hashFNV1a(std::filesystem::absolute(sourcePath).lexically_normal().generic_string());
+		}
+
+		int64_t GetWriteTime(const std::string& sourcePath)
+		{
+			return static_cast<int64_t>(std::filesystem::last_write_time(sourcePath).time_since_epoch().count());
+		}
+
+		// count elements of elementSize at offset fit in size, divides instead of multiplying so a corrupt count can't wrap
+		bool ArrayFits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t size)
+		{
+			return offset <= size && count <= (size - offset) / elementSize;
+		}
+
+		bool RangeFits(uint32_t first, uint32_t count, uint64_t size)
+		{
+			return first <= size && count <= size - first;
+		}
+
+		// the renderer indexes with every range below without checks, so a corrupt entry is rejected here instead
+		bool ValidateGeometry(std::span<const ModelImport::SubMesh> submeshes, std::span<const MeshOptimizer::Meshlet> meshlets,
+			std::span<const uint32_t> indices, uint64_t vertexCount, uint64_t instanceCount, uint64_t materialCount)
+		{
+			for (const auto& meshlet : meshlets)
+			{
+				if (!RangeFits(meshlet.firstIndex, meshlet.indexCount, indices.size())) return false;
+			}
+			for (const auto& sm : submeshes)
+			{
+				if (sm.materialIndex >= materialCount ||
+					sm.lodCount > ModelImport::MAX_LOD_COUNT - 1 ||
+					!RangeFits(sm.firstInstance, sm.instanceCount, instanceCount))
+				{
+					return false;
+				}
+				for (uint32_t level = 0; level < sm.GetLevelCount(); ++level)
+				{
+					const ModelImport::Lod lod = sm.GetLod(level);
+					if (!RangeFits(lod.firstIndex, lod.indexCount, indices.size()) ||
+						!RangeFits(lod.firstMeshlet, lod.meshletCount, meshlets.size()))
+					{
+						return false;
+					}
+				}
+			}
+			uint32_t maxIndex = 0;
+			for (uint32_t index : indices) maxIndex = std::max(maxIndex, index);
+			return indices.empty() || maxIndex < vertexCount;
+		}
+
+		void WriteString(std::vector<char>& out, const std::string& text)
+		{
+			uint32_t length = static_cast<uint32_t>(text.size());
+			out.insert(out.end(), reinterpret_cast<const char*>(&length), reinterpret_cast<const char*>(&length) + sizeof(length));
+			out.insert(out.end(), text.begin(), text.end());
+		}
+
+		template <typename T>
+		void WriteValue(std::vector<char>& out, const T& value)
+		{
+			out.insert(out.end(), reinterpret_cast<const char*>(&value), reinterpret_cast<const char*>(&value) + sizeof(T));
+		}
+
+		// bounds checked reader over the mapped material table
+		struct Reader
+		{
+			const std::byte* cursor;
+			const std::byte* end;
+
+			template <typename T>
+			bool Read(T& value)
+			{
+				if (sizeof(T) > static_cast<size_t>(end - cursor)) return false;
+				std::memcpy(&value, cursor, sizeof(T));
+				cursor += sizeof(T);
+				return true;
+			}
+
+			bool Read(std::string& text)
+			{
+				uint32_t length = 0;
+				if (!Read(length) || length > static_cast<size_t>(end - cursor)) return false;
+				text.assign(reinterpret_cast<const char*>(cursor), length);
+				cursor += length;
+				return true;
+			}
+		};
+	}
+
+	std::string MeshCache::GetCachePath(const std::string& sourcePath, uint32_t importFlags, uint32_t processFlags)
+	{
+		// the flags are part of the name so every option set keeps its own entry instead of overwriting a shared one
+		uint64_t hash = hashFNV1a(&importFlags, sizeof(importFlags), HashSourcePath(sourcePath));
+		hash = hashFNV1a(&processFlags, sizeof(processFlags), hash);
+
+		std::ostringstream name;
+		name << CACHE_DIRECTORY << "/"
+			<< std::filesystem::path(sourcePath).stem().string() << "_"
+			<< std::hex << std::setw(16) << std::setfill('0') << hash
+			<< ".cvemesh";
+		return name.str();
+	}
+
+	bool MeshCache::Load(const std::string& sourcePath, uint32_t importFlags, uint32_t processFlags, ModelImport::Data& outData)
+	{
+		const std::string cachePath = GetCachePath(sourcePath, importFlags, processFlags);
+		if (!std::filesystem::exists(cachePath) || !std::filesystem::exists(sourcePath)) return false;
+
+		auto file = std::make_shared<MappedFile>(cachePath);
+		if (!file->IsValid()) return false;
+
+		return ReadEntry(std::move(file), 0, { HashSourcePath(sourcePath), GetWriteTime(sourcePath), importFlags, processFlags, sourcePath }, outData);
+	}
+
+	bool MeshCache::ReadEntry(std::shared_ptr<MappedFile> file, uint64_t offset, const EntryKey& key, ModelImport::Data& outData)
+	{
+		if (offset % ALIGNMENT != 0 || !ArrayFits(offset, 1, sizeof(CacheHeader), file->GetSize())) return false;
+
+		CacheHeader header{};
+		std::memcpy(&header, file->GetData() + offset, sizeof(CacheHeader));
+
+		if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+			header.version != VERSION ||
+			header.vertexStride != sizeof(ModelImport::Vertex) ||
+			header.importFlags != key.importFlags ||
+			header.processFlags != key.processFlags ||
+			header.sourcePathHash != key.sourcePathHash ||
+			header.sourceWriteTime != key.sourceWriteTime ||
+			header.entrySize > file->GetSize() - offset)
+		{
+			return false;
+		}
+
+		// a material is at least its four string lengths and the factors
+		constexpr uint64_t MIN_MATERIAL_BYTES = 4 * sizeof(uint32_t) + sizeof(glm::vec4) + 3 * sizeof(float) + sizeof(bool);
+		const uint64_t offsets = header.vertexOffset | header.indexOffset | header.submeshOffset | header.meshletOffset |
+			header.instanceOffset | header.dependencyOffset;
+		if (offsets % ALIGNMENT != 0 ||
+			!ArrayFits(header.vertexOffset, header.vertexCount, sizeof(ModelImport::Vertex), header.entrySize) ||
+			!ArrayFits(header.indexOffset, header.indexCount, sizeof(uint32_t), header.entrySize) ||
+			!ArrayFits(header.submeshOffset, header.submeshCount, sizeof(ModelImport::SubMesh), header.entrySize) ||
+			!ArrayFits(header.meshletOffset, header.meshletCount, sizeof(MeshOptimizer::Meshlet), header.entrySize) ||
+			!ArrayFits(header.instanceOffset, header.instanceCount, sizeof(glm::mat4), header.entrySize) ||
+			!ArrayFits(header.dependencyOffset, header.dependencyCount, sizeof(SourceDependencies::Entry), header.entrySize) ||
+			!ArrayFits(header.materialOffset, header.materialCount, MIN_MATERIAL_BYTES, header.entrySize))
+		{
+			return false;
+		}
+
+		// the .bin buffers the geometry came from can change without touching the scene file
+		if (!key.sourcePath.empty() &&
+			!SourceDependencies::Match(key.sourcePath, file->GetSpan<SourceDependencies::Entry>(offset + header.dependencyOffset, header.dependencyCount)))
+		{
+			std::cout << "[MeshCache] " << std::filesystem::path(key.sourcePath).filename().string() << ": a referenced buffer or image changed, importing the source" << std::endl;
+			return false;
+		}
+
+		// materials hold strings so they are parsed, geometry stays in the mapping
+		std::vector<ModelImport::MaterialInfo> materials(header.materialCount);
+		Reader reader{ file->GetData() + offset + header.materialOffset, file->GetData() + offset + header.entrySize };
+		for (auto& mi : materials)
+		{
+			if (!reader.Read(mi.baseColorTex) || !reader.Read(mi.normalTex) ||
+				!reader.Read(mi.metallicRoughTex) || !reader.Read(mi.occlusionTex) ||
+				!reader.Read(mi.baseColorFactor) || !reader.Read(mi.metallicFactor) ||
+				!reader.Read(mi.roughnessFactor) || !reader.Read(mi.occlusionStrength) ||
+				!reader.Read(mi.doubleSided))
+			{
+				return false;
+			}
+		}
+
+		auto submeshes = file->GetSpan<ModelImport::SubMesh>(offset + header.submeshOffset, header.submeshCount);
+		auto meshlets = file->GetSpan<MeshOptimizer::Meshlet>(offset + header.meshletOffset, header.meshletCount);
+		auto instances = file->GetSpan<glm::mat4>(offset + header.instanceOffset, header.instanceCount);
+		auto vertices = file->GetSpan<ModelImport::Vertex>(offset + header.vertexOffset, header.vertexCount);
+		auto indices = file->GetSpan<uint32_t>(offset + header.indexOffset, header.indexCount);
+		if (!ValidateGeometry(submeshes, meshlets, indices, header.vertexCount, header.instanceCount, header.materialCount))
+		{
+			std::cerr << "[MeshCache] entry has out of range submeshes or indices, ignoring it" << std::endl;
+			return false;
+		}
+
+		outData.materials = std::move(materials);
+		outData.submeshes.assign(submeshes.begin(), submeshes.end());
+		outData.meshlets.assign(meshlets.begin(), meshlets.end());
+		outData.instanceTransforms.assign(instances.begin(), instances.end());
+		outData.vertices.clear();
+		outData.indices.clear();
+		outData.vertexSpan = vertices;
+		outData.indexSpan = indices;
+		outData.mappedGeometry = std::move(file);
+		return true;
+	}
+
+	void MeshCache::Write(const std::string& sourcePath, uint32_t importFlags, uint32_t processFlags, const ModelImport::Data& data)
+	{
+		const std::string cachePath = GetCachePath(sourcePath, importFlags, processFlags);
+		const std::string tempPath = cachePath + ".tmp";
+		std::error_code ec;
+		std::filesystem::create_directories(CACHE_DIRECTORY, ec);
+
+		{
+			std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!file.is_open() || WriteEntry(file, { HashSourcePath(sourcePath), GetWriteTime(sourcePath), importFlags, processFlags, sourcePath }, data) == 0)
+			{
+				std::cerr << "[MeshCache] could not write " << tempPath << std::endl;
+				return;
+			}
+		}
+
+		// write to a temp file first so a crash mid-write never leaves a half valid entry behind
+		std::filesystem::rename(tempPath, cachePath, ec);
+		if (ec)
+		{
+			std::cerr << "[MeshCache] could not finalize " << cachePath << ": " << ec.message() << std::endl;
+		}
+	}
+
+	uint64_t MeshCache::WriteEntry(std::ostream& out, const EntryKey& key, const ModelImport::Data& data)
+	{
+		auto vertices = data.GetVertices();
+		auto indices = data.GetIndices();
+
+		CacheHeader header{};
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.sourcePathHash = key.sourcePathHash;
+		header.sourceWriteTime = key.sourceWriteTime;
+		header.importFlags = key.importFlags;
+		header.processFlags = key.processFlags;
+		header.vertexStride = sizeof(ModelImport::Vertex);
+		header.vertexCount = vertices.size();
+		header.indexCount = indices.size();
+		header.submeshCount = data.submeshes.size();
+		header.meshletCount = data.meshlets.size();
+		header.instanceCount = data.instanceTransforms.size();
+		header.materialCount = data.materials.size();
+
+		std::vector<SourceDependencies::Entry> dependencies;
+		if (!key.sourcePath.empty()) dependencies = SourceDependencies::DescribeAll(key.sourcePath);
+		header.dependencyCount = dependencies.size();
+
+		// offsets are relative to the start of the entry
+		header.vertexOffset = AlignUp(sizeof(CacheHeader));
+		header.indexOffset = AlignUp(header.vertexOffset + vertices.size_bytes());
+		header.submeshOffset = AlignUp(header.indexOffset + indices.size_bytes());
+		header.meshletOffset = AlignUp(header.submeshOffset + data.submeshes.size() * sizeof(ModelImport::SubMesh));
+		header.instanceOffset = AlignUp(header.meshletOffset + data.meshlets.size() * sizeof(MeshOptimizer::Meshlet));
+		header.dependencyOffset = AlignUp(header.instanceOffset + data.instanceTransforms.size() * sizeof(glm::mat4));
+		header.materialOffset = AlignUp(header.dependencyOffset + dependencies.size() * sizeof(SourceDependencies::Entry));
+
+		std::vector<char> materialTable;
+		for (const auto& mi : data.materials)
+		{
+			WriteString(materialTable, mi.baseColorTex);
+			WriteString(materialTable, mi.normalTex);
+			WriteString(materialTable, mi.metallicRoughTex);
+			WriteString(materialTable, mi.occlusionTex);
+			WriteValue(materialTable, mi.baseColorFactor);
+			WriteValue(materialTable, mi.metallicFactor);
+			WriteValue(materialTable, mi.roughnessFactor);
+			WriteValue(materialTable, mi.occlusionStrength);
+			WriteValue(materialTable, mi.doubleSided);
+		}
+		header.entrySize = header.materialOffset + materialTable.size();
+
+		const uint64_t start = static_cast<uint64_t>(out.tellp());
+		if (start % ALIGNMENT != 0) return 0;
+
+		auto writeAt = [&](uint64_t offset, const void* bytes, size_t size)
+		{
+			static const char zeros[ALIGNMENT]{};
+			uint64_t pos = static_cast<uint64_t>(out.tellp()) - start;
+			out.write(zeros, static_cast<std::streamsize>(offset - pos));
+			out.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+		};
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		writeAt(header.vertexOffset, vertices.data(), vertices.size_bytes());
+		writeAt(header.indexOffset, indices.data(), indices.size_bytes());
+		writeAt(header.submeshOffset, data.submeshes.data(), data.submeshes.size() * sizeof(ModelImport::SubMesh));
+		writeAt(header.meshletOffset, data.meshlets.data(), data.meshlets.size() * sizeof(MeshOptimizer::Meshlet));
+		writeAt(header.instanceOffset, data.instanceTransforms.data(), data.instanceTransforms.size() * sizeof(glm::mat4));
+		writeAt(header.dependencyOffset, dependencies.data(), dependencies.size() * sizeof(SourceDependencies::Entry));
+		writeAt(header.materialOffset, materialTable.data(), materialTable.size());
+		return out.good() ? header.entrySize : 0;
+	}
+
+	void MeshCache::RunStartupBenchmark(const std::vector<std::string>& scenes)
+	{
+		using clock = std::chrono::high_resolution_clock;
+		auto toMs = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+		std::cout << std::fixed << std::setprecision(2);
+		std::cout << "scene                          cold (ms)   warm (ms)   speedup   cache (MB)" << std::endl;
+
+		for (const auto& scene : scenes)
+		{
+			if (!std::filesystem::exists(scene))
+			{
+				std::cout << scene << ": not found, skipped" << std::endl;
+				continue;
+			}
+
+			const std::string cachePath = GetCachePath(scene, ModelImport::s_ImportOptions.GetImportFlags(), ModelImport::s_ImportOptions.GetProcessFlags());
+			std::error_code ec;
+			std::filesystem::remove(cachePath, ec);
+
+			// cold: Assimp import, import processing and writing the cache entry, which is what the first launch pays
+			auto start = clock::now();
+			ModelImport::LoadData(scene);
+			double coldMs = toMs(clock::now() - start);
+
+			// warm: map the entry and touch every page, the upload memcpy would fault them in anyway
+			start = clock::now();
+			ModelImport::Data warm{};
+			if (!Load(scene, ModelImport::s_ImportOptions.GetImportFlags(), ModelImport::s_ImportOptions.GetProcessFlags(), warm))
+			{
+				std::cout << scene << ": cache entry was not accepted after writing it" << std::endl;
+				continue;
+			}
+			uint64_t checksum = hashFNV1a(warm.GetVertices().data(), warm.GetVertices().size_bytes());
+			checksum = hashFNV1a(warm.GetIndices().data(), warm.GetIndices().size_bytes(), checksum);
+			double warmMs = toMs(clock::now() - start);
+
+			double cacheMb = static_cast<double>(std::filesystem::file_size(cachePath)) / (1024.0 * 1024.0);
+			std::cout << std::left << std::setw(30) << std::filesystem::path(scene).filename().string() << std::right
+				<< std::setw(10) << coldMs
+				<< std::setw(12) << warmMs
+				<< std::setw(9) << coldMs / std::max(warmMs, 0.001) << "x"
+				<< std::setw(12) << cacheMb
+				<< "   (checksum " << std::hex << checksum << std::dec << ")" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "ModelImport.h"
+
+//std
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace cve
+{
+	// Binary, memory-mappable snapshot of ModelImport::Data written after the first Assimp import.
+	// Entries are keyed by source path, source mtime, Assimp import flags and ModelImport::ImportOptions process flags, and record the files the
+	// scene references (SourceDependencies) so a re-exported .bin invalidates them too; bump VERSION whenever the layout changes.
+	class MeshCache final
+	{
+	public:
+		static constexpr uint32_t VERSION = 6;
+		static constexpr const char* CACHE_DIRECTORY = "Cache";
+
+		// returns false when there is no valid entry, the caller then falls back to ModelImport::Data::LoadModel
+		static bool Load(const std::string& sourcePath, uint32_t importFlags, uint32_t processFlags, ModelImport::Data& outData);
+		static void Write(const std::string& sourcePath, uint32_t importFlags, uint32_t processFlags, const ModelImport::Data& data);
+		// one file per source and flag set: Cache/<stem>_<hash of path and flags>.cvemesh
+		static std::string GetCachePath(const std::string& sourcePath, uint32_t importFlags, uint32_t processFlags);
+
+		// what an entry must match to be accepted, AssetPackage leaves the source fields at 0 since it checks the source itself
+		struct EntryKey
+		{
+			uint64_t sourcePathHash = 0;
+			int64_t  sourceWriteTime = 0;
+			uint32_t importFlags = 0;
+			uint32_t processFlags = 0;
+			std::string sourcePath;	//scene whose referenced files the entry records and is checked against, empty for package entries
+		};
+
+		// entry at byte offset inside file (16 byte aligned), geometry spans keep the mapping alive
+		static bool ReadEntry(std::shared_ptr<MappedFile> file, uint64_t offset, const EntryKey& key, ModelImport::Data& outData);
+		// writes an entry at the current stream position (16 byte aligned) and returns its size, 0 on failure
+		static uint64_t WriteEntry(std::ostream& out, const EntryKey& key, const ModelImport::Data& data);
+
+		// times a cold Assimp import against a warm cache load for every scene, needs no Vulkan device
+		static void RunStartupBenchmark(const std::vector<std::string>& scenes);
+	};
+}
@@ -0,0 +1,709 @@
+#include "MeshOptimizer.h"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <tuple>
+
+namespace cve
+{
+	namespace
+	{
+		// tuning values from Forsyth's paper
+		constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+		constexpr float    CACHE_DECAY_POWER = 1.5f;
+		constexpr float    LAST_TRI_SCORE = 0.75f;
+		constexpr float    VALENCE_BOOST_SCALE = 2.0f;
+		constexpr float    VALENCE_BOOST_POWER = 0.5f;
+
+		constexpr uint32_t OVERDRAW_CACHE_SIZE = 16;
+
+		float VertexScore(int cachePosition, uint32_t remainingTriangles)
+		{
+			if (remainingTriangles == 0) return -1.0f;
+
+			float score = 0.0f;
+			if (cachePosition >= 0)
+			{
+				// the last triangle's vertices get a fixed score so the next triangle does not just reuse the same edge
+				score = cachePosition < 3
+					? LAST_TRI_SCORE
+					: std::pow(1.0f - float(cachePosition - 3) / float(FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+			}
+
+			// favour vertices with few triangles left so they get finished off instead of left behind
+			score += VALENCE_BOOST_SCALE * std::pow(float(remainingTriangles), -VALENCE_BOOST_POWER);
+			return score;
+		}
+
+		// maps the global vertex ids used by an index range onto 0..n-1, returns n
+		uint32_t BuildLocalIds(std::span<const uint32_t> indices, std::vector<uint32_t>& outLocal)
+		{
+			auto [minIt, maxIt] = std::minmax_element(indices.begin(), indices.end());
+			std::vector<uint32_t> table(size_t(*maxIt - *minIt) + 1, UINT32_MAX);
+
+			uint32_t count = 0;
+			outLocal.resize(indices.size());
+			for (size_t i = 0; i < indices.size(); ++i)
+			{
+				uint32_t& id = table[indices[i] - *minIt];
+				if (id == UINT32_MAX) id = count++;
+				outLocal[i] = id;
+			}
+			return count;
+		}
+
+		// FIFO post-transform cache model, a vertex hits while fewer than size misses happened since it was loaded
+		struct FifoCache
+		{
+			std::vector<uint32_t> stamps;
+			uint32_t size;
+			uint32_t time;
+
+			FifoCache(size_t vertexCount, uint32_t cacheSize)
+				:stamps(vertexCount, 0), size{cacheSize}, time{cacheSize + 1}
+			{
+			}
+
+			uint32_t Touch(uint32_t vertex)
+			{
+				if (time - stamps[vertex] < size) return 0;
+				stamps[vertex] = time++;
+				return 1;
+			}
+
+			void Reset() { time += size + 1; }
+		};
+
+		struct Float3
+		{
+			float x, y, z;
+
+			Float3 operator+(const Float3& o) const { return { x + o.x, y + o.y, z + o.z }; }
+			Float3 operator-(const Float3& o) const { return { x - o.x, y - o.y, z - o.z }; }
+			Float3 operator*(float s) const { return { x * s, y * s, z * s }; }
+		};
+
+		float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		Float3 Cross(const Float3& a, const Float3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+
+		// area weighted sum of squared distances to the planes of the triangles around a vertex (Garland & Heckbert)
+		struct Quadric
+		{
+			double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+			double b0 = 0, b1 = 0, b2 = 0;
+			double c = 0;
+			double weight = 0;
+
+			void AddPlane(const Float3& n, float d, float w)
+			{
+				a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+				a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+				b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+				c += w * d * d;
+				weight += w;
+			}
+
+			Quadric& operator+=(const Quadric& o)
+			{
+				a00 += o.a00; a01 += o.a01; a02 += o.a02; a11 += o.a11; a12 += o.a12; a22 += o.a22;
+				b0 += o.b0; b1 += o.b1; b2 += o.b2;
+				c += o.c;
+				weight += o.weight;
+				return *this;
+			}
+
+			// mean squared distance of p to the accumulated planes
+			float Error(const Float3& p) const
+			{
+				double e = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+					+ 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+					+ 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z)
+					+ c;
+				return weight > 0.0 ? float(std::max(e, 0.0) / weight) : 0.0f;
+			}
+		};
+	}
+
+	void MeshOptimizer::OptimizeVertexCache(std::span<uint32_t> indices)
+	{
+		assert(indices.size() % 3 == 0 && "index range must hold whole triangles");
+		const size_t triangleCount = indices.size() / 3;
+		if (triangleCount < 2) return;
+
+		std::vector<uint32_t> local;
+		const uint32_t vertexCount = BuildLocalIds(indices, local);
+
+		// per vertex list of the triangles that still need to be emitted, [offset, offset + remaining)
+		std::vector<uint32_t> remaining(vertexCount, 0);
+		for (uint32_t v : local) ++remaining[v];
+
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		std::inclusive_scan(remaining.begin(), remaining.end(), offsets.begin() + 1);
+
+		std::vector<uint32_t> adjacency(local.size());
+		{
+			std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < local.size(); ++i)
+			{
+				adjacency[cursor[local[i]]++] = uint32_t(i / 3);
+			}
+		}
+
+		std::vector<int>   cachePosition(vertexCount, -1);
+		std::vector<float> vertexScore(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			vertexScore[v] = VertexScore(-1, remaining[v]);
+		}
+
+		std::vector<float> triangleScore(triangleCount);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			triangleScore[t] = vertexScore[local[t * 3]] + vertexScore[local[t * 3 + 1]] + vertexScore[local[t * 3 + 2]];
+		}
+
+		std::vector<bool>     emitted(triangleCount, false);
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+
+		std::vector<uint32_t> cache, newCache;
+		cache.reserve(FORSYTH_CACHE_SIZE + 3);
+		newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+		int64_t bestTriangle = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+		size_t  scanCursor = 0;
+
+		while (output.size() < indices.size())
+		{
+			// nothing in the cache touches a live triangle, continue with the next unemitted one in input order
+			if (bestTriangle < 0)
+			{
+				while (emitted[scanCursor]) ++scanCursor;
+				bestTriangle = int64_t(scanCursor);
+			}
+
+			const size_t t = size_t(bestTriangle);
+			emitted[t] = true;
+			for (size_t k = 0; k < 3; ++k)
+			{
+				output.push_back(indices[t * 3 + k]);
+
+				uint32_t v = local[t * 3 + k];
+				uint32_t* begin = adjacency.data() + offsets[v];
+				uint32_t* last = begin + remaining[v] - 1;
+				*std::find(begin, last + 1, uint32_t(t)) = *last;
+				--remaining[v];
+			}
+
+			// the emitted triangle moves to the front of the cache, everything else shifts back
+			newCache.clear();
+			for (size_t k = 0; k < 3; ++k)
+			{
+				uint32_t v = local[t * 3 + k];
+				if (std::find(newCache.begin(), newCache.end(), v) == newCache.end()) newCache.push_back(v);
+			}
+			const size_t triangleVertices = newCache.size();
+			for (uint32_t v : cache)
+			{
+				if (std::find(newCache.begin(), newCache.begin() + triangleVertices, v) == newCache.begin() + triangleVertices)
+				{
+					newCache.push_back(v);
+				}
+			}
+
+			for (size_t i = 0; i < newCache.size(); ++i)
+			{
+				uint32_t v = newCache[i];
+				cachePosition[v] = i < FORSYTH_CACHE_SIZE ? int(i) : -1;
+				vertexScore[v] = VertexScore(cachePosition[v], remaining[v]);
+			}
+
+			// only triangles around vertices whose score changed need a new score
+			bestTriangle = -1;
+			float bestScore = -1.0f;
+			for (uint32_t v : newCache)
+			{
+				for (uint32_t i = offsets[v]; i < offsets[v] + remaining[v]; ++i)
+				{
+					uint32_t tri = adjacency[i];
+					float score = vertexScore[local[tri * 3]] + vertexScore[local[tri * 3 + 1]] + vertexScore[local[tri * 3 + 2]];
+					triangleScore[tri] = score;
+					if (score > bestScore)
+					{
+						bestScore = score;
+						bestTriangle = tri;
+					}
+				}
+			}
+
+			newCache.resize(std::min<size_t>(newCache.size(), FORSYTH_CACHE_SIZE));
+			std::swap(cache, newCache);
+		}
+
+		std::copy(output.begin(), output.end(), indices.begin());
+	}
+
+	void MeshOptimizer::OptimizeOverdraw(std::span<uint32_t> indices, const float* positions, std::size_t positionStride, float threshold)
+	{
+		assert(indices.size() % 3 == 0 && "index range must hold whole triangles");
+		const size_t triangleCount = indices.size() / 3;
+		if (triangleCount < 4) return;
+
+		auto position = [&](uint32_t vertex)
+		{
+			const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * positionStride);
+			return Float3{ p[0], p[1], p[2] };
+		};
+
+		std::vector<uint32_t> local;
+		const uint32_t vertexCount = BuildLocalIds(indices, local);
+		FifoCache cache{ vertexCount, OVERDRAW_CACHE_SIZE };
+
+		auto triangleMisses = [&](size_t t)
+		{
+			return cache.Touch(local[t * 3]) + cache.Touch(local[t * 3 + 1]) + cache.Touch(local[t * 3 + 2]);
+		};
+
+		// hard boundaries: a triangle that misses on all three vertices starts over anyway, cutting there costs nothing
+		std::vector<size_t> hardClusters;
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			if (triangleMisses(t) == 3 || t == 0) hardClusters.push_back(t);
+		}
+		hardClusters.push_back(triangleCount);
+
+		// soft boundaries: split a hard cluster further wherever its running ACMR is already within threshold of the whole cluster
+		std::vector<size_t> clusters;
+		for (size_t c = 0; c + 1 < hardClusters.size(); ++c)
+		{
+			const size_t begin = hardClusters[c];
+			const size_t end = hardClusters[c + 1];
+
+			cache.Reset();
+			uint32_t clusterMisses = 0;
+			for (size_t t = begin; t < end; ++t) clusterMisses += triangleMisses(t);
+			const float clusterThreshold = threshold * float(clusterMisses) / float(end - begin);
+
+			cache.Reset();
+			size_t start = begin;
+			uint32_t misses = 0;
+			for (size_t t = begin; t < end; ++t)
+			{
+				misses += triangleMisses(t);
+				if (float(misses) <= clusterThreshold * float(t + 1 - start))
+				{
+					clusters.push_back(start);
+					start = t + 1;
+					misses = 0;
+					cache.Reset();
+				}
+			}
+			if (start < end) clusters.push_back(start);
+		}
+		clusters.push_back(triangleCount);
+
+		// sort clusters so the ones facing away from the mesh centre, the likely occluders, are drawn first
+		Float3 meshCentroid{ 0.0f, 0.0f, 0.0f };
+		float meshArea = 0.0f;
+		std::vector<float> sortKeys(clusters.size() - 1);
+		std::vector<Float3> clusterCentroids(sortKeys.size());
+		std::vector<Float3> clusterNormals(sortKeys.size());
+
+		for (size_t c = 0; c < sortKeys.size(); ++c)
+		{
+			Float3 centroid{ 0.0f, 0.0f, 0.0f };
+			Float3 normal{ 0.0f, 0.0f, 0.0f };
+			float area = 0.0f;
+
+			for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+			{
+				Float3 p0 = position(indices[t * 3]);
+				Float3 p1 = position(indices[t * 3 + 1]);
+				Float3 p2 = position(indices[t * 3 + 2]);
+
+				Float3 n = Cross(p1 - p0, p2 - p0);
+				float triangleArea = std::sqrt(Dot(n, n));
+
+				centroid = centroid + (p0 + p1 + p2) * (triangleArea / 3.0f);
+				normal = normal + n;
+				area += triangleArea;
+			}
+
+			meshCentroid = meshCentroid + centroid;
+			meshArea += area;
+			clusterCentroids[c] = area > 0.0f ? centroid * (1.0f / area) : position(indices[clusters[c] * 3]);
+			clusterNormals[c] = normal;
+		}
+		if (meshArea > 0.0f) meshCentroid = meshCentroid * (1.0f / meshArea);
+
+		for (size_t c = 0; c < sortKeys.size(); ++c)
+		{
+			float normalLength = std::sqrt(Dot(clusterNormals[c], clusterNormals[c]));
+			sortKeys[c] = normalLength > 0.0f ? Dot(clusterCentroids[c] - meshCentroid, clusterNormals[c]) / normalLength : 0.0f;
+		}
+
+		std::vector<size_t> order(sortKeys.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+		for (size_t c : order)
+		{
+			output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+		}
+		std::copy(output.begin(), output.end(), indices.begin());
+	}
+
+	std::vector<uint32_t> MeshOptimizer::OptimizeVertexFetch(std::span<uint32_t> indices, std::size_t vertexCount)
+	{
+		std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+		uint32_t next = 0;
+
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == UINT32_MAX) remap[index] = next++;
+			index = remap[index];
+		}
+
+		for (uint32_t& target : remap)
+		{
+			if (target == UINT32_MAX) target = next++;
+		}
+		return remap;
+	}
+
+	void MeshOptimizer::BuildMeshlets(std::span<const uint32_t> indices, uint32_t firstIndex, const float* positions, std::size_t positionStride, std::vector<Meshlet>& outMeshlets)
+	{
+		assert(indices.size() % 3 == 0 && "index range must hold whole triangles");
+
+		auto position = [&](uint32_t vertex)
+		{
+			const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * positionStride);
+			return Float3{ p[0], p[1], p[2] };
+		};
+
+		auto finishMeshlet = [&](size_t beginTriangle, size_t endTriangle)
+		{
+			Meshlet meshlet{};
+			meshlet.firstIndex = firstIndex + uint32_t(beginTriangle * 3);
+			meshlet.indexCount = uint32_t((endTriangle - beginTriangle) * 3);
+
+			//bounding sphere around the box centre, cheap and tight enough for clusters this small
+			Float3 minP = position(indices[beginTriangle * 3]);
+			Float3 maxP = minP;
+			for (size_t i = beginTriangle * 3; i < endTriangle * 3; ++i)
+			{
+				Float3 p = position(indices[i]);
+				minP = { std::min(minP.x, p.x), std::min(minP.y, p.y), std::min(minP.z, p.z) };
+				maxP = { std::max(maxP.x, p.x), std::max(maxP.y, p.y), std::max(maxP.z, p.z) };
+			}
+			Float3 center = (minP + maxP) * 0.5f;
+			float radiusSq = 0.0f;
+			for (size_t i = beginTriangle * 3; i < endTriangle * 3; ++i)
+			{
+				Float3 d = position(indices[i]) - center;
+				radiusSq = std::max(radiusSq, Dot(d, d));
+			}
+
+			//normal cone: average of the unit triangle normals, the widest deviation from it sets the cutoff
+			std::vector<Float3> normals;
+			normals.reserve(endTriangle - beginTriangle);
+			Float3 axis{ 0.0f, 0.0f, 0.0f };
+			for (size_t t = beginTriangle; t < endTriangle; ++t)
+			{
+				Float3 p0 = position(indices[t * 3]);
+				Float3 n = Cross(position(indices[t * 3 + 1]) - p0, position(indices[t * 3 + 2]) - p0);
+				float length = std::sqrt(Dot(n, n));
+				if (length <= 0.0f) continue;
+
+				normals.push_back(n * (1.0f / length));
+				axis = axis + normals.back();
+			}
+
+			float axisLength = std::sqrt(Dot(axis, axis));
+			float minDot = 1.0f;
+			if (axisLength > 0.0f)
+			{
+				axis = axis * (1.0f / axisLength);
+				for (const Float3& n : normals) minDot = std::min(minDot, Dot(axis, n));
+			}
+
+			std::copy_n(&center.x, 3, meshlet.center);
+			meshlet.radius = std::sqrt(radiusSq);
+			std::copy_n(&axis.x, 3, meshlet.coneAxis);
+			// a cone wider than ~85 degrees (or no valid normal) can always face the camera
+			meshlet.coneCutoff = (axisLength <= 0.0f || minDot <= 0.1f) ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+
+			outMeshlets.push_back(meshlet);
+		};
+
+		uint32_t meshletVertices[MAX_MESHLET_VERTICES];
+		uint32_t vertexCount = 0;
+		size_t   beginTriangle = 0;
+		const size_t triangleCount = indices.size() / 3;
+
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			uint32_t newVertices[3];
+			uint32_t newCount = 0;
+			for (size_t k = 0; k < 3; ++k)
+			{
+				uint32_t v = indices[t * 3 + k];
+				if (std::find(meshletVertices, meshletVertices + vertexCount, v) == meshletVertices + vertexCount &&
+					std::find(newVertices, newVertices + newCount, v) == newVertices + newCount)
+				{
+					newVertices[newCount++] = v;
+				}
+			}
+
+			if (vertexCount + newCount > MAX_MESHLET_VERTICES || t - beginTriangle == MAX_MESHLET_TRIANGLES)
+			{
+				finishMeshlet(beginTriangle, t);
+				beginTriangle = t;
+				vertexCount = 0;
+
+				// every vertex of this triangle is new to the fresh meshlet
+				newCount = 0;
+				for (size_t k = 0; k < 3; ++k)
+				{
+					uint32_t v = indices[t * 3 + k];
+					if (std::find(newVertices, newVertices + newCount, v) == newVertices + newCount) newVertices[newCount++] = v;
+				}
+			}
+
+			std::copy_n(newVertices, newCount, meshletVertices + vertexCount);
+			vertexCount += newCount;
+		}
+
+		if (beginTriangle < triangleCount)
+		{
+			finishMeshlet(beginTriangle, triangleCount);
+		}
+	}
+
+	std::vector<uint32_t> MeshOptimizer::Simplify(std::span<const uint32_t> indices, const float* positions, std::size_t positionStride,
+		std::size_t targetIndexCount, float targetError, float* outError)
+	{
+		assert(indices.size() % 3 == 0 && "index range must hold whole triangles");
+		if (outError) *outError = 0.0f;
+		if (indices.size() <= targetIndexCount || indices.empty()) return { indices.begin(), indices.end() };
+
+		std::vector<uint32_t> current;
+		const uint32_t vertexCount = BuildLocalIds(indices, current);
+
+		std::vector<uint32_t> globalIds(vertexCount);
+		for (size_t i = 0; i < indices.size(); ++i) globalIds[current[i]] = indices[i];
+
+		// work in a unit box so targetError is relative to the size of the range
+		std::vector<Float3> pos(vertexCount);
+		Float3 minP{ FLT_MAX, FLT_MAX, FLT_MAX };
+		Float3 maxP{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + globalIds[v] * positionStride);
+			pos[v] = { p[0], p[1], p[2] };
+			minP = { std::min(minP.x, p[0]), std::min(minP.y, p[1]), std::min(minP.z, p[2]) };
+			maxP = { std::max(maxP.x, p[0]), std::max(maxP.y, p[1]), std::max(maxP.z, p[2]) };
+		}
+		const float extent = std::max(maxP.x - minP.x, std::max(maxP.y - minP.y, maxP.z - minP.z));
+		if (extent <= 0.0f) return { indices.begin(), indices.end() };
+		for (auto& p : pos) p = (p - minP) * (1.0f / extent);
+
+		// vertices that share a position with another vertex sit on a uv/normal seam, moving them would tear the seam open
+		std::vector<bool> locked(vertexCount, false);
+		{
+			std::vector<uint32_t> byPosition(vertexCount);
+			std::iota(byPosition.begin(), byPosition.end(), 0);
+			auto key = [&](uint32_t v) { return std::tie(pos[v].x, pos[v].y, pos[v].z); };
+			std::sort(byPosition.begin(), byPosition.end(), [&](uint32_t a, uint32_t b) { return key(a) < key(b); });
+			for (size_t i = 1; i < byPosition.size(); ++i)
+			{
+				if (key(byPosition[i]) == key(byPosition[i - 1]))
+				{
+					locked[byPosition[i]] = true;
+					locked[byPosition[i - 1]] = true;
+				}
+			}
+		}
+
+		// open border edges only appear in one direction, their vertices stay put so holes and outlines keep their shape
+		{
+			std::vector<uint64_t> halfEdges;
+			halfEdges.reserve(current.size());
+			for (size_t t = 0; t < current.size(); t += 3)
+			{
+				for (size_t k = 0; k < 3; ++k)
+				{
+					halfEdges.push_back((uint64_t(current[t + k]) << 32) | current[t + (k + 1) % 3]);
+				}
+			}
+			std::sort(halfEdges.begin(), halfEdges.end());
+			for (uint64_t edge : halfEdges)
+			{
+				uint32_t a = uint32_t(edge >> 32);
+				uint32_t b = uint32_t(edge);
+				if (!std::binary_search(halfEdges.begin(), halfEdges.end(), (uint64_t(b) << 32) | a))
+				{
+					locked[a] = true;
+					locked[b] = true;
+				}
+			}
+		}
+
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t t = 0; t < current.size(); t += 3)
+		{
+			const Float3& p0 = pos[current[t]];
+			Float3 n = Cross(pos[current[t + 1]] - p0, pos[current[t + 2]] - p0);
+			float length = std::sqrt(Dot(n, n));
+			if (length <= 0.0f) continue;
+
+			n = n * (1.0f / length);
+			for (size_t k = 0; k < 3; ++k)
+			{
+				quadrics[current[t + k]].AddPlane(n, -Dot(n, p0), length * 0.5f);
+			}
+		}
+
+		struct Collapse
+		{
+			uint32_t from;
+			uint32_t to;
+			float    cost;
+		};
+		std::vector<Collapse> candidates;
+		std::vector<uint32_t> offsets(vertexCount + 1);
+		std::vector<uint32_t> adjacency;
+		std::vector<bool>     touched(vertexCount);
+
+		const float maxCost = targetError * targetError;
+		float reachedCost = 0.0f;
+
+		// each pass does the cheapest non overlapping collapses, then the next pass rescores what is left
+		while (current.size() > targetIndexCount)
+		{
+			candidates.clear();
+			for (size_t t = 0; t < current.size(); t += 3)
+			{
+				for (size_t k = 0; k < 3; ++k)
+				{
+					uint32_t a = current[t + k];
+					uint32_t b = current[t + (k + 1) % 3];
+					for (auto [from, to] : { std::pair{ a, b }, std::pair{ b, a } })
+					{
+						if (locked[from]) continue;
+						Quadric q = quadrics[from];
+						q += quadrics[to];
+						candidates.push_back({ from, to, q.Error(pos[to]) });
+					}
+				}
+			}
+			if (candidates.empty()) break;
+			std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			std::fill(offsets.begin(), offsets.end(), 0);
+			for (uint32_t v : current) ++offsets[v + 1];
+			std::inclusive_scan(offsets.begin(), offsets.end(), offsets.begin());
+			adjacency.resize(current.size());
+			{
+				std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+				for (size_t i = 0; i < current.size(); ++i) adjacency[cursor[current[i]]++] = uint32_t(i / 3);
+			}
+
+			std::fill(touched.begin(), touched.end(), false);
+			size_t indexCount = current.size();
+			size_t collapses = 0;
+
+			for (const auto& collapse : candidates)
+			{
+				if (collapse.cost > maxCost || indexCount <= targetIndexCount) break;
+				if (touched[collapse.from] || touched[collapse.to]) continue;
+
+				// reject collapses that flip or flatten a triangle that survives them
+				bool valid = true;
+				size_t removed = 0;
+				for (uint32_t i = offsets[collapse.from]; i < offsets[collapse.from + 1] && valid; ++i)
+				{
+					const uint32_t* tri = &current[adjacency[i] * 3];
+					if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+					{
+						++removed;
+						continue;
+					}
+
+					Float3 before = Cross(pos[tri[1]] - pos[tri[0]], pos[tri[2]] - pos[tri[0]]);
+					auto moved = [&](uint32_t v) { return v == collapse.from ? pos[collapse.to] : pos[v]; };
+					Float3 after = Cross(moved(tri[1]) - moved(tri[0]), moved(tri[2]) - moved(tri[0]));
+					valid = Dot(before, after) > 0.0f && Dot(after, after) > 0.0f;
+				}
+				if (!valid) continue;
+
+				// the one ring changes shape, so nothing around it collapses again in this pass
+				for (uint32_t i = offsets[collapse.from]; i < offsets[collapse.from + 1]; ++i)
+				{
+					uint32_t* tri = &current[adjacency[i] * 3];
+					for (size_t k = 0; k < 3; ++k)
+					{
+						if (tri[k] == collapse.from) tri[k] = collapse.to;
+						touched[tri[k]] = true;
+					}
+				}
+				touched[collapse.from] = true;
+
+				quadrics[collapse.to] += quadrics[collapse.from];
+				reachedCost = std::max(reachedCost, collapse.cost);
+				indexCount -= removed * 3;
+				++collapses;
+			}
+
+			if (collapses == 0) break;
+
+			// drop the triangles that collapsed to a line
+			size_t write = 0;
+			for (size_t t = 0; t < current.size(); t += 3)
+			{
+				uint32_t a = current[t], b = current[t + 1], c = current[t + 2];
+				if (a == b || b == c || a == c) continue;
+				current[write++] = a;
+				current[write++] = b;
+				current[write++] = c;
+			}
+			current.resize(write);
+		}
+
+		if (outError) *outError = std::sqrt(reachedCost) * extent;
+
+		for (uint32_t& index : current) index = globalIds[index];
+		return current;
+	}
+
+	MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(std::span<const uint32_t> indices, std::size_t vertexCount, uint32_t cacheSize)
+	{
+		VertexCacheStats stats{};
+		if (indices.empty()) return stats;
+
+		FifoCache cache{ vertexCount, cacheSize };
+		std::vector<bool> referenced(vertexCount, false);
+		size_t misses = 0;
+		size_t uniqueVertices = 0;
+
+		for (uint32_t index : indices)
+		{
+			misses += cache.Touch(index);
+			if (!referenced[index])
+			{
+				referenced[index] = true;
+				++uniqueVertices;
+			}
+		}
+
+		stats.acmr = float(misses) / float(indices.size() / 3);
+		stats.atvr = float(misses) / float(uniqueVertices);
+		return stats;
+	}
+}
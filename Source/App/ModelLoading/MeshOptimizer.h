@@ -0,0 +1,60 @@
+#pragma once
+
+//std
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace cve
+{
+	// Index/vertex reordering run once at import, results end up in the mesh cache.
+	// Works on plain index ranges and strided float3 positions so it has no Vulkan or Assimp dependencies.
+	class MeshOptimizer final
+	{
+	public:
+		struct VertexCacheStats
+		{
+			float acmr = 0.0f;	//average cache miss ratio, transformed vertices per triangle (0.5 is the ideal for a regular grid, 3 the worst)
+			float atvr = 0.0f;	//average transformed vertex ratio, transformed vertices per referenced vertex (1 is ideal)
+		};
+
+		//contiguous run of an index buffer with the bounds the culling pass tests, all in model space
+		struct Meshlet
+		{
+			float    center[3];
+			float    radius;
+			float    coneAxis[3];
+			float    coneCutoff;	//back facing when dot(center - eye, axis) >= cutoff * |center - eye| + radius, 1 = never
+			uint32_t firstIndex;
+			uint32_t indexCount;
+		};
+
+		//FIFO size used for reporting, close to what current GPUs keep per batch
+		static constexpr uint32_t STATS_CACHE_SIZE = 16;
+
+		static constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+		static constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+		// reorders the triangles of one index range for post-transform cache reuse (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+		static void OptimizeVertexCache(std::span<uint32_t> indices);
+
+		// reorders clusters of the cache optimized range so outward facing ones draw first, keeps the ACMR within threshold of the input
+		static void OptimizeOverdraw(std::span<uint32_t> indices, const float* positions, std::size_t positionStride, float threshold = 1.05f);
+
+		// rewrites indices to first-use order and returns the old -> new vertex remap, unreferenced vertices are moved to the end
+		static std::vector<uint32_t> OptimizeVertexFetch(std::span<uint32_t> indices, std::size_t vertexCount);
+
+		// splits an index range into meshlets in draw order, so every meshlet stays a contiguous firstIndex/indexCount range.
+		// firstIndex is the offset of the range inside the whole index buffer, run after the cache/overdraw optimization for tight clusters
+		static void BuildMeshlets(std::span<const uint32_t> indices, uint32_t firstIndex, const float* positions, std::size_t positionStride, std::vector<Meshlet>& outMeshlets);
+
+		// quadric error edge collapse towards targetIndexCount, stops early once a collapse would move the surface further than targetError
+		// (relative to the range's extent). Collapses only onto existing vertices so the result indexes the same vertex buffer;
+		// border and attribute seam vertices stay put. outError receives the reached error in model units
+		static std::vector<uint32_t> Simplify(std::span<const uint32_t> indices, const float* positions, std::size_t positionStride,
+			std::size_t targetIndexCount, float targetError, float* outError = nullptr);
+
+		static VertexCacheStats AnalyzeVertexCache(std::span<const uint32_t> indices, std::size_t vertexCount, uint32_t cacheSize = STATS_CACHE_SIZE);
+	};
+}
@@ -1,453 +1,377 @@
 #include "Model.h"
-#include "Utils.h"
+#include "ThreadPool.h"
+#include "TextureRegistry.h"
+#include "MaterialTable.h"
+#include "GeometryArena.h"
 //libs
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
-
-#include <assimp/pbrmaterial.h>    
-#include <assimp/material.h>    
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm\gtx\hash.hpp>
+#include <glm\gtc\packing.hpp>
 
 //std
+#include <algorithm>
 #include <cassert>
-#include <cstring>
+#include <cmath>
+#include <chrono>
 #include <filesystem>
-#include <unordered_map>
+#include <iomanip>
 #include <iostream>
-
-#include "GBuffer.h"
+#include <thread>
 
 
-namespace std
+namespace cve
 {
-	template <>
-	struct hash<cve::Model::Vertex>
+	namespace
 	{
-		size_t operator()(cve::Model::Vertex const& vertex) const
+		//maps a unit vector onto the [-1,1] square (octahedral encoding), the inverse lives in GeometryPass.vert
+		glm::vec2 OctEncode(glm::vec3 n)
 		{
-			size_t seed = 0; 
-			cve::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv, vertex.tangent, vertex.biTangent); 
-			return seed; 
+			float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+			if (l1 <= 0.0f) return { 0.0f, 0.0f };
+
+			n /= l1;
+			glm::vec2 e{ n.x, n.y };
+			if (n.z < 0.0f)
+			{
+				e = (1.0f - glm::abs(glm::vec2{ e.y, e.x })) * glm::vec2{ e.x >= 0.0f ? 1.0f : -1.0f, e.y >= 0.0f ? 1.0f : -1.0f };
+			}
+			return e;
 		}
-	};
-}
+	}
 
-namespace cve
-{
+	Model::VertexLayout Model::s_VertexLayout = Model::VertexLayout::Compact;
 
 	Model::Model(Device& device, Model::Data&& data)
-		:m_Device{device}, m_Data{std::move(data)}
+		:m_Device{device}, m_Layout{s_VertexLayout}, m_Data{std::move(data)}
 	{
-		CreateVertexBuffers(m_Data.vertices); 
-		CreateIndexBuffers(m_Data.indices);
+		if (m_Layout == VertexLayout::Compact)
+		{
+			CreateCompactVertexBuffers(m_Data.GetVertices());
+		}
+		else
+		{
+			CreateVertexBuffers(m_Data.GetVertices()); 
+		}
+		CreateIndexBuffers(m_Data.GetIndices());
+		CreateInstanceBuffer(m_Data.instanceTransforms);
+		m_FirstMaterial = MaterialTable::Allocate(m_Device, m_Data.materials);
 	}
 
 	Model::~Model()
 	{
-		vkDestroyBuffer(m_Device.device(), m_VertexBuffer, nullptr); 
-		vkFreeMemory(m_Device.device(), m_VertexBufferMemory, nullptr); 
+		GeometryArena::Free(GeometryArena::Stream::Vertex, m_FirstVertex, m_VertexCount);
+		GeometryArena::Free(GeometryArena::Stream::Index, m_FirstIndex, m_IndexCount);
+		GeometryArena::Free(GeometryArena::Stream::Instance, m_FirstInstance, m_InstanceCount);
+		MaterialTable::Free(m_FirstMaterial, static_cast<uint32_t>(m_Data.materials.size()));
+		for (uint32_t slot : m_Data.textureSlots) TextureRegistry::Release(slot);
+	}
+
 
-		if (m_HasIndexBuffer)
-		{
-			vkDestroyBuffer(m_Device.device(), m_IndexBuffer, nullptr);
-			vkFreeMemory(m_Device.device(), m_IndexBufferMemory, nullptr);
-		}
-		Texture::cleanupBindless(m_Device);
 
+	std::unique_ptr<Model> Model::CreateModelFromFile(Device& device, const std::string& filepath) 
+	{
+		return CreateModel(device, DecodeModelFromFile(filepath));
 	}
 
 
-	std::unique_ptr<Model> Model::CreateModelFromFile(Device& device, const std::string& filepath) 
+	std::unique_ptr<Model> Model::CreateModel(Device& device, DecodedModel&& decoded)
 	{
-		std::filesystem::path fp{ filepath };        
-		std::string assetDir = fp.parent_path().string() + "/";
+		//UPLOAD ON THIS THREAD (staging copy, mip blits), textures another model already registered are only referenced.
+		//Textures, geometry and materials are recorded into one upload batch, nothing waits for the GPU here
+		auto uploadStart = std::chrono::high_resolution_clock::now();
+		const uint64_t sharedBefore = TextureRegistry::GetStats().sharedCount;
+		const uint64_t submitsBefore = device.getUploadSubmitCount();
+		device.beginUploadBatch();
+		std::vector<uint32_t> slots;
+		slots.reserve(decoded.images.size());
+		for (auto& image : decoded.images)
+		{
+			slots.push_back(TextureRegistry::Acquire(device, image));
+			image.pixels.reset();
+		}
 
-		//READ OBJ DATA
-		Data data{}; 
-		data.LoadModel(filepath);
+		//material indices go from the model's texture list to the global bindless slots
+		Data data = std::move(decoded.data);
+		auto toSlot = [&slots](uint32_t& index) { if (index != UINT32_MAX) index = slots[index]; };
+		for (auto& mi : data.materials)
+		{
+			toSlot(mi.baseColorIndex);
+			toSlot(mi.metallicRoughIndex);
+			toSlot(mi.normalIndex);
+			toSlot(mi.occlusionIndex);
+		}
+		const size_t textureCount = slots.size();
+		data.textureSlots = std::move(slots);
+		auto model = std::make_unique<Model>(device, std::move(data));
+		model->m_UploadToken = device.endUploadBatch();
+
+		auto uploadMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - uploadStart).count();
+		std::cout << "[Textures] " << decoded.name << ": " << textureCount << " textures ("
+			<< TextureRegistry::GetStats().sharedCount - sharedBefore << " shared), decode "
+			<< decoded.decodeMs << " ms on " << decoded.decodeThreads << " threads, upload " << uploadMs << " ms in "
+			<< device.getUploadSubmitCount() - submitsBefore << " submits" << std::endl;
+		return model;
+	}
 
+	VkDeviceSize Model::GetTextureMemorySize() const
+	{
+		VkDeviceSize size = 0;
+		for (uint32_t slot : m_Data.textureSlots) size += TextureRegistry::Get(slot)->getMemorySize();
+		return size;
+	}
 
-		std::unordered_map<std::string, uint32_t> indexMap;
-		std::vector<std::unique_ptr<Texture>>    textures;
-		textures.reserve(data.materials.size() * 4); 
+	uint32_t Model::GetCompressedTextureCount() const
+	{
+		return static_cast<uint32_t>(std::count_if(m_Data.textureSlots.begin(), m_Data.textureSlots.end(),
+			[](uint32_t slot) { return TextureRegistry::Get(slot)->isCompressed(); }));
+	}
 
+	void Model::RunTextureDecodeBenchmark(const std::vector<std::string>& scenes)
+	{
+		using clock = std::chrono::high_resolution_clock;
+		auto toMs = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
 
-		auto tryLoad = [&](std::string const& filename, uint32_t& outIndex, VkFormat format)
+		std::cout << std::fixed << std::setprecision(2);
+		for (const auto& scene : scenes)
 		{
-			if (filename == "NULL") 
+			if (!std::filesystem::exists(scene))
 			{
-				outIndex = UINT32_MAX;
-				return;
+				std::cout << scene << ": not found, skipped" << std::endl;
+				continue;
 			}
-			std::string full = assetDir + filename;
-			auto it = indexMap.find(full);
-			if (it == indexMap.end())
+
+			Data data = LoadData(scene);
+
+			// same de-duplication as CreateModelFromFile, formats only pick the channel count here
+			std::string assetDir = std::filesystem::path(scene).parent_path().string() + "/";
+			std::vector<std::string> files;
+			for (const auto& mi : data.materials)
 			{
-				uint32_t idx = uint32_t(textures.size());
-				indexMap[full] = idx;
-				textures.emplace_back(std::make_unique<Texture>(device, full,format)); 
-				outIndex = idx;
+				for (const auto* tex : { &mi.baseColorTex, &mi.metallicRoughTex, &mi.normalTex, &mi.occlusionTex })
+				{
+					if (*tex != "NULL" && std::find(files.begin(), files.end(), assetDir + *tex) == files.end())
+					{
+						files.push_back(assetDir + *tex);
+					}
+				}
 			}
-			else 
+
+			std::cout << std::filesystem::path(scene).filename().string() << " (" << files.size() << " textures)" << std::endl;
+			std::cout << "  threads   decode (ms)   speedup" << std::endl;
+
+			double singleThreadMs = 0.0;
+			const uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+			for (uint32_t threads = 1; ; threads = std::min(threads * 2, maxThreads))
 			{
-				outIndex = it->second;
-			}
-		};
+				std::vector<TextureDecoder::DecodedImage> decoded(files.size());
+				auto start = clock::now();
+				{
+					ThreadPool pool{ threads };
+					pool.ParallelFor(uint32_t(files.size()), [&](uint32_t i)
+						{
+							decoded[i] = TextureDecoder::decode(files[i], ALBEDO_TEXTURE_FORMAT);
+						});
+				}
+				double ms = toMs(clock::now() - start);
+				if (threads == 1) singleThreadMs = ms;
 
-		for (auto& mi : data.materials)
-		{
-			tryLoad(mi.baseColorTex, mi.baseColorIndex, GBuffer::ALBEDO_FORMAT);
-			tryLoad(mi.metallicRoughTex, mi.metallicRoughIndex, GBuffer::METALROUGH_FORMAT);
-			tryLoad(mi.normalTex, mi.normalIndex, GBuffer::NORM_FORMAT);
-			tryLoad(mi.occlusionTex, mi.occlusionIndex, GBuffer::OCCLUSION_FORMAT);
-		}
+				std::cout << std::setw(9) << threads
+					<< std::setw(14) << ms
+					<< std::setw(9) << singleThreadMs / std::max(ms, 0.001) << "x" << std::endl;
 
-		data.textures = std::move(textures);
-		Texture::initBindless(device, uint32_t(data.textures.size()));
-		Texture::updateBindless(device, &data);
-		return std::make_unique<Model>(device, std::move(data));
+				if (threads == maxThreads) break;
+			}
+		}
 	}
 
-	void Model::Bind(VkCommandBuffer commandBuffer)
+	void Model::RunInstancingBenchmark(const std::vector<std::string>& scenes)
 	{
-		VkBuffer buffers[] = { m_VertexBuffer }; 
-		VkDeviceSize offsets[] = { 0 }; 
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets); 
+		struct Result
+		{
+			size_t   vertexCount = 0;
+			size_t   indexCount = 0;
+			uint64_t geometryBytes = 0;	//vertex + index buffer in the current vertex layout
+			uint64_t instanceBytes = 0;
+			size_t   draws = 0;	//before culling, one per submesh with at least one instance
+		};
 
-		if (m_HasIndexBuffer)
+		const bool keepHierarchy = s_ImportOptions.keepHierarchy;
+		const uint64_t vertexSize = s_VertexLayout == VertexLayout::Compact ? sizeof(CompactVertex) : sizeof(Vertex);
+
+		for (const auto& scene : scenes)
 		{
-			vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer, 0, VK_INDEX_TYPE_UINT32); 
+			if (!std::filesystem::exists(scene))
+			{
+				std::cout << scene << ": not found, skipped" << std::endl;
+				continue;
+			}
+
+			Result results[2];
+			for (bool hierarchy : { false, true })
+			{
+				s_ImportOptions.keepHierarchy = hierarchy;
+				Data data = LoadData(scene);
+
+				auto& result = results[hierarchy ? 1 : 0];
+				result.vertexCount = data.GetVertices().size();
+				result.indexCount = data.GetIndices().size();
+				result.geometryBytes = result.vertexCount * vertexSize + result.indexCount * sizeof(uint32_t);
+				result.instanceBytes = data.instanceTransforms.size() * sizeof(glm::mat4);
+				result.draws = std::count_if(data.submeshes.begin(), data.submeshes.end(), [](const SubMesh& sm) { return sm.instanceCount > 0; });
+			}
+
+			auto toMb = [](uint64_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+			std::cout << std::fixed << std::setprecision(2)
+				<< std::filesystem::path(scene).filename().string() << std::endl
+				<< "  import         vertices    indices   geometry (MB)   instances (MB)   draws" << std::endl;
+			for (size_t i = 0; i < 2; ++i)
+			{
+				std::cout << std::left << std::setw(13) << (i == 0 ? "  flattened" : "  hierarchy") << std::right
+					<< std::setw(12) << results[i].vertexCount
+					<< std::setw(11) << results[i].indexCount
+					<< std::setw(16) << toMb(results[i].geometryBytes)
+					<< std::setw(17) << toMb(results[i].instanceBytes)
+					<< std::setw(8) << results[i].draws << std::endl;
+			}
+			std::cout << "  saved " << toMb(results[0].geometryBytes + results[0].instanceBytes) - toMb(results[1].geometryBytes + results[1].instanceBytes)
+				<< " MB, " << results[0].draws - results[1].draws << " fewer draws" << std::endl;
 		}
 
+		s_ImportOptions.keepHierarchy = keepHierarchy;
 	}
 
-	void Model::Draw(VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t firstIndex)
+	void Model::Draw(VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t firstIndex, uint32_t instanceCount, uint32_t firstInstance)
 	{
 		if (m_HasIndexBuffer)
 		{
-			vkCmdDrawIndexed(commandBuffer, indexCount, 1, firstIndex, 0, 0);
+			vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, m_FirstIndex + firstIndex, static_cast<int32_t>(m_FirstVertex), m_FirstInstance + firstInstance);
 		}
 		else
 		{
-			vkCmdDraw(commandBuffer, indexCount, 1, firstIndex, 0);
+			vkCmdDraw(commandBuffer, indexCount, instanceCount, m_FirstVertex + firstIndex, m_FirstInstance + firstInstance);
 		}
 	}
 
-	void Model::CreateVertexBuffers(const std::vector<Vertex>& vertices)
+	void Model::CreateVertexBuffers(std::span<const Vertex> vertices)
 	{
 		m_VertexCount = static_cast<uint32_t>(vertices.size()); 
 		assert(m_VertexCount >= 3 && "Vertex count must be at least 3"); 
 		VkDeviceSize bufferSize = sizeof(vertices[0]) * m_VertexCount; 
 
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory; 
-		m_Device.createBuffer(
-			bufferSize,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT ,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			stagingBuffer,
-			stagingBufferMemory); 
+		m_FirstVertex = GeometryArena::Allocate(m_Device, GeometryArena::Stream::Vertex, vertices.data(), m_VertexCount);
+		m_VertexMemorySize = bufferSize;
+	}
 
-		void* data; 
-		vkMapMemory(m_Device.device(), stagingBufferMemory, 0, bufferSize, 0, &data); 
-		memcpy(data, vertices.data(), static_cast<size_t>(bufferSize)); 
-		vkUnmapMemory(m_Device.device(), stagingBufferMemory); 
+	void Model::CreateCompactVertexBuffers(std::span<const Vertex> vertices)
+	{
+		m_VertexCount = static_cast<uint32_t>(vertices.size());
+		assert(m_VertexCount >= 3 && "Vertex count must be at least 3");
 
-		m_Device.createBuffer(
-			bufferSize,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			m_VertexBuffer,
-			m_VertexBufferMemory);
+		std::vector<CompactVertex> compact(vertices.size());
+		std::vector<uint32_t> colors(vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			compact[i] = CompactVertex::FromVertex(vertices[i]);
+			colors[i] = glm::packUnorm4x8(glm::vec4{ vertices[i].color, 1.0f });
+			m_HasColorStream |= vertices[i].color != glm::vec3{ 1.0f };
+		}
 
-		m_Device.copyBuffer(stagingBuffer, m_VertexBuffer, bufferSize);
+		VkDeviceSize bufferSize = sizeof(CompactVertex) * m_VertexCount;
+		m_FirstVertex = GeometryArena::Allocate(m_Device, GeometryArena::Stream::Vertex, compact.data(), m_VertexCount);
 
-		vkDestroyBuffer(m_Device.device(), stagingBuffer, nullptr);
-		vkFreeMemory(m_Device.device(), stagingBufferMemory, nullptr);
+		//every glTF we ship is all white, those read the arena's single white color with the stride 0 binding
+		VkDeviceSize colorSize = 0;
+		if (m_HasColorStream)
+		{
+			colorSize = sizeof(uint32_t) * m_VertexCount;
+			GeometryArena::WriteColors(m_Device, m_FirstVertex, colors.data(), m_VertexCount);
+		}
 
+		m_VertexMemorySize = bufferSize + colorSize;
 	}
 
-	void Model::CreateIndexBuffers(const std::vector<uint32_t>& indices)
+	void Model::CreateIndexBuffers(std::span<const uint32_t> indices)
 	{
 		m_IndexCount = static_cast<uint32_t>(indices.size());
 		m_HasIndexBuffer = m_IndexCount > 0; 
 
 		if (!m_HasIndexBuffer) return; 
 
-		VkDeviceSize bufferSize = sizeof(indices[0]) * m_IndexCount;
-
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		m_Device.createBuffer(
-			bufferSize,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			stagingBuffer,
-			stagingBufferMemory);
-
-		void* data;
-		vkMapMemory(m_Device.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, indices.data(), static_cast<size_t>(bufferSize));
-		vkUnmapMemory(m_Device.device(), stagingBufferMemory);
-
-		m_Device.createBuffer(
-			bufferSize,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			m_IndexBuffer,
-			m_IndexBufferMemory);
-
-		m_Device.copyBuffer(stagingBuffer, m_IndexBuffer, bufferSize);
-
-		vkDestroyBuffer(m_Device.device(), stagingBuffer, nullptr);
-		vkFreeMemory(m_Device.device(), stagingBufferMemory, nullptr);
-
+		m_FirstIndex = GeometryArena::Allocate(m_Device, GeometryArena::Stream::Index, indices.data(), m_IndexCount);
 	}
 
-	std::vector<VkVertexInputBindingDescription> Model::Vertex::GetBindingDescriptions()
+	void Model::CreateInstanceBuffer(const std::vector<glm::mat4>& transforms)
 	{
-		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1); 
-		bindingDescriptions[0].binding = 0;
-		bindingDescriptions[0].stride = sizeof(Vertex);
-		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-		return bindingDescriptions;   
-
+		//a scene without mesh nodes still gets a valid instance to point at
+		const glm::mat4 identity{ 1.0f };
+		const void* data = transforms.empty() ? &identity : transforms.data();
+		m_InstanceCount = static_cast<uint32_t>(std::max<size_t>(transforms.size(), 1));
+		m_FirstInstance = GeometryArena::Allocate(m_Device, GeometryArena::Stream::Instance, data, m_InstanceCount);
 	}
 
-	std::vector<VkVertexInputAttributeDescription> Model::Vertex::GetAttributeDescriptions()
+	Model::CompactVertex Model::CompactVertex::FromVertex(const Vertex& vertex)
 	{
-		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
-
-		attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) });
-		attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color) });
-		attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) });
-		attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv) });
-		attributeDescriptions.push_back({ 4, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, tangent) });
-		attributeDescriptions.push_back({ 5, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, biTangent) });
-
-		return attributeDescriptions; 
-
-
+		CompactVertex out{};
+		out.position = vertex.position;
+
+		out.uv[0] = glm::packHalf1x16(vertex.uv.x);
+		out.uv[1] = glm::packHalf1x16(vertex.uv.y);
+
+		glm::vec2 n = OctEncode(vertex.normal);
+		out.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(n.x));
+		out.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(n.y));
+
+		//the shader rebuilds the bitangent as cross(normal, tangent) * sign
+		glm::vec2 t = OctEncode(vertex.tangent);
+		float sign = glm::dot(glm::cross(vertex.normal, vertex.tangent), vertex.biTangent) < 0.0f ? -1.0f : 1.0f;
+		out.tangent[0] = static_cast<int8_t>(glm::packSnorm1x8(t.x));
+		out.tangent[1] = static_cast<int8_t>(glm::packSnorm1x8(t.y));
+		out.tangent[2] = static_cast<int8_t>(glm::packSnorm1x8(sign));
+		out.tangent[3] = 0;
+		return out;
 	}
 
-	void Model::Data::LoadModel(const std::string& filepath)
+	std::vector<VkVertexInputBindingDescription> Model::GetVertexBindingDescriptions()
 	{
-		Assimp::Importer importer;
-
-		const aiScene* scene = importer.ReadFile(
-			filepath,
-			aiProcess_Triangulate     
-			| aiProcess_FlipUVs           
-			| aiProcess_CalcTangentSpace
-			| aiProcess_PreTransformVertices
-		);
-
-		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mMeshes) {
-			throw std::runtime_error("Assimp error: " + std::string(importer.GetErrorString()));
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+		if (s_VertexLayout == VertexLayout::Full)
+		{
+			bindingDescriptions.push_back({ 0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX });
 		}
-
-		// -- MATERIALS --------------------------------------------------------------
-
-		materials.resize(scene->mNumMaterials); 
-		for (size_t m = 0; m < scene->mNumMaterials; m++)
+		else
 		{
-			aiMaterial* mat = scene->mMaterials[m];
-			auto& mi = materials[m];
-
-			
-			auto tryTex = [&](aiTextureType type, std::string& out) {
-				if (mat->GetTextureCount(type) > 0) {
-					aiString path;
-					mat->GetTexture(type, 0, &path);
-					out = path.C_Str();
-				}
-				};
-
-			// BASE COLOR
-			tryTex(aiTextureType_BASE_COLOR, mi.baseColorTex);
-
-			// METALLIC-ROUGHNESS
-			// Assimp may expose the combined metallic/roughness texture under
-			// different texture types depending on the importer.  The original
-			// code only queried aiTextureType_SPECULAR which corresponds to the
-			// legacy specular/glossiness workflow and therefore failed to locate
-			// the texture for glTF PBR assets such as MetalRoughSpheres.  This
-			// left the metallic-roughness channel uninitialised causing the
-			// spheres to render with default values.
-
-			// First try the dedicated PBR texture types
-			tryTex(aiTextureType_METALNESS, mi.metallicRoughTex);
-			if (mi.metallicRoughTex == "NULL") {
-				tryTex(aiTextureType_DIFFUSE_ROUGHNESS, mi.metallicRoughTex);
-			}
-			// Fallback for older exporters that might still use the specular slot
-			if (mi.metallicRoughTex == "NULL") {
-				if (mat->GetTextureCount(aiTextureType_SPECULAR) > 0) {
-					aiString path;
-					mat->GetTexture(aiTextureType_SPECULAR, 0, &path);
-					mi.metallicRoughTex = path.C_Str();
-				}
-				else if (mat->GetTextureCount(aiTextureType_DIFFUSE_ROUGHNESS) > 0) {
-					aiString path;
-					mat->GetTexture(aiTextureType_DIFFUSE_ROUGHNESS, 0, &path);
-					mi.metallicRoughTex = path.C_Str();
-				}
-			}
-
-			// NORMAL MAP
-			if (mat->GetTextureCount(aiTextureType_NORMAL_CAMERA) > 0) {
-				aiString path; mat->GetTexture(aiTextureType_NORMAL_CAMERA, 0, &path);
-				mi.normalTex = path.C_Str(); 
-			}
-			else {
-				tryTex(aiTextureType_NORMALS, mi.normalTex);
-			}
-
-			// AMBIENT OCCLUSION
-			tryTex(aiTextureType_AMBIENT_OCCLUSION, mi.occlusionTex);
-
-
-			//RAW SCAN FOR PBR FACTORS (cant seem to get the macros to be recognised so doing it by hand) 
-			for (unsigned int p = 0; p < mat->mNumProperties; p++) {
-				auto* prop = mat->mProperties[p];
-				const char* key = prop->mKey.C_Str();
-
-				if (std::strcmp(key, "$mat.gltf.pbrMetallicRoughness.baseColorFactor") == 0
-					&& prop->mDataLength >= sizeof(float) * 4) {
-					auto f = reinterpret_cast<float const*>(prop->mData);
-					mi.baseColorFactor = glm::vec4(f[0], f[1], f[2], f[3]);
-				}
-				else if (std::strcmp(key, "$mat.gltf.pbrMetallicRoughness.metallicFactor") == 0
-					&& prop->mDataLength >= sizeof(float)) {
-					mi.metallicFactor = *reinterpret_cast<float const*>(prop->mData);
-				}
-				else if (std::strcmp(key, "$mat.gltf.pbrMetallicRoughness.roughnessFactor") == 0
-					&& prop->mDataLength >= sizeof(float)) {
-					mi.roughnessFactor = *reinterpret_cast<float const*>(prop->mData);
-				}
-				else if (std::strcmp(key, "$mat.gltf.occlusionStrength") == 0
-					&& prop->mDataLength >= sizeof(float)) {
-					mi.occlusionStrength = *reinterpret_cast<float const*>(prop->mData);
-				}
-			}
-
-			
+			bindingDescriptions.push_back({ 0, sizeof(CompactVertex), VK_VERTEX_INPUT_RATE_VERTEX });
+			bindingDescriptions.push_back({ 1, sizeof(uint32_t), VK_VERTEX_INPUT_RATE_VERTEX });
 		}
+		bindingDescriptions.push_back({ INSTANCE_BINDING, sizeof(glm::mat4), VK_VERTEX_INPUT_RATE_INSTANCE });
+		return bindingDescriptions;
+	}
 
-		// -- COUNT TOTAL SIZE -------------------------------------------------
-		uint32_t totalVertices = 0;
-		uint32_t totalFaces = 0;
-		for (uint32_t m = 0; m < scene->mNumMeshes; m++) 
+	std::vector<VkVertexInputAttributeDescription> Model::GetVertexAttributeDescriptions()
+	{
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+		if (s_VertexLayout == VertexLayout::Full)
 		{
-			totalVertices += scene->mMeshes[m]->mNumVertices;
-			totalFaces += scene->mMeshes[m]->mNumFaces;
+			attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) });
+			attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color) });
+			attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) });
+			attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv) });
+			attributeDescriptions.push_back({ 4, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, tangent) });
+			attributeDescriptions.push_back({ 5, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, biTangent) });
 		}
-
-		vertices.reserve(totalVertices);
-		indices.reserve(totalFaces * 3);
-		submeshes.reserve(scene->mNumMeshes);
-
-		uint32_t globalVertexOffset = 0; 
-		uint32_t globalIndexOffset = 0;
-
-
-		// -- MESHES, VERTICES, INDICES, SUBMESHES ----------------------------
-		for (uint32_t m = 0; m < scene->mNumMeshes; m++)
+		else
 		{
-			aiMesh* mesh = scene->mMeshes[m];
-
-
-			//vertices
-			for (uint32_t i = 0; i < mesh->mNumVertices; i++) 
-			{
-				Vertex v{};
-				
-				v.position = {
-						mesh->mVertices[i].x,
-						mesh->mVertices[i].y,
-						mesh->mVertices[i].z
-				};
-
-				if (mesh->HasNormals()) {
-					v.normal = {
-					mesh->mNormals[i].x,
-					mesh->mNormals[i].y,
-					mesh->mNormals[i].z
-					};
-					
-				}
-				else {
-					v.normal = { 0.0f, 0.0f, 0.0f };
-				}
-
-				
-				if (mesh->HasVertexColors(0)) 
-				{
-					auto& c = mesh->mColors[0][i];
-					v.color = { c.r, c.g, c.b };
-				}
-				else
-				{
-					v.color = { 1.0f, 1.0f, 1.0f };
-				}
-
-				if (mesh->mTextureCoords[0]) {
-					v.uv = {
-							mesh->mTextureCoords[0][i].x,
-							mesh->mTextureCoords[0][i].y
-					};
-				}
-				else {
-					v.uv = { 0.0f, 0.0f };
-				}
-
-				if (mesh->HasTangentsAndBitangents()) {
-					v.tangent = {
-					  mesh->mTangents[i].x,
-					  mesh->mTangents[i].y,
-					  mesh->mTangents[i].z
-					};
-					v.biTangent = {
-					  mesh->mBitangents[i].x, 
-					  mesh->mBitangents[i].y,
-					  mesh->mBitangents[i].z
-					};
-				}
-				else {
-					// you can orthonormalize later in the shader or generate here
-					v.tangent = { 1,0,0 };
-					v.biTangent = { 0,1,0 };
-				}
-
-
-				vertices.push_back(v);
-			}
-
-			//indices
-			for (uint32_t f = 0; f < mesh->mNumFaces; f++)
-			{
-				const aiFace& face = mesh->mFaces[f]; 
-				for (uint32_t idx = 0; idx < face.mNumIndices; idx++)
-				{
-					indices.push_back(face.mIndices[idx] + globalVertexOffset);
-				}
-			}
-
-			//record into submesh
-			uint32_t faceCount = mesh->mNumFaces;
-			submeshes.push_back({
-				globalIndexOffset,
-				faceCount * 3,
-				mesh->mMaterialIndex 
-				});
-
-			//bump offsets
-			globalVertexOffset += mesh->mNumVertices;
-			globalIndexOffset += faceCount * 3;
-
+			//same locations as the full layout, the bitangent (5) is rebuilt in the shader
+			attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(CompactVertex, position) });
+			attributeDescriptions.push_back({ 1, 1, VK_FORMAT_R8G8B8A8_UNORM, 0 });
+			attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, normal) });
+			attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, uv) });
+			attributeDescriptions.push_back({ 4, 0, VK_FORMAT_R8G8B8A8_SNORM, offsetof(CompactVertex, tangent) });
 		}
 
+		//a mat4 input takes one location per column
+		for (uint32_t column = 0; column < 4; ++column)
+		{
+			attributeDescriptions.push_back({ 6 + column, INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, column * uint32_t(sizeof(glm::vec4)) });
+		}
+		return attributeDescriptions;
 	}
-}
\ No newline at end of file
+}
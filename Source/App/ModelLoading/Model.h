@@ -1,6 +1,6 @@
 #pragma once
 #include "Device.h"
-#include "Texture.h"
+#include "ModelImport.h"
 
 //libs
 #define GLM_FORCE_RADIANS
@@ -9,69 +9,42 @@
 
 //std 
 #include <memory>
+#include <span>
 #include <vector>
 
 namespace cve
 {
 
-	class Model
+	//CPU half of the models lives in ModelImport, Model adds the GPU geometry and materials
+	class Model : public ModelImport
 	{
 	public:
 
-		struct Vertex
+		enum class VertexLayout : uint32_t
 		{
-			glm::vec3 position;
-			glm::vec3 color; 
-			glm::vec3 normal{}; 
-			glm::vec2 uv{};
-			glm::vec3 tangent;
-			glm::vec3 biTangent; 
-
-			static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions();
-			static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
-
-			bool operator==(const Vertex& other) const
-			{
-				return position == other.position && color == other.color && normal == other.normal && uv == other.uv && tangent == other.tangent && biTangent == other.biTangent;
-			}
+			Full = 0,	//Vertex as imported, 68 bytes
+			Compact		//CompactVertex (24 bytes) + optional 4 byte color stream
 		};
 
-		struct SubMesh
+		//quantized GPU layout, decoded in GeometryPass.vert (COMPACT_VERTICES variant)
+		struct CompactVertex
 		{
-			uint32_t firstIndex;
-			uint32_t indexCount;
-			uint32_t materialIndex; 
-		};
+			glm::vec3 position;	//R32G32B32_SFLOAT, kept exact so the depth prepass and geometry pass produce identical depth
+			uint16_t  uv[2];	//R16G16_SFLOAT
+			int16_t   normal[2];	//R16G16_SNORM, octahedral
+			int8_t    tangent[4];	//R8G8B8A8_SNORM, xy octahedral, z bitangent sign
 
-		struct MaterialInfo
-		{
-			std::string baseColorTex = "NULL";
-			std::string normalTex = "NULL";
-			std::string metallicRoughTex = "NULL"; 
-			std::string occlusionTex = "NULL";
-			//todo; emissive texture? 
-
-			uint32_t    baseColorIndex = UINT32_MAX;
-			uint32_t    metallicRoughIndex = UINT32_MAX;
-			uint32_t    normalIndex = UINT32_MAX;
-			uint32_t    occlusionIndex = UINT32_MAX;
-
-			glm::vec4 baseColorFactor{ 1,1,1,1 };
-			float     metallicFactor = 1.0f;
-			float     roughnessFactor = 1.0f;
-			float     occlusionStrength = 1.0f;
+			static CompactVertex FromVertex(const Vertex& vertex);
 		};
+		static_assert(sizeof(CompactVertex) == 24, "CompactVertex must stay tightly packed");
 
+		//layout used for models created from now on, pipelines read it through the getters below. Pick it before creating any model or pipeline
+		static VertexLayout s_VertexLayout;
+		static std::vector<VkVertexInputBindingDescription> GetVertexBindingDescriptions();
+		static std::vector<VkVertexInputAttributeDescription> GetVertexAttributeDescriptions();
 
-		struct Data
-		{
-			std::vector<Vertex> vertices{};
-			std::vector<uint32_t> indices{};
-			std::vector<SubMesh> submeshes{};
-			std::vector<MaterialInfo> materials{};
-			std::vector<std::unique_ptr<Texture>> textures;
-			void LoadModel(const std::string& filename); 
-		}; 
+		//per instance node transform (mat4, locations 6-9), present in both layouts
+		static constexpr uint32_t INSTANCE_BINDING = 2;
 
 		explicit Model(Device& device, Model::Data&& data);
 		~Model();
@@ -79,30 +52,59 @@ namespace cve
 		Model(const Model&) = delete;
 		Model& operator=(const Model&) = delete;
 
+		//GPU half: registers the textures (shared with other models when already uploaded) and uploads the geometry. Render thread only
+		static std::unique_ptr<Model> CreateModel(Device& device, DecodedModel&& decoded);
+
 		static std::unique_ptr<Model> CreateModelFromFile(Device& device, const std::string& filepath); 
 
-		void Bind(VkCommandBuffer commandBuffer);
-		void Draw(VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t firstIndex);
+		//decodes every texture of the given scenes with 1, 2, 4 .. hardware threads, CPU only (no device needed)
+		static void RunTextureDecodeBenchmark(const std::vector<std::string>& scenes);
+
+		//imports the given scenes flattened and with their node hierarchy, prints geometry memory and draw count of both, CPU only
+		static void RunInstancingBenchmark(const std::vector<std::string>& scenes);
+
+		//the geometry lives in the GeometryArena, bind it once per pass. Only models with vertex colors need their color stream bound
+		bool HasColorStream() const { return m_HasColorStream; }
+		void Draw(VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t firstIndex, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
 
 		Data& getData() { return m_Data;  };
+		VkDeviceSize GetVertexMemorySize() const { return m_VertexMemorySize; }
+		//row of the first material in the MaterialTable, a submesh's material is GetFirstMaterial() + materialIndex
+		uint32_t GetFirstMaterial() const { return m_FirstMaterial; }
+		//upload batch of the model's buffers, textures and materials, see Device::isUploadComplete
+		UploadToken GetUploadToken() const { return m_UploadToken; }
+		//device memory of the material textures and how many of them are block compressed
+		VkDeviceSize GetTextureMemorySize() const;
+		uint32_t GetCompressedTextureCount() const;
 
 
 
 	private:
 		Device& m_Device; 
-		VkBuffer m_VertexBuffer; 
-		VkDeviceMemory m_VertexBufferMemory; 
 		uint32_t m_VertexCount;
+		VertexLayout m_Layout;
+		VkDeviceSize m_VertexMemorySize = 0;
+		uint32_t m_FirstMaterial = 0;
+		UploadToken m_UploadToken = 0;
+
+		//ranges in the GeometryArena streams, the draws add them to their own offsets
+		uint32_t m_FirstVertex = 0;
+		uint32_t m_FirstInstance = 0;
+		uint32_t m_InstanceCount = 0;
+
+		//compact layout only, models without vertex colors read the arena's single white color
+		bool m_HasColorStream = false;
 
 		bool m_HasIndexBuffer = false; 
-		VkBuffer m_IndexBuffer;
-		VkDeviceMemory m_IndexBufferMemory;
+		uint32_t m_FirstIndex = 0;
 		uint32_t m_IndexCount;
 
 		Data m_Data; 
 
-		void CreateVertexBuffers(const std::vector<Vertex>& vertices); 
-		void CreateIndexBuffers(const std::vector<uint32_t>& indices);
+		void CreateVertexBuffers(std::span<const Vertex> vertices); 
+		void CreateCompactVertexBuffers(std::span<const Vertex> vertices);
+		void CreateIndexBuffers(std::span<const uint32_t> indices);
+		void CreateInstanceBuffer(const std::vector<glm::mat4>& transforms);
 
 
 
@@ -0,0 +1,628 @@
+#include "ModelImport.h"
+#include "MeshCache.h"
+#include "AssetPackage.h"
+#include "MeshOptimizer.h"
+#include "Utils.h"
+#include "ThreadPool.h"
+//libs
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <assimp/pbrmaterial.h>    
+#include <assimp/material.h>    
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm\gtx\hash.hpp>
+
+//std
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+
+namespace std
+{
+	template <>
+	struct hash<cve::ModelImport::Vertex>
+	{
+		size_t operator()(cve::ModelImport::Vertex const& vertex) const
+		{
+			size_t seed = 0; 
+			cve::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv, vertex.tangent, vertex.biTangent); 
+			return seed; 
+		}
+	};
+}
+
+namespace cve
+{
+	namespace
+	{
+		//triangle budget (relative to LOD 0) and max relative error of each simplified level, ordered fine to coarse
+		struct LodTarget
+		{
+			float triangleRatio;
+			float error;
+		};
+		constexpr LodTarget LOD_TARGETS[ModelImport::MAX_LOD_COUNT - 1] = { { 0.5f, 0.01f }, { 0.25f, 0.03f }, { 0.125f, 0.08f } };
+	}
+
+	ModelImport::ImportOptions ModelImport::s_ImportOptions{};
+
+	const uint32_t ModelImport::IMPORT_FLAGS =
+		aiProcess_Triangulate
+		| aiProcess_FlipUVs
+		| aiProcess_CalcTangentSpace;
+
+	uint32_t ModelImport::ImportOptions::GetProcessFlags() const
+	{
+		return (optimizeIndices ? 1u : 0u) | (generateLods ? 2u : 0u) | (weldVertices ? 4u : 0u);
+	}
+
+	uint32_t ModelImport::ImportOptions::GetImportFlags() const
+	{
+		return IMPORT_FLAGS | (keepHierarchy ? 0u : uint32_t(aiProcess_PreTransformVertices));
+	}
+
+	ModelImport::Data ModelImport::LoadData(const std::string& filepath)
+	{
+		const std::string name = std::filesystem::path{ filepath }.filename().string();
+		const uint32_t importFlags = s_ImportOptions.GetImportFlags();
+		const uint32_t processFlags = s_ImportOptions.GetProcessFlags();
+
+		auto importStart = std::chrono::high_resolution_clock::now();
+		Data data{};
+		bool cacheHit = MeshCache::Load(filepath, importFlags, processFlags, data);
+		if (!cacheHit)
+		{
+			data = ImportData(filepath);
+			MeshCache::Write(filepath, importFlags, processFlags, data);
+		}
+		auto importMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - importStart).count();
+		std::cout << "[MeshCache] " << name << (cacheHit ? ": warm load " : ": cold import ") << importMs << " ms" << std::endl;
+		return data;
+	}
+
+	ModelImport::Data ModelImport::ImportData(const std::string& filepath)
+	{
+		const std::string name = std::filesystem::path{ filepath }.filename().string();
+
+		Data data{};
+		data.LoadModel(filepath);
+
+		if (s_ImportOptions.weldVertices)
+		{
+			const size_t importedVertices = data.vertices.size();
+			auto weldStart = std::chrono::high_resolution_clock::now();
+			data.WeldVertices();
+			auto weldMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - weldStart).count();
+
+			std::cout << std::fixed << std::setprecision(1)
+				<< "[MeshOptimizer] " << name << ": welded " << importedVertices << " -> " << data.vertices.size() << " vertices ("
+				<< 100.0 * (1.0 - double(data.vertices.size()) / double(std::max<size_t>(importedVertices, 1))) << "% fewer, " << weldMs << " ms)" << std::endl;
+		}
+
+		if (s_ImportOptions.optimizeIndices)
+		{
+			auto before = MeshOptimizer::AnalyzeVertexCache(data.indices, data.vertices.size());
+			auto optimizeStart = std::chrono::high_resolution_clock::now();
+			data.OptimizeIndices();
+			auto optimizeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - optimizeStart).count();
+			auto after = MeshOptimizer::AnalyzeVertexCache(data.indices, data.vertices.size());
+
+			std::cout << std::fixed << std::setprecision(3)
+				<< "[MeshOptimizer] " << name << ": ACMR " << before.acmr << " -> " << after.acmr
+				<< ", ATVR " << before.atvr << " -> " << after.atvr
+				<< " (FIFO " << MeshOptimizer::STATS_CACHE_SIZE << ", " << std::setprecision(1) << optimizeMs << " ms)" << std::endl;
+		}
+
+		if (s_ImportOptions.generateLods)
+		{
+			auto lodStart = std::chrono::high_resolution_clock::now();
+			data.GenerateLods();
+			auto lodMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - lodStart).count();
+
+			std::vector<uint64_t> triangles(MAX_LOD_COUNT, 0);
+			for (const auto& sm : data.submeshes)
+			{
+				//submeshes that stopped simplifying early draw their coarsest level at the lower levels
+				for (uint32_t level = 0; level < MAX_LOD_COUNT; ++level)
+				{
+					triangles[level] += sm.GetLod(std::min(level, sm.lodCount)).indexCount / 3;
+				}
+			}
+
+			std::cout << "[MeshOptimizer] " << name << ": LOD triangles";
+			for (uint32_t level = 0; level < MAX_LOD_COUNT; ++level)
+			{
+				std::cout << (level == 0 ? " " : " / ") << triangles[level];
+			}
+			std::cout << " (" << std::fixed << std::setprecision(1) << lodMs << " ms)" << std::endl;
+		}
+
+		data.BuildMeshlets();
+		return data;
+	}
+
+	ModelImport::DecodedModel ModelImport::DecodeModelFromFile(const std::string& filepath)
+	{
+		std::filesystem::path fp{ filepath };        
+
+		//COOKED PACKAGE (geometry and texture mip chains ready to upload)
+		DecodedModel cooked{};
+		if (AssetPackage::s_LoadPackages && AssetPackage::Load(filepath, cooked))
+		{
+			return cooked;
+		}
+
+		//READ MODEL DATA (mesh cache first, Assimp on a miss)
+		Data data = LoadData(filepath);
+		auto textureFiles = GatherTextureFiles(data, fp.parent_path().string() + "/");
+
+		//DECODE ON WORKER THREADS
+		auto decodeStart = std::chrono::high_resolution_clock::now();
+		std::vector<TextureDecoder::DecodedImage> decoded(textureFiles.size());
+		uint32_t decodeThreads = 0;
+		{
+			ThreadPool pool{ std::clamp(uint32_t(textureFiles.size()), 1u, std::max(1u, std::thread::hardware_concurrency())) };
+			decodeThreads = pool.GetThreadCount();
+			pool.ParallelFor(uint32_t(textureFiles.size()), [&](uint32_t i)
+				{
+					decoded[i] = TextureDecoder::load(textureFiles[i].path, textureFiles[i].format, textureFiles[i].compressedFormat);
+				});
+		}
+		auto decodeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - decodeStart).count();
+
+		return { fp.filename().string(), std::move(data), std::move(decoded), decodeMs, decodeThreads };
+	}
+
+	std::vector<ModelImport::TextureFile> ModelImport::GatherTextureFiles(Data& data, const std::string& assetDir)
+	{
+		std::unordered_map<std::string, uint32_t> indexMap;
+		std::vector<TextureFile> textureFiles;
+		textureFiles.reserve(data.materials.size() * 4); 
+
+
+		auto tryLoad = [&](std::string const& filename, uint32_t& outIndex, VkFormat format, VkFormat compressedFormat)
+		{
+			if (filename == "NULL") 
+			{
+				outIndex = UINT32_MAX;
+				return;
+			}
+			std::string full = assetDir + filename;
+			auto it = indexMap.find(full);
+			if (it == indexMap.end())
+			{
+				uint32_t idx = uint32_t(textureFiles.size());
+				indexMap[full] = idx;
+				textureFiles.push_back({ full, format, compressedFormat });
+				outIndex = idx;
+			}
+			else 
+			{
+				outIndex = it->second;
+			}
+		};
+
+		for (auto& mi : data.materials)
+		{
+			tryLoad(mi.baseColorTex, mi.baseColorIndex, ALBEDO_TEXTURE_FORMAT, ALBEDO_COMPRESSED_FORMAT);
+			tryLoad(mi.metallicRoughTex, mi.metallicRoughIndex, METALROUGH_TEXTURE_FORMAT, METALROUGH_COMPRESSED_FORMAT);
+			tryLoad(mi.normalTex, mi.normalIndex, NORM_TEXTURE_FORMAT, NORM_COMPRESSED_FORMAT);
+			tryLoad(mi.occlusionTex, mi.occlusionIndex, OCCLUSION_TEXTURE_FORMAT, OCCLUSION_COMPRESSED_FORMAT);
+		}
+		return textureFiles;
+	}
+
+	void ModelImport::Data::LoadModel(const std::string& filepath)
+	{
+		Assimp::Importer importer;
+
+		const aiScene* scene = importer.ReadFile(filepath, s_ImportOptions.GetImportFlags());
+
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mMeshes) {
+			throw std::runtime_error("Assimp error: " + std::string(importer.GetErrorString()));
+		}
+
+		// -- MATERIALS --------------------------------------------------------------
+
+		materials.resize(scene->mNumMaterials); 
+		for (size_t m = 0; m < scene->mNumMaterials; m++)
+		{
+			aiMaterial* mat = scene->mMaterials[m];
+			auto& mi = materials[m];
+
+			
+			auto tryTex = [&](aiTextureType type, std::string& out) {
+				if (mat->GetTextureCount(type) > 0) {
+					aiString path;
+					mat->GetTexture(type, 0, &path);
+					out = path.C_Str();
+				}
+				};
+
+			// BASE COLOR
+			tryTex(aiTextureType_BASE_COLOR, mi.baseColorTex);
+
+			// METALLIC-ROUGHNESS
+			// Assimp may expose the combined metallic/roughness texture under
+			// different texture types depending on the importer.  The original
+			// code only queried aiTextureType_SPECULAR which corresponds to the
+			// legacy specular/glossiness workflow and therefore failed to locate
+			// the texture for glTF PBR assets such as MetalRoughSpheres.  This
+			// left the metallic-roughness channel uninitialised causing the
+			// spheres to render with default values.
+
+			// First try the dedicated PBR texture types
+			tryTex(aiTextureType_METALNESS, mi.metallicRoughTex);
+			if (mi.metallicRoughTex == "NULL") {
+				tryTex(aiTextureType_DIFFUSE_ROUGHNESS, mi.metallicRoughTex);
+			}
+			// Fallback for older exporters that might still use the specular slot
+			if (mi.metallicRoughTex == "NULL") {
+				if (mat->GetTextureCount(aiTextureType_SPECULAR) > 0) {
+					aiString path;
+					mat->GetTexture(aiTextureType_SPECULAR, 0, &path);
+					mi.metallicRoughTex = path.C_Str();
+				}
+				else if (mat->GetTextureCount(aiTextureType_DIFFUSE_ROUGHNESS) > 0) {
+					aiString path;
+					mat->GetTexture(aiTextureType_DIFFUSE_ROUGHNESS, 0, &path);
+					mi.metallicRoughTex = path.C_Str();
+				}
+			}
+
+			// NORMAL MAP
+			if (mat->GetTextureCount(aiTextureType_NORMAL_CAMERA) > 0) {
+				aiString path; mat->GetTexture(aiTextureType_NORMAL_CAMERA, 0, &path);
+				mi.normalTex = path.C_Str(); 
+			}
+			else {
+				tryTex(aiTextureType_NORMALS, mi.normalTex);
+			}
+
+			// AMBIENT OCCLUSION
+			tryTex(aiTextureType_AMBIENT_OCCLUSION, mi.occlusionTex);
+
+
+			//RAW SCAN FOR PBR FACTORS (cant seem to get the macros to be recognised so doing it by hand) 
+			for (unsigned int p = 0; p < mat->mNumProperties; p++) {
+				auto* prop = mat->mProperties[p];
+				const char* key = prop->mKey.C_Str();
+
+				if (std::strcmp(key, "$mat.gltf.pbrMetallicRoughness.baseColorFactor") == 0
+					&& prop->mDataLength >= sizeof(float) * 4) {
+					auto f = reinterpret_cast<float const*>(prop->mData);
+					mi.baseColorFactor = glm::vec4(f[0], f[1], f[2], f[3]);
+				}
+				else if (std::strcmp(key, "$mat.gltf.pbrMetallicRoughness.metallicFactor") == 0
+					&& prop->mDataLength >= sizeof(float)) {
+					mi.metallicFactor = *reinterpret_cast<float const*>(prop->mData);
+				}
+				else if (std::strcmp(key, "$mat.gltf.pbrMetallicRoughness.roughnessFactor") == 0
+					&& prop->mDataLength >= sizeof(float)) {
+					mi.roughnessFactor = *reinterpret_cast<float const*>(prop->mData);
+				}
+				else if (std::strcmp(key, "$mat.gltf.occlusionStrength") == 0
+					&& prop->mDataLength >= sizeof(float)) {
+					mi.occlusionStrength = *reinterpret_cast<float const*>(prop->mData);
+				}
+				else if (std::strcmp(key, "$mat.twosided") == 0
+					&& prop->mDataLength >= 1) {
+					//stored as a bool or an int depending on the importer, the first byte is non zero either way
+					mi.doubleSided = prop->mData[0] != 0;
+				}
+			}
+
+			
+		}
+
+		// -- COUNT TOTAL SIZE -------------------------------------------------
+		uint32_t totalVertices = 0;
+		uint32_t totalFaces = 0;
+		for (uint32_t m = 0; m < scene->mNumMeshes; m++) 
+		{
+			totalVertices += scene->mMeshes[m]->mNumVertices;
+			totalFaces += scene->mMeshes[m]->mNumFaces;
+		}
+
+		vertices.reserve(totalVertices);
+		indices.reserve(totalFaces * 3);
+		submeshes.reserve(scene->mNumMeshes);
+
+		uint32_t globalVertexOffset = 0; 
+		uint32_t globalIndexOffset = 0;
+
+
+		// -- MESHES, VERTICES, INDICES, SUBMESHES ----------------------------
+		for (uint32_t m = 0; m < scene->mNumMeshes; m++)
+		{
+			aiMesh* mesh = scene->mMeshes[m];
+
+
+			//vertices
+			for (uint32_t i = 0; i < mesh->mNumVertices; i++) 
+			{
+				Vertex v{};
+				
+				v.position = {
+						mesh->mVertices[i].x,
+						mesh->mVertices[i].y,
+						mesh->mVertices[i].z
+				};
+
+				if (mesh->HasNormals()) {
+					v.normal = {
+					mesh->mNormals[i].x,
+					mesh->mNormals[i].y,
+					mesh->mNormals[i].z
+					};
+					
+				}
+				else {
+					v.normal = { 0.0f, 0.0f, 0.0f };
+				}
+
+				
+				if (mesh->HasVertexColors(0)) 
+				{
+					auto& c = mesh->mColors[0][i];
+					v.color = { c.r, c.g, c.b };
+				}
+				else
+				{
+					v.color = { 1.0f, 1.0f, 1.0f };
+				}
+
+				if (mesh->mTextureCoords[0]) {
+					v.uv = {
+							mesh->mTextureCoords[0][i].x,
+							mesh->mTextureCoords[0][i].y
+					};
+				}
+				else {
+					v.uv = { 0.0f, 0.0f };
+				}
+
+				if (mesh->HasTangentsAndBitangents()) {
+					v.tangent = {
+					  mesh->mTangents[i].x,
+					  mesh->mTangents[i].y,
+					  mesh->mTangents[i].z
+					};
+					v.biTangent = {
+					  mesh->mBitangents[i].x, 
+					  mesh->mBitangents[i].y,
+					  mesh->mBitangents[i].z
+					};
+				}
+				else {
+					// you can orthonormalize later in the shader or generate here
+					v.tangent = { 1,0,0 };
+					v.biTangent = { 0,1,0 };
+				}
+
+
+				vertices.push_back(v);
+			}
+
+			//indices
+			for (uint32_t f = 0; f < mesh->mNumFaces; f++)
+			{
+				const aiFace& face = mesh->mFaces[f]; 
+				for (uint32_t idx = 0; idx < face.mNumIndices; idx++)
+				{
+					indices.push_back(face.mIndices[idx] + globalVertexOffset);
+				}
+			}
+
+			//record into submesh
+			uint32_t faceCount = mesh->mNumFaces;
+			submeshes.push_back({
+				globalIndexOffset,
+				faceCount * 3,
+				mesh->mMaterialIndex 
+				});
+
+			//bump offsets
+			globalVertexOffset += mesh->mNumVertices;
+			globalIndexOffset += faceCount * 3;
+
+		}
+
+		// -- NODES -> INSTANCES ------------------------------------------------
+		//with aiProcess_PreTransformVertices only the root is left and every mesh gets a single identity instance
+		std::vector<std::vector<glm::mat4>> meshInstances(scene->mNumMeshes);
+		std::vector<std::pair<const aiNode*, glm::mat4>> nodeStack{ { scene->mRootNode, glm::mat4{ 1.0f } } };
+		while (!nodeStack.empty())
+		{
+			auto [node, parentTransform] = nodeStack.back();
+			nodeStack.pop_back();
+
+			//aiMatrix4x4 is row major, glm takes columns
+			const aiMatrix4x4& t = node->mTransformation;
+			const glm::mat4 transform = parentTransform * glm::mat4{
+				{ t.a1, t.b1, t.c1, t.d1 },
+				{ t.a2, t.b2, t.c2, t.d2 },
+				{ t.a3, t.b3, t.c3, t.d3 },
+				{ t.a4, t.b4, t.c4, t.d4 } };
+
+			for (uint32_t i = 0; i < node->mNumMeshes; ++i)
+			{
+				meshInstances[node->mMeshes[i]].push_back(transform);
+			}
+			for (uint32_t i = 0; i < node->mNumChildren; ++i)
+			{
+				nodeStack.push_back({ node->mChildren[i], transform });
+			}
+		}
+
+		//submesh m is aiMesh m, meshes no node references keep instanceCount 0 and are never drawn
+		for (uint32_t m = 0; m < scene->mNumMeshes; m++)
+		{
+			submeshes[m].firstInstance = static_cast<uint32_t>(instanceTransforms.size());
+			submeshes[m].instanceCount = static_cast<uint32_t>(meshInstances[m].size());
+			instanceTransforms.insert(instanceTransforms.end(), meshInstances[m].begin(), meshInstances[m].end());
+		}
+
+	}
+
+	void ModelImport::Data::WeldVertices()
+	{
+		assert(!mappedGeometry && "weld before the data is written to or loaded from the mesh cache");
+		if (vertices.empty()) return;
+
+		std::vector<Vertex> welded;
+		welded.reserve(vertices.size());
+		std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+
+		//open addressing with linear probing, slots hold an index into welded. Kept at most half full so probe runs stay short
+		constexpr uint32_t EMPTY = UINT32_MAX;
+		std::vector<uint32_t> table;
+		const std::hash<Vertex> hasher{};
+
+		for (const auto& sm : submeshes)
+		{
+			if (sm.indexCount == 0) continue;
+
+			//every aiMesh owns a contiguous vertex range, recover it from its indices
+			auto range = std::span<uint32_t>{ indices.data() + sm.firstIndex, sm.indexCount };
+			auto [minIt, maxIt] = std::minmax_element(range.begin(), range.end());
+			const uint32_t firstVertex = *minIt;
+			const uint32_t vertexCount = *maxIt - *minIt + 1;
+
+			const size_t capacity = std::bit_ceil(size_t(vertexCount) * 2);
+			const int shift = 64 - std::countr_zero(capacity);
+			table.assign(capacity, EMPTY);
+
+			for (uint32_t v = firstVertex; v < firstVertex + vertexCount; ++v)
+			{
+				//fibonacci hashing takes the top bits, hashCombine leaves the low ones poorly mixed
+				size_t slot = size_t((uint64_t(hasher(vertices[v])) * 0x9E3779B97F4A7C15ull) >> shift);
+				while (table[slot] != EMPTY && !(welded[table[slot]] == vertices[v]))
+				{
+					slot = (slot + 1) & (capacity - 1);
+				}
+
+				if (table[slot] == EMPTY)
+				{
+					table[slot] = uint32_t(welded.size());
+					welded.push_back(vertices[v]);
+				}
+				remap[v] = table[slot];
+			}
+
+			for (uint32_t& index : range) index = remap[index];
+		}
+
+		vertices = std::move(welded);
+	}
+
+	void ModelImport::Data::OptimizeIndices()
+	{
+		assert(!mappedGeometry && "optimize before the data is written to or loaded from the mesh cache");
+		if (vertices.empty()) return;
+
+		//submeshes own disjoint index ranges, so each one is optimized on its own and keeps its firstIndex/indexCount
+		for (const auto& sm : submeshes)
+		{
+			std::span<uint32_t> range{ indices.data() + sm.firstIndex, sm.indexCount };
+			MeshOptimizer::OptimizeVertexCache(range);
+			MeshOptimizer::OptimizeOverdraw(range, &vertices[0].position.x, sizeof(Vertex));
+		}
+
+		auto remap = MeshOptimizer::OptimizeVertexFetch(indices, vertices.size());
+		std::vector<Vertex> reordered(vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			reordered[remap[i]] = vertices[i];
+		}
+		vertices = std::move(reordered);
+	}
+
+	void ModelImport::Data::GenerateLods()
+	{
+		assert(!mappedGeometry && "generate LODs before the data is written to or loaded from the mesh cache");
+		if (vertices.empty()) return;
+
+		for (auto& sm : submeshes)
+		{
+			sm.lodCount = 0;
+
+			//every level simplifies the previous one, which is cheaper than starting from LOD 0 and keeps the errors increasing
+			std::vector<uint32_t> previous(indices.begin() + sm.firstIndex, indices.begin() + sm.firstIndex + sm.indexCount);
+			float error = 0.0f;
+
+			for (const auto& target : LOD_TARGETS)
+			{
+				size_t targetIndexCount = size_t(float(sm.indexCount / 3) * target.triangleRatio) * 3;
+				float levelError = 0.0f;
+				auto lod = MeshOptimizer::Simplify(previous, &vertices[0].position.x, sizeof(Vertex), targetIndexCount, target.error, &levelError);
+
+				//a level that barely removes anything only costs index memory
+				if (lod.empty() || lod.size() > previous.size() * 9 / 10) break;
+
+				MeshOptimizer::OptimizeVertexCache(lod);
+				error += levelError;
+
+				sm.lods[sm.lodCount++] = { uint32_t(indices.size()), uint32_t(lod.size()), 0, 0, error };
+				indices.insert(indices.end(), lod.begin(), lod.end());
+				previous = std::move(lod);
+			}
+		}
+	}
+
+	void ModelImport::Data::BuildMeshlets()
+	{
+		auto allIndices = GetIndices();
+		auto allVertices = GetVertices();
+		if (allVertices.empty()) return;
+
+		meshlets.clear();
+		for (auto& sm : submeshes)
+		{
+			sm.firstMeshlet = uint32_t(meshlets.size());
+			MeshOptimizer::BuildMeshlets(allIndices.subspan(sm.firstIndex, sm.indexCount), sm.firstIndex, &allVertices[0].position.x, sizeof(Vertex), meshlets);
+			sm.meshletCount = uint32_t(meshlets.size()) - sm.firstMeshlet;
+
+			//bounds of LOD 0 from its cluster spheres, the simplified levels only use a subset of those vertices
+			glm::vec3 minP{ FLT_MAX };
+			glm::vec3 maxP{ -FLT_MAX };
+			for (uint32_t m = sm.firstMeshlet; m < sm.firstMeshlet + sm.meshletCount; ++m)
+			{
+				const glm::vec3 center{ meshlets[m].center[0], meshlets[m].center[1], meshlets[m].center[2] };
+				minP = glm::min(minP, center - meshlets[m].radius);
+				maxP = glm::max(maxP, center + meshlets[m].radius);
+			}
+			const glm::vec3 boundsCenter = sm.meshletCount > 0 ? (minP + maxP) * 0.5f : glm::vec3{ 0.0f };
+			float boundsRadius = 0.0f;
+			for (uint32_t m = sm.firstMeshlet; m < sm.firstMeshlet + sm.meshletCount; ++m)
+			{
+				const glm::vec3 center{ meshlets[m].center[0], meshlets[m].center[1], meshlets[m].center[2] };
+				boundsRadius = std::max(boundsRadius, glm::length(center - boundsCenter) + meshlets[m].radius);
+			}
+			sm.boundsCenter[0] = boundsCenter.x;
+			sm.boundsCenter[1] = boundsCenter.y;
+			sm.boundsCenter[2] = boundsCenter.z;
+			sm.boundsRadius = boundsRadius;
+
+			for (uint32_t level = 0; level < sm.lodCount; ++level)
+			{
+				auto& lod = sm.lods[level];
+				lod.firstMeshlet = uint32_t(meshlets.size());
+				MeshOptimizer::BuildMeshlets(allIndices.subspan(lod.firstIndex, lod.indexCount), lod.firstIndex, &allVertices[0].position.x, sizeof(Vertex), meshlets);
+				lod.meshletCount = uint32_t(meshlets.size()) - lod.firstMeshlet;
+			}
+		}
+	}
+}
@@ -0,0 +1,185 @@
+#pragma once
+#include "TextureDecoder.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+
+//libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm\glm.hpp>
+
+//std 
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace cve
+{
+
+	//scene import, mesh processing and texture decoding of a model. Touches no Vulkan objects (only the VkFormat enums),
+	//so the asset cooker builds it without a device or window
+	class ModelImport
+	{
+	public:
+
+		struct Vertex
+		{
+			glm::vec3 position;
+			glm::vec3 color; 
+			glm::vec3 normal{}; 
+			glm::vec2 uv{};
+			glm::vec3 tangent;
+			glm::vec3 biTangent; 
+
+			bool operator==(const Vertex& other) const
+			{
+				return position == other.position && color == other.color && normal == other.normal && uv == other.uv && tangent == other.tangent && biTangent == other.biTangent;
+			}
+		};
+
+		//LOD 0 plus up to 3 simplified levels per submesh
+		static constexpr uint32_t MAX_LOD_COUNT = 4;
+
+		//index range of one detail level, simplified levels index the same vertices as LOD 0
+		struct Lod
+		{
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			uint32_t firstMeshlet;
+			uint32_t meshletCount;
+			float    error;	//max distance to the LOD 0 surface in model units
+		};
+
+		struct SubMesh
+		{
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			uint32_t materialIndex; 
+			uint32_t firstMeshlet = 0;	//range in Data::meshlets, the meshlets cover [firstIndex, firstIndex + indexCount) in order
+			uint32_t meshletCount = 0;
+
+			float    boundsCenter[3]{};	//model space sphere around LOD 0, used to pick the LOD
+			float    boundsRadius = 0.0f;
+
+			uint32_t lodCount = 0;	//simplified levels in lods, coarser ones last. LOD 0 is the range above
+			Lod      lods[MAX_LOD_COUNT - 1]{};
+
+			uint32_t firstInstance = 0;	//range in Data::instanceTransforms, one per scene node that references the mesh
+			uint32_t instanceCount = 0;
+
+			uint32_t GetLevelCount() const { return lodCount + 1; }
+			Lod GetLod(uint32_t level) const { return level == 0 ? Lod{ firstIndex, indexCount, firstMeshlet, meshletCount, 0.0f } : lods[level - 1]; }
+		};
+
+		struct MaterialInfo
+		{
+			std::string baseColorTex = "NULL";
+			std::string normalTex = "NULL";
+			std::string metallicRoughTex = "NULL"; 
+			std::string occlusionTex = "NULL";
+			//todo; emissive texture? 
+
+			uint32_t    baseColorIndex = UINT32_MAX;
+			uint32_t    metallicRoughIndex = UINT32_MAX;
+			uint32_t    normalIndex = UINT32_MAX;
+			uint32_t    occlusionIndex = UINT32_MAX;
+
+			glm::vec4 baseColorFactor{ 1,1,1,1 };
+			float     metallicFactor = 1.0f;
+			float     roughnessFactor = 1.0f;
+			float     occlusionStrength = 1.0f;
+			bool      doubleSided = false;	//back faces are visible, so clusters of this material skip the normal cone test
+		};
+
+
+		struct Data
+		{
+			std::vector<Vertex> vertices{};
+			std::vector<uint32_t> indices{};
+			std::vector<SubMesh> submeshes{};
+			std::vector<MaterialInfo> materials{};
+			std::vector<MeshOptimizer::Meshlet> meshlets{};
+			std::vector<glm::mat4> instanceTransforms{};	//node to model space, grouped per submesh
+			std::vector<uint32_t> textureSlots;	//TextureRegistry slots, CreateModel remaps the MaterialInfo indices to these
+
+			//set when the geometry comes from the mesh cache, the spans then point into the mapping instead of the vectors
+			std::shared_ptr<MappedFile> mappedGeometry{};
+			std::span<const Vertex> vertexSpan{};
+			std::span<const uint32_t> indexSpan{};
+
+			std::span<const Vertex> GetVertices() const { return mappedGeometry ? vertexSpan : std::span<const Vertex>{ vertices }; }
+			std::span<const uint32_t> GetIndices() const { return mappedGeometry ? indexSpan : std::span<const uint32_t>{ indices }; }
+
+			void LoadModel(const std::string& filename); 
+
+			//merges identical vertices inside every submesh and rewrites the indices, run first since the other steps index the result
+			void WeldVertices();
+
+			//reorders every submesh for the post-transform cache and overdraw, then the vertices for fetch locality. Needs owned (non mapped) geometry
+			void OptimizeIndices();
+
+			//appends simplified index ranges for every submesh, run after OptimizeIndices so the vertex order is final
+			void GenerateLods();
+
+			//splits every submesh and LOD into culling clusters and computes the submesh bounds, run last since it keeps the index order
+			void BuildMeshlets();
+		}; 
+
+		//optional processing after the Assimp import, enabled steps are part of the mesh cache key so their result is stored with it
+		struct ImportOptions
+		{
+			bool keepHierarchy = true;	//false flattens every node into model space (aiProcess_PreTransformVertices), one copy per node
+			bool weldVertices = true;
+			bool optimizeIndices = true;
+			bool generateLods = true;
+
+			uint32_t GetProcessFlags() const;
+			uint32_t GetImportFlags() const;
+		};
+
+		//assimp post processing flags used in every mode, GetImportFlags adds the mode dependent ones. Both are part of the mesh cache key
+		static const uint32_t IMPORT_FLAGS;
+		static ImportOptions s_ImportOptions;
+
+		//mesh cache lookup, ImportData on a miss
+		static Data LoadData(const std::string& filepath);
+
+		//Assimp import + ImportOptions processing, bypasses the mesh cache (the asset cooker stores the result in its package instead)
+		static Data ImportData(const std::string& filepath);
+
+		//CPU half of Model::CreateModelFromFile: mesh data and decoded textures, touches no Vulkan objects so it can run on any thread
+		struct DecodedModel
+		{
+			std::string name;
+			Data data;
+			std::vector<TextureDecoder::DecodedImage> images;	//indexed by the MaterialInfo texture indices
+			float decodeMs = 0.0f;
+			uint32_t decodeThreads = 0;
+		};
+		//loads the cooked package next to filepath when there is a valid one, otherwise imports and decodes the source files
+		static DecodedModel DecodeModelFromFile(const std::string& filepath);
+
+		struct TextureFile
+		{
+			std::string path;	//assetDir + name
+			VkFormat    format;	//uncompressed format it is decoded to
+			VkFormat    compressedFormat;	//block compressed format the cooker encodes it to
+		};
+
+		//unique texture files of the materials, fills the MaterialInfo indices
+		static std::vector<TextureFile> GatherTextureFiles(Data& data, const std::string& assetDir);
+
+		//formats the material textures are decoded to, and block compressed to by the asset cooker (see BlockCompressor)
+		static constexpr VkFormat ALBEDO_TEXTURE_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+		static constexpr VkFormat METALROUGH_TEXTURE_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;	//r metal, g roughness
+		static constexpr VkFormat NORM_TEXTURE_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+		static constexpr VkFormat OCCLUSION_TEXTURE_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+		static constexpr VkFormat ALBEDO_COMPRESSED_FORMAT = VK_FORMAT_BC7_SRGB_BLOCK;
+		static constexpr VkFormat METALROUGH_COMPRESSED_FORMAT = VK_FORMAT_BC7_UNORM_BLOCK;
+		static constexpr VkFormat NORM_COMPRESSED_FORMAT = VK_FORMAT_BC5_UNORM_BLOCK;	//xy only, z is rebuilt in GeometryPass.frag
+		static constexpr VkFormat OCCLUSION_COMPRESSED_FORMAT = VK_FORMAT_BC4_UNORM_BLOCK;	//stored linear, BC4 has no sRGB variant
+	};
+
+
+}
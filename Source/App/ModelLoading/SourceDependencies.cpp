@@ -0,0 +1,103 @@
+#include "SourceDependencies.h"
+#include "MappedFile.h"
+#include "Utils.h"
+
+//std
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+
+namespace cve
+{
+	std::vector<std::string> SourceDependencies::GatherUris(const std::string& sourcePath)
+	{
+		MappedFile source{ sourcePath };
+		if (!source.IsValid()) return {};
+
+		std::string_view json{ reinterpret_cast<const char*>(source.GetData()), source.GetSize() };
+		if (std::filesystem::path{ sourcePath }.extension() == ".glb")
+		{
+			// the JSON chunk follows the 12 byte header: uint32 length, uint32 type, then the text
+			uint32_t chunkLength = 0;
+			if (json.size() < 20) return {};
+			std::memcpy(&chunkLength, json.data() + 12, sizeof(chunkLength));
+			json = json.substr(20, std::min<size_t>(chunkLength, json.size() - 20));
+		}
+
+		constexpr std::string_view KEY = "\"uri\"";
+		std::vector<std::string> uris;
+		for (size_t pos = json.find(KEY); pos != std::string_view::npos; pos = json.find(KEY, pos))
+		{
+			pos += KEY.size();
+			while (pos < json.size() && (json[pos] == ':' || json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\r' || json[pos] == '\n')) ++pos;
+			if (pos >= json.size() || json[pos] != '"') continue;
+
+			std::string uri;
+			for (++pos; pos < json.size() && json[pos] != '"'; ++pos)
+			{
+				char c = json[pos];
+				unsigned int escaped = 0;
+				if (c == '\\' && pos + 1 < json.size())
+				{
+					c = json[++pos];	// \/ and \\, \u escapes do not show up in file names
+				}
+				else if (c == '%' && pos + 2 < json.size() &&
+					std::from_chars(json.data() + pos + 1, json.data() + pos + 3, escaped, 16).ptr == json.data() + pos + 3)
+				{
+					c = static_cast<char>(escaped);
+					pos += 2;
+				}
+				uri += c;
+			}
+			if (uri.rfind("data:", 0) != 0) uris.emplace_back(std::move(uri));
+		}
+		return uris;
+	}
+
+	SourceDependencies::Entry SourceDependencies::Describe(const std::filesystem::path& directory, const std::string& uri, bool hashContents)
+	{
+		Entry entry{ hashFNV1a(uri), 0, 0, 0 };
+		const auto path = directory / uri;
+		std::error_code ec;
+		if (!std::filesystem::is_regular_file(path, ec)) return entry;
+
+		entry.size = std::filesystem::file_size(path);
+		entry.writeTime = static_cast<int64_t>(std::filesystem::last_write_time(path).time_since_epoch().count());
+		if (hashContents) entry.contentHash = HashFile(path.string());
+		return entry;
+	}
+
+	std::vector<SourceDependencies::Entry> SourceDependencies::DescribeAll(const std::string& sourcePath)
+	{
+		const auto directory = std::filesystem::path{ sourcePath }.parent_path();
+		std::vector<Entry> entries;
+		for (const auto& uri : GatherUris(sourcePath))
+		{
+			entries.push_back(Describe(directory, uri, true));
+		}
+		return entries;
+	}
+
+	bool SourceDependencies::Match(const std::string& sourcePath, std::span<const Entry> cooked)
+	{
+		const auto directory = std::filesystem::path{ sourcePath }.parent_path();
+		const auto uris = GatherUris(sourcePath);
+		if (uris.size() != cooked.size()) return false;
+
+		for (size_t i = 0; i < uris.size(); ++i)
+		{
+			const Entry current = Describe(directory, uris[i], false);
+			if (current.uriHash != cooked[i].uriHash || current.size != cooked[i].size || current.size == 0) return false;
+			if (current.writeTime != cooked[i].writeTime && HashFile((directory / uris[i]).string()) != cooked[i].contentHash) return false;
+		}
+		return true;
+	}
+
+	uint64_t SourceDependencies::HashFile(const std::string& path)
+	{
+		MappedFile file{ path };
+		return file.IsValid() ? hashFNV1a(file.GetData(), file.GetSize()) : 0;
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+//std
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace cve
+{
+	// The files a glTF scene references by uri (its .bin buffers and images) and a stamp per file, so the mesh cache and
+	// asset packages can tell when one of them changed although the scene file itself did not.
+	// Size + mtime is the cheap check, the content hash only runs when the mtime differs, so a cache copied together with
+	// its scene (new mtimes, same bytes) stays valid.
+	class SourceDependencies final
+	{
+	public:
+		// written as is into cache and package files
+		struct Entry
+		{
+			uint64_t uriHash;
+			uint64_t size;	//0 for a missing file, which never matches
+			int64_t  writeTime;
+			uint64_t contentHash;	//0 unless requested
+		};
+
+		// external uris in document order, glTF only uses "uri" for buffers and images so the JSON is scanned for that key
+		// instead of parsed. Embedded data: uris are skipped
+		static std::vector<std::string> GatherUris(const std::string& sourcePath);
+
+		static Entry Describe(const std::filesystem::path& directory, const std::string& uri, bool hashContents);
+		// every referenced file with its content hash, what a cache or package stores when it is written
+		static std::vector<Entry> DescribeAll(const std::string& sourcePath);
+
+		// true when the scene still references the same files and none of them changed since cooked was written
+		static bool Match(const std::string& sourcePath, std::span<const Entry> cooked);
+
+		// FNV-1a over the whole file, 0 when it can't be read
+		static uint64_t HashFile(const std::string& path);
+	};
+}
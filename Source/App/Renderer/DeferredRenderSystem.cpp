@@ -1,4 +1,7 @@
 #include "DeferredRenderSystem.h"
+#include "TextureRegistry.h"
+#include "MaterialTable.h"
+#include "GeometryArena.h"
 
 //libs
 #define GLM_FORCE_RADIANS
@@ -8,23 +11,77 @@
 
 //std
 #include <array>
+#include <chrono>
+#include <cstddef>
 #include <stdexcept>
 #include <iostream>
 namespace cve {
 
+	namespace
+	{
+		//screen space error in pixels a LOD may show at a LOD bias of 1
+		constexpr float LOD_PIXEL_ERROR = 1.0f;
+
+		//world space planes (xyz normal pointing inside, w distance) from a projection * view matrix with [0,1] depth
+		std::array<glm::vec4, 6> ExtractFrustumPlanes(const glm::mat4& m)
+		{
+			auto row = [&](int i) { return glm::vec4{ m[0][i], m[1][i], m[2][i], m[3][i] }; };
+
+			std::array<glm::vec4, 6> planes{
+				row(3) + row(0),	//left
+				row(3) - row(0),	//right
+				row(3) + row(1),	//bottom
+				row(3) - row(1),	//top
+				row(2),				//near
+				row(3) - row(2)		//far
+			};
+			for (auto& plane : planes)
+			{
+				plane /= glm::length(glm::vec3{ plane });
+			}
+			return planes;
+		}
+
+		//vertex input for the active Model::VertexLayout, the depth prepass only fetches position (0) and uv (3) from binding 0
+		void SetVertexInput(PipelineConfigInfo& cfg, bool positionAndUVOnly)
+		{
+			cfg.vertexBindings = Model::GetVertexBindingDescriptions();
+			cfg.vertexAttributes = Model::GetVertexAttributeDescriptions();
+			if (positionAndUVOnly)
+			{
+				std::erase_if(cfg.vertexBindings, [](const VkVertexInputBindingDescription& binding) { return binding.binding != 0 && binding.binding != Model::INSTANCE_BINDING; });
+				std::erase_if(cfg.vertexAttributes, [](const VkVertexInputAttributeDescription& attr) { return attr.location != 0 && attr.location != 3 && attr.binding != Model::INSTANCE_BINDING; });
+			}
+
+			//GeometryArena::Bind and BindColorStream pass the strides for the compact layout (stride 0 for a missing color stream)
+			if (Model::s_VertexLayout == Model::VertexLayout::Compact)
+			{
+				cfg.dynamicStateEnables.push_back(VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE);
+				cfg.dynamicStateInfo.pDynamicStates = cfg.dynamicStateEnables.data();
+				cfg.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(cfg.dynamicStateEnables.size());
+			}
+		}
+	}
+
 
+	bool DeferredRenderSystem::s_SpecializedLighting = true;
 
-	DeferredRenderSystem::DeferredRenderSystem(Device& device, VkExtent2D extent, VkFormat swapFormat, std::shared_ptr<HDRImage>& hdrImage, std::vector<Light>& lights)
-		:m_Device{ device }, m_CPULights{lights}, m_HDRImage(hdrImage)
+	DeferredRenderSystem::DeferredRenderSystem(Device& device, PipelineBuilder& pipelineBuilder, VkExtent2D extent, VkFormat swapFormat, std::shared_ptr<HDRImage>& hdrImage, std::vector<Light>& lights)
+		:m_Device{ device }, m_PipelineBuilder{ pipelineBuilder }, m_CPULights{lights}, m_HDRImage(hdrImage)
 	{
 		assert(device.properties.limits.maxPushConstantsSize > sizeof(GeometryPassPush) && "Max supported push constant data is smaller than 256 bytes");
 		Initialize(extent, swapFormat);
+		CreateTimestampQueries();
 	}
 
 	DeferredRenderSystem::~DeferredRenderSystem()
 	{
-		vkDestroyBuffer(m_Device.device(), m_LightsBuffer, nullptr);
-		vkFreeMemory(m_Device.device(), m_LightsBufferMemory, nullptr);
+		//builds still running use the pipeline layouts destroyed below
+		for (auto& pending : m_PendingPipelines)
+		{
+			pending.build.wait();
+		}
+		m_Device.destroyBuffer(m_LightsBuffer, m_LightsBufferMemory);
 		vkDestroyDescriptorPool(m_Device.device(), m_LightingPassDescriptorPool, nullptr);
 		vkDestroyDescriptorPool(m_Device.device(), m_BlitDescriptorPool, nullptr);
 		vkDestroyPipelineLayout(m_Device.device(), m_LightPipelineLayout, nullptr);
@@ -34,11 +91,12 @@ namespace cve {
 		vkDestroyDescriptorSetLayout(m_Device.device(), m_LightingPassDescriptorSetLayout, nullptr);
 		vkDestroyDescriptorSetLayout(m_Device.device(), m_PointLightsDescriptorSetLayout, nullptr);
 		vkDestroyDescriptorSetLayout(m_Device.device(), m_BlitDescriptorSetLayout, nullptr);
-		Texture::cleanupBindless(m_Device);
+		if (m_TimestampPool != VK_NULL_HANDLE) vkDestroyQueryPool(m_Device.device(), m_TimestampPool, nullptr);
 	}
 
 	void DeferredRenderSystem::Initialize(VkExtent2D extent, VkFormat swapFormat)
 	{
+		//the pipelines build on the PipelineBuilder's workers while the targets, buffers and descriptor sets are created
 		m_GBuffer.create(m_Device, extent.width, extent.height);
 		m_LightingPassBuffer.create(m_Device, extent.width, extent.height); 
 		CreateDepthPrepassPipelineLayout();
@@ -59,6 +117,22 @@ namespace cve {
 
 #pragma region DEPTH_PREPASS_PIPELINE
 
+	bool DeferredRenderSystem::ArePipelinesReady()
+	{
+		for (const auto& pending : m_PendingPipelines)
+		{
+			if (pending.build.wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready) return false;
+		}
+		// each build leaves the list before get(), so one that throws never leaves consumed futures for the destructor to wait on
+		while (!m_PendingPipelines.empty())
+		{
+			PendingPipeline pending = std::move(m_PendingPipelines.back());
+			m_PendingPipelines.pop_back();
+			*pending.pipeline = pending.build.get();
+		}
+		return true;
+	}
+
 	void DeferredRenderSystem::CreateDepthPrepassPipelineLayout()
 	{
 
@@ -74,8 +148,8 @@ namespace cve {
 		pipelineLayoutInfo.pushConstantRangeCount = 1;
 		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
-		VkDescriptorSetLayout setLayouts[] = { Texture::s_BindlessSetLayout };
-		pipelineLayoutInfo.setLayoutCount = 1;
+		VkDescriptorSetLayout setLayouts[] = { TextureRegistry::GetSetLayout(), MaterialTable::GetSetLayout() };
+		pipelineLayoutInfo.setLayoutCount = 2;
 		pipelineLayoutInfo.pSetLayouts = setLayouts;
 
 		if (vkCreatePipelineLayout(m_Device.device(), &pipelineLayoutInfo, nullptr, &m_DepthPrepassPipelineLayout) != VK_SUCCESS)
@@ -87,13 +161,11 @@ namespace cve {
 
 	void DeferredRenderSystem::CreateDepthPrepassPipeline()
 	{
-		PipelineConfigInfo depthConfig{};
+		auto config = std::make_unique<PipelineConfigInfo>();
+		PipelineConfigInfo& depthConfig = *config;
 		Pipeline::DefaultPipelineConfigInfo(depthConfig);
 
-		auto bindDescs = Model::Vertex::GetBindingDescriptions();
-		auto attrDescs = Model::Vertex::GetAttributeDescriptions();
-		depthConfig.vertexBindings = { bindDescs[0] };
-		depthConfig.vertexAttributes = { attrDescs[0], attrDescs[3] };
+		SetVertexInput(depthConfig, true);
 		depthConfig.colorAttachmentFormats.clear();
 		depthConfig.renderingInfo.colorAttachmentCount = 0;
 		depthConfig.renderingInfo.pColorAttachmentFormats = nullptr;
@@ -105,12 +177,10 @@ namespace cve {
 
 		depthConfig.pipelineLayout = m_DepthPrepassPipelineLayout;
 
-		m_DepthPrepassPipeline = std::make_unique<Pipeline>(
-			m_Device,
-			depthConfig,
+		m_PendingPipelines.push_back({ m_PipelineBuilder.Build(std::move(config),
 			"Shaders/DepthPrepass.vert.spv",
 			"Shaders/DepthPrepass.frag.spv"
-		);
+		), &m_DepthPrepassPipeline });
 	}
 
 	void DeferredRenderSystem::RenderDepthPrepass(
@@ -119,34 +189,44 @@ namespace cve {
 		const Camera& camera)
 	{
 		m_DepthPrepassPipeline->Bind(commandBuffer);
-		Texture::bind(commandBuffer, m_DepthPrepassPipelineLayout);
+		TextureRegistry::Bind(commandBuffer, m_DepthPrepassPipelineLayout);
+		MaterialTable::Bind(commandBuffer, m_DepthPrepassPipelineLayout);
+		GeometryArena::Bind(commandBuffer);
+		++m_CullingStats.geometryBinds;
 
 
 		auto projectionViewMatrix = camera.GetProjectionMatrix() * camera.GetViewMatrix();
 
-		for (auto& gameObject : gameObjects)
+		//push constants persist between draws, only what changed is pushed again
+		uint32_t boundObject = UINT32_MAX;
+		uint32_t boundMaterial = UINT32_MAX;
+		bool colorStreamBound = false;	//GeometryArena::Bind starts with the white color
+		for (const auto& draw : m_VisibleDraws)
 		{
-			for (auto& sm : gameObject.m_Model->getData().submeshes)
+			auto& gameObject = gameObjects[draw.objectIndex];
+			if (boundObject != draw.objectIndex)
+			{
+				const glm::mat4 mvp = projectionViewMatrix * m_ObjectMatrices[draw.objectIndex];
+				vkCmdPushConstants(commandBuffer, m_DepthPrepassPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+					offsetof(DepthPush, mvp), sizeof(mvp), &mvp);
+				if (colorStreamBound != gameObject.m_Model->HasColorStream())
+				{
+					colorStreamBound = gameObject.m_Model->HasColorStream();
+					GeometryArena::BindColorStream(commandBuffer, colorStreamBound);
+					++m_CullingStats.geometryBinds;
+				}
+				++m_CullingStats.modelSwitches;
+				boundObject = draw.objectIndex;
+			}
+
+			const uint32_t materialIndex = gameObject.m_Model->GetFirstMaterial() + draw.materialIndex;
+			if (boundMaterial != materialIndex)
 			{
-				auto& mat = gameObject.m_Model->getData().materials[sm.materialIndex];
-				DepthPush push{};
-				auto modelMatrix = gameObject.m_Transform.mat4();
-				push.mvp = projectionViewMatrix * modelMatrix;
-				push.baseColorIndex = mat.baseColorIndex;
-
-
-				vkCmdPushConstants(
-					commandBuffer,
-					m_DepthPrepassPipelineLayout,
-					VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-					0,
-					sizeof(DepthPush),
-					&push
-				);
-
-				gameObject.m_Model->Bind(commandBuffer);
-				gameObject.m_Model->Draw(commandBuffer, sm.indexCount, sm.firstIndex);
+				vkCmdPushConstants(commandBuffer, m_DepthPrepassPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+					offsetof(DepthPush, materialIndex), sizeof(materialIndex), &materialIndex);
+				boundMaterial = materialIndex;
 			}
+			gameObject.m_Model->Draw(commandBuffer, draw.indexCount, draw.firstIndex, draw.instanceCount, draw.firstInstance);
 		}
 
 	}
@@ -164,13 +244,13 @@ namespace cve {
 		pushConstantRange.size = sizeof(GeometryPassPush);
 
 		VkDescriptorSetLayout setLayouts[] = {
-			Texture::s_BindlessSetLayout
-
+			TextureRegistry::GetSetLayout(),
+			MaterialTable::GetSetLayout()
 		};
 
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.setLayoutCount = 2;
 		pipelineLayoutInfo.pSetLayouts = setLayouts;
 		pipelineLayoutInfo.pushConstantRangeCount = 1;
 		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
@@ -184,10 +264,10 @@ namespace cve {
 	{
 		assert(m_GeometryPipelineLayout != nullptr && "Cannot create geometry pipeline before geometry pipeline layout");
 
-		PipelineConfigInfo cfg{};
+		auto config = std::make_unique<PipelineConfigInfo>();
+		PipelineConfigInfo& cfg = *config;
 		Pipeline::DefaultPipelineConfigInfo(cfg);
-		cfg.vertexBindings = Model::Vertex::GetBindingDescriptions();
-		cfg.vertexAttributes = Model::Vertex::GetAttributeDescriptions();
+		SetVertexInput(cfg, false);
 		cfg.colorAttachmentFormats = {
 			GBuffer::POS_FORMAT,
 			GBuffer::NORM_FORMAT,
@@ -196,14 +276,14 @@ namespace cve {
 			GBuffer::OCCLUSION_FORMAT
 		};
 		cfg.depthAttachmentFormat = GBuffer::DEPTH_FORMAT;
-		std::vector<VkPipelineColorBlendAttachmentState> blendAttachments(
+		cfg.colorBlendAttachments.assign(
 			cfg.colorAttachmentFormats.size(),
 			cfg.colorBlendAttachment
 		);
 
 		cfg.colorBlendInfo.attachmentCount =
-			static_cast<uint32_t>(blendAttachments.size());
-		cfg.colorBlendInfo.pAttachments = blendAttachments.data();
+			static_cast<uint32_t>(cfg.colorBlendAttachments.size());
+		cfg.colorBlendInfo.pAttachments = cfg.colorBlendAttachments.data();
 
 		cfg.renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
 		cfg.renderingInfo.colorAttachmentCount = static_cast<uint32_t>(cfg.colorAttachmentFormats.size());
@@ -216,9 +296,9 @@ namespace cve {
 
 		cfg.pipelineLayout = m_GeometryPipelineLayout;
 		// set cfg.renderingInfo.colorAttachmentCount = 3, pColorAttachmentFormats = cfg.colorAttachmentFormats.data(), depthAttachmentFormat = GBuffer::DEPTH_FORMAT
-		m_GeometryPipeline = std::make_unique<Pipeline>(m_Device, cfg,
-			"Shaders/GeometryPass.vert.spv",
-			"Shaders/GeometryPass.frag.spv");
+		m_PendingPipelines.push_back({ m_PipelineBuilder.Build(std::move(config),
+			Model::s_VertexLayout == Model::VertexLayout::Compact ? "Shaders/GeometryPassCompact.vert.spv" : "Shaders/GeometryPass.vert.spv",
+			"Shaders/GeometryPass.frag.spv"), &m_GeometryPipeline });
 
 	}
 
@@ -227,40 +307,261 @@ namespace cve {
 	{
 
 		m_GeometryPipeline->Bind(commandBuffer);
-		Texture::bind(commandBuffer, m_GeometryPipelineLayout);
+		TextureRegistry::Bind(commandBuffer, m_GeometryPipelineLayout);
+		MaterialTable::Bind(commandBuffer, m_GeometryPipelineLayout);
+		GeometryArena::Bind(commandBuffer);
+		++m_CullingStats.geometryBinds;
 
 
 		auto projectionViewMatrix = camera.GetProjectionMatrix() * camera.GetViewMatrix();
 
-		for (auto& gameObject : gameObjects)
+		uint32_t boundObject = UINT32_MAX;
+		uint32_t boundMaterial = UINT32_MAX;
+		bool colorStreamBound = false;	//GeometryArena::Bind starts with the white color
+		for (const auto& draw : m_VisibleDraws)
 		{
-			for (auto& sm : gameObject.m_Model->getData().submeshes)
+			auto& gameObject = gameObjects[draw.objectIndex];
+			if (boundObject != draw.objectIndex)
 			{
-				auto& mat = gameObject.m_Model->getData().materials[sm.materialIndex];
 				GeometryPassPush push{};
-				auto modelMatrix = gameObject.m_Transform.mat4();
-				GeometryPassPush pc{};
+				const auto& modelMatrix = m_ObjectMatrices[draw.objectIndex];
 				push.transform = projectionViewMatrix * modelMatrix;
 				push.modelMatrix = modelMatrix;
-				push.albedoIndex = mat.baseColorIndex;
-				push.normalIndex = mat.normalIndex;
-				push.metalRoughIndex = mat.metallicRoughIndex;
-				push.occlusionIndex = mat.occlusionIndex;
-
-
-				vkCmdPushConstants(
-					commandBuffer,
-					m_GeometryPipelineLayout,
-					VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-					0,
-					sizeof(push),
-					&push
-				);
-
-				gameObject.m_Model->Bind(commandBuffer);
-				gameObject.m_Model->Draw(commandBuffer, sm.indexCount, sm.firstIndex);
+				vkCmdPushConstants(commandBuffer, m_GeometryPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+					0, offsetof(GeometryPassPush, materialIndex), &push);
+				if (colorStreamBound != gameObject.m_Model->HasColorStream())
+				{
+					colorStreamBound = gameObject.m_Model->HasColorStream();
+					GeometryArena::BindColorStream(commandBuffer, colorStreamBound);
+					++m_CullingStats.geometryBinds;
+				}
+				++m_CullingStats.modelSwitches;
+				boundObject = draw.objectIndex;
+			}
+
+			const uint32_t materialIndex = gameObject.m_Model->GetFirstMaterial() + draw.materialIndex;
+			if (boundMaterial != materialIndex)
+			{
+				vkCmdPushConstants(commandBuffer, m_GeometryPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+					offsetof(GeometryPassPush, materialIndex), sizeof(materialIndex), &materialIndex);
+				boundMaterial = materialIndex;
+			}
+			gameObject.m_Model->Draw(commandBuffer, draw.indexCount, draw.firstIndex, draw.instanceCount, draw.firstInstance);
+		}
+	}
+
+	void DeferredRenderSystem::CreateTimestampQueries()
+	{
+		if (!m_Device.properties.limits.timestampComputeAndGraphics) return;
+
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = QUERIES_PER_FRAME * SwapChain::MAX_FRAMES_IN_FLIGHT;
+		if (vkCreateQueryPool(m_Device.device(), &poolInfo, nullptr, &m_TimestampPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create timestamp query pool!");
+		}
+	}
+
+	void DeferredRenderSystem::BeginGeometryTimer(VkCommandBuffer commandBuffer, int frameIndex)
+	{
+		if (m_TimestampPool == VK_NULL_HANDLE) return;
+
+		//BeginFrame waited on this slot's fence, so the queries it wrote last time are available
+		const uint32_t firstQuery = QUERIES_PER_FRAME * static_cast<uint32_t>(frameIndex);
+		if (m_TimestampsWritten[frameIndex])
+		{
+			std::array<uint64_t, 2> ticks{};
+			if (vkGetQueryPoolResults(m_Device.device(), m_TimestampPool, firstQuery, 2, sizeof(ticks), ticks.data(), sizeof(uint64_t),
+				VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+			{
+				m_GeometryPassMs = static_cast<float>(static_cast<double>(ticks[1] - ticks[0]) * m_Device.properties.limits.timestampPeriod * 1e-6);
+			}
+		}
+
+		vkCmdResetQueryPool(commandBuffer, m_TimestampPool, firstQuery, 2);
+		vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, m_TimestampPool, firstQuery);
+	}
+
+	void DeferredRenderSystem::EndGeometryTimer(VkCommandBuffer commandBuffer, int frameIndex)
+	{
+		if (m_TimestampPool == VK_NULL_HANDLE) return;
+
+		vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, m_TimestampPool, QUERIES_PER_FRAME * static_cast<uint32_t>(frameIndex) + 1);
+		m_TimestampsWritten[frameIndex] = true;
+	}
+
+	void DeferredRenderSystem::BeginLightingTimer(VkCommandBuffer commandBuffer, int frameIndex)
+	{
+		if (m_TimestampPool == VK_NULL_HANDLE) return;
+
+		const uint32_t firstQuery = QUERIES_PER_FRAME * static_cast<uint32_t>(frameIndex) + 2;
+		if (m_LightingTimestampsWritten[frameIndex])
+		{
+			std::array<uint64_t, 2> ticks{};
+			if (vkGetQueryPoolResults(m_Device.device(), m_TimestampPool, firstQuery, 2, sizeof(ticks), ticks.data(), sizeof(uint64_t),
+				VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+			{
+				m_LightingPassMs[static_cast<size_t>(m_TimedLightingVariants[frameIndex])] =
+					static_cast<float>(static_cast<double>(ticks[1] - ticks[0]) * m_Device.properties.limits.timestampPeriod * 1e-6);
 			}
 		}
+
+		vkCmdResetQueryPool(commandBuffer, m_TimestampPool, firstQuery, 2);
+		vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, m_TimestampPool, firstQuery);
+	}
+
+	void DeferredRenderSystem::EndLightingTimer(VkCommandBuffer commandBuffer, int frameIndex)
+	{
+		if (m_TimestampPool == VK_NULL_HANDLE) return;
+
+		//RenderLighting picked the variant in between
+		vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, m_TimestampPool, QUERIES_PER_FRAME * static_cast<uint32_t>(frameIndex) + 3);
+		m_TimedLightingVariants[frameIndex] = m_LightingVariant;
+		m_LightingTimestampsWritten[frameIndex] = true;
+	}
+
+	void DeferredRenderSystem::CullMeshlets(std::vector<GameObject>& gameObjects, const Camera& camera, VkExtent2D extent)
+	{
+		m_VisibleDraws.clear();
+		m_CullingStats = {};
+		m_ObjectMatrices.resize(gameObjects.size());
+
+		const auto planes = ExtractFrustumPlanes(camera.GetProjectionMatrix() * camera.GetViewMatrix());
+		const glm::vec3 eye = camera.GetPosition();
+
+		//pixels covered by one world unit at distance 1, proj[1][1] is 1 / tan(fovy / 2)
+		const float pixelsPerUnit = 0.5f * static_cast<float>(extent.height) * glm::abs(camera.GetProjectionMatrix()[1][1]);
+		const float maxPixelError = LOD_PIXEL_ERROR * m_LodBias;
+
+		auto addDraw = [&](uint32_t objectIndex, uint32_t materialIndex, uint32_t firstIndex, uint32_t indexCount, uint32_t firstInstance, uint32_t instanceCount)
+		{
+			//meshlets of a submesh are contiguous in the index buffer, so visible neighbours become one draw
+			if (!m_VisibleDraws.empty())
+			{
+				auto& last = m_VisibleDraws.back();
+				if (last.objectIndex == objectIndex && last.materialIndex == materialIndex && last.firstIndex + last.indexCount == firstIndex &&
+					last.firstInstance == firstInstance && last.instanceCount == instanceCount)
+				{
+					last.indexCount += indexCount;
+					return;
+				}
+			}
+			m_VisibleDraws.push_back({ objectIndex, materialIndex, firstIndex, indexCount, firstInstance, instanceCount });
+		};
+
+		auto isSphereVisible = [&](const glm::vec3& center, float radius)
+		{
+			for (const auto& plane : planes)
+			{
+				if (glm::dot(glm::vec3{ plane }, center) + plane.w < -radius) return false;
+			}
+			return true;
+		};
+
+		//bounds are in mesh space, their radius scales with the largest axis
+		auto getMaxScale = [](const glm::mat4& m)
+		{
+			return glm::max(glm::length(glm::vec3{ m[0] }), glm::max(glm::length(glm::vec3{ m[1] }), glm::length(glm::vec3{ m[2] })));
+		};
+
+		//coarsest level whose error, projected at the nearest point of the submesh bounds, stays under the pixel budget
+		auto selectLod = [&](const Model::SubMesh& sm, const glm::mat4& modelMatrix, float maxScale) -> uint32_t
+		{
+			if (sm.lodCount == 0 || maxPixelError <= 0.0f) return 0;
+
+			const glm::vec3 center = glm::vec3{ modelMatrix * glm::vec4{ sm.boundsCenter[0], sm.boundsCenter[1], sm.boundsCenter[2], 1.0f } };
+			const float distance = glm::length(center - eye) - sm.boundsRadius * maxScale;
+			if (distance <= 0.0f) return 0;
+
+			for (uint32_t level = sm.lodCount; level > 0; --level)
+			{
+				if (sm.lods[level - 1].error * maxScale * pixelsPerUnit / distance <= maxPixelError) return level;
+			}
+			return 0;
+		};
+
+		for (uint32_t objectIndex = 0; objectIndex < gameObjects.size(); ++objectIndex)
+		{
+			auto& gameObject = gameObjects[objectIndex];
+			const glm::mat4 modelMatrix = gameObject.m_Transform.mat4();
+			m_ObjectMatrices[objectIndex] = modelMatrix;
+
+			const auto& data = gameObject.m_Model->getData();
+			for (const auto& sm : data.submeshes)
+			{
+				if (sm.instanceCount == 0) continue;
+
+				//a repeated mesh stays one instanced draw: culled as a whole on its bounds, at the finest LOD any visible instance needs
+				if (sm.instanceCount > 1)
+				{
+					uint32_t level = UINT32_MAX;
+					for (uint32_t i = sm.firstInstance; i < sm.firstInstance + sm.instanceCount; ++i)
+					{
+						const glm::mat4 instanceMatrix = modelMatrix * data.instanceTransforms[i];
+						const float scale = getMaxScale(instanceMatrix);
+						const glm::vec3 center = glm::vec3{ instanceMatrix * glm::vec4{ sm.boundsCenter[0], sm.boundsCenter[1], sm.boundsCenter[2], 1.0f } };
+						if (!m_MeshletCulling || isSphereVisible(center, sm.boundsRadius * scale))
+						{
+							level = glm::min(level, selectLod(sm, instanceMatrix, scale));
+						}
+					}
+					if (level == UINT32_MAX) continue;
+
+					const Model::Lod lod = sm.GetLod(level);
+					m_CullingStats.submeshesPerLod[level] += sm.instanceCount;
+					m_CullingStats.clustersDrawn += lod.meshletCount * sm.instanceCount;
+					addDraw(objectIndex, sm.materialIndex, lod.firstIndex, lod.indexCount, sm.firstInstance, sm.instanceCount);
+					continue;
+				}
+
+				//single instance: per meshlet test, cone axes go through the normal matrix
+				const glm::mat4 instanceMatrix = modelMatrix * data.instanceTransforms[sm.firstInstance];
+				const float maxScale = getMaxScale(instanceMatrix);
+				const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3{ instanceMatrix }));
+
+				const uint32_t level = selectLod(sm, instanceMatrix, maxScale);
+				const Model::Lod lod = sm.GetLod(level);
+				++m_CullingStats.submeshesPerLod[level];
+
+				if (!m_MeshletCulling || lod.meshletCount == 0)
+				{
+					m_CullingStats.clustersDrawn += lod.meshletCount;
+					addDraw(objectIndex, sm.materialIndex, lod.firstIndex, lod.indexCount, sm.firstInstance, 1);
+					continue;
+				}
+
+				const bool testCone = !data.materials[sm.materialIndex].doubleSided;
+				for (uint32_t m = lod.firstMeshlet; m < lod.firstMeshlet + lod.meshletCount; ++m)
+				{
+					const auto& meshlet = data.meshlets[m];
+					++m_CullingStats.clustersTested;
+
+					const glm::vec3 center = glm::vec3{ instanceMatrix * glm::vec4{ meshlet.center[0], meshlet.center[1], meshlet.center[2], 1.0f } };
+					const float radius = meshlet.radius * maxScale;
+
+					bool visible = isSphereVisible(center, radius);
+					if (visible && testCone && meshlet.coneCutoff < 1.0f)
+					{
+						const glm::vec3 axis = glm::normalize(normalMatrix * glm::vec3{ meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2] });
+						const glm::vec3 toCenter = center - eye;
+						visible = glm::dot(toCenter, axis) < meshlet.coneCutoff * glm::length(toCenter) + radius;
+					}
+
+					if (!visible) continue;
+
+					++m_CullingStats.clustersDrawn;
+					addDraw(objectIndex, sm.materialIndex, meshlet.firstIndex, meshlet.indexCount, sm.firstInstance, 1);
+				}
+			}
+		}
+
+		m_CullingStats.drawCalls = static_cast<uint32_t>(m_VisibleDraws.size());
+		for (const auto& draw : m_VisibleDraws)
+		{
+			m_CullingStats.trianglesDrawn += uint64_t(draw.indexCount / 3) * draw.instanceCount;
+		}
 	}
 
 	void DeferredRenderSystem::UpdateGeometry(std::vector<GameObject>& gameObjects, float deltaTime)
@@ -271,13 +572,23 @@ namespace cve {
 
 	void DeferredRenderSystem::RecreateGBuffer(VkExtent2D extent, VkFormat swapFormat)
 	{
-		vkDeviceWaitIdle(m_Device.device());
+		//the frames in flight still render to the old targets and read them through the old descriptor sets, those go
+		//once the frames are done instead of waiting for the device here
+		auto oldGBuffer = std::make_shared<GBuffer>(std::move(m_GBuffer));
+		auto oldLightBuffer = std::make_shared<LightBuffer>(std::move(m_LightingPassBuffer));
+		m_Device.deletionQueue().retire([device = m_Device.device(), oldGBuffer, oldLightBuffer,
+			lightingPool = m_LightingPassDescriptorPool, blitPool = m_BlitDescriptorPool]
+		{
+			vkDestroyDescriptorPool(device, lightingPool, nullptr);
+			vkDestroyDescriptorPool(device, blitPool, nullptr);
+			oldGBuffer->cleanup();
+			oldLightBuffer->cleanup();
+		});
 
-		m_GBuffer.cleanup();
 		m_GBuffer.create(m_Device, extent.width, extent.height);
-
-		vkDestroyDescriptorPool(m_Device.device(), m_LightingPassDescriptorPool, nullptr);
+		m_LightingPassBuffer.create(m_Device, extent.width, extent.height);
 		CreateLightingDescriptorSet();
+		CreateBlitDescriptorSet();
 	}
 #pragma endregion
 
@@ -479,32 +790,32 @@ namespace cve {
 
 	void DeferredRenderSystem::CreateLightingPipeline()
 	{
-		PipelineConfigInfo cfg{};
-		Pipeline::DefaultPipelineConfigInfo(cfg);
-		cfg.colorAttachmentFormats = { LightBuffer::HDR_FORMAT };
-		cfg.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
-		cfg.pipelineLayout = m_LightPipelineLayout;
-		cfg.renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
-		cfg.renderingInfo.colorAttachmentCount = 1;
-		cfg.renderingInfo.pColorAttachmentFormats = cfg.colorAttachmentFormats.data();
-		cfg.renderingInfo.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
-
-		m_LightPipeline = std::make_unique<Pipeline>(
-			m_Device, cfg,
-			"Shaders/Triangle.vert.spv",
-			"Shaders/LightingPass.frag.spv"
-		);
+		for (uint32_t variant = 0; variant < static_cast<uint32_t>(LightingVariant::COUNT); ++variant)
+		{
+			auto config = std::make_unique<PipelineConfigInfo>();
+			PipelineConfigInfo& cfg = *config;
+			Pipeline::DefaultPipelineConfigInfo(cfg);
+			cfg.colorAttachmentFormats = { LightBuffer::HDR_FORMAT };
+			cfg.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+			cfg.pipelineLayout = m_LightPipelineLayout;
+			cfg.renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+			cfg.renderingInfo.colorAttachmentCount = 1;
+			cfg.renderingInfo.pColorAttachmentFormats = cfg.colorAttachmentFormats.data();
+			cfg.renderingInfo.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+			cfg.fragmentSpecialization = { variant };	//LIGHT_TYPES
+
+			m_PendingPipelines.push_back({ m_PipelineBuilder.Build(std::move(config),
+				"Shaders/Triangle.vert.spv",
+				"Shaders/LightingPass.frag.spv"
+			), &m_LightPipelines[variant] });
+		}
 	}
 
 	void DeferredRenderSystem::RenderLighting(VkCommandBuffer cb, const Camera& camera, VkExtent2D extent)
 	{
 		// copy into ssbo
 		uint32_t count = std::min((size_t)m_CPULights.size(), m_MaxLights);
-		void* ptr = nullptr;
-		vkMapMemory(m_Device.device(), m_LightsBufferMemory, 0,
-			sizeof(Light) * count, 0, &ptr);
-		memcpy(ptr, m_CPULights.data(), sizeof(Light) * count);
-		vkUnmapMemory(m_Device.device(), m_LightsBufferMemory); 
+		memcpy(m_LightsBufferMemory.mapped, m_CPULights.data(), sizeof(Light) * count);
 
 		LightingPassPush pushConstantData;
 		pushConstantData.resolution = glm::vec2(
@@ -516,6 +827,14 @@ namespace cve {
 		pushConstantData.view = camera.GetViewMatrix();
 		pushConstantData.proj = camera.GetProjectionMatrix(); 
 
+		//the variant with exactly the light types in use, no lights leaves the image based lighting
+		uint32_t lightTypes = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			lightTypes |= 1u << static_cast<uint32_t>(m_CPULights[i].type);
+		}
+		m_LightingVariant = s_SpecializedLighting ? static_cast<LightingVariant>(lightTypes) : LightingVariant::Mixed;
+
 		VkDescriptorSet sets[] = { m_LightDescriptorSet, m_PointLightsDescriptorSet };
 
 		vkCmdBindDescriptorSets(cb,
@@ -528,14 +847,15 @@ namespace cve {
 			0, sizeof(pushConstantData),
 			&pushConstantData);
 
-		m_LightPipeline->Bind(cb);
+		m_LightPipelines[static_cast<size_t>(m_LightingVariant)]->Bind(cb);
 		// draw triangle trick
 		vkCmdDraw(cb, 3, 1, 0, 0); 
 	}
 
 	void DeferredRenderSystem::CreateLightsBuffer(size_t maxLights)
 	{
-		m_MaxLights = maxLights;
+		//room for one light at least, a scene lit by the environment alone still binds the buffer
+		m_MaxLights = std::max<size_t>(maxLights, 1);
 		VkDeviceSize bufferSize = sizeof(Light) * m_MaxLights;
 		m_Device.createBuffer(
 			bufferSize,
@@ -579,27 +899,30 @@ namespace cve {
 
 	void DeferredRenderSystem::CreateBlitPipeline(VkFormat swapFormat)
 	{
-		PipelineConfigInfo cfg{};
-		Pipeline::DefaultPipelineConfigInfo(cfg); 
-
-		// no vertex buffers: triangle uses gl_VertexIndex
-		cfg.vertexBindings.clear();
-		cfg.vertexAttributes.clear();
-
-		cfg.colorAttachmentFormats = { swapFormat };
-		cfg.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
-		cfg.pipelineLayout = m_BlitPipelineLayout;
-
-		cfg.renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
-		cfg.renderingInfo.colorAttachmentCount = 1;
-		cfg.renderingInfo.pColorAttachmentFormats = cfg.colorAttachmentFormats.data();
-
-		m_BlitPipeline = std::make_unique<Pipeline>(
-			m_Device,
-			cfg,
-			"Shaders/Triangle.vert.spv",
-			"Shaders/Blit.frag.spv"
-		);
+		for (uint32_t output = 0; output < static_cast<uint32_t>(DebugOutput::COUNT); ++output)
+		{
+			auto config = std::make_unique<PipelineConfigInfo>();
+			PipelineConfigInfo& cfg = *config;
+			Pipeline::DefaultPipelineConfigInfo(cfg); 
+
+			// no vertex buffers: triangle uses gl_VertexIndex
+			cfg.vertexBindings.clear();
+			cfg.vertexAttributes.clear();
+
+			cfg.colorAttachmentFormats = { swapFormat };
+			cfg.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+			cfg.pipelineLayout = m_BlitPipelineLayout;
+
+			cfg.renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+			cfg.renderingInfo.colorAttachmentCount = 1;
+			cfg.renderingInfo.pColorAttachmentFormats = cfg.colorAttachmentFormats.data();
+			cfg.fragmentSpecialization = { output };	//DEBUG_OUTPUT
+
+			m_PendingPipelines.push_back({ m_PipelineBuilder.Build(std::move(config),
+				"Shaders/Triangle.vert.spv",
+				"Shaders/Blit.frag.spv"
+			), &m_BlitPipelines[output] });
+		}
 	}
 
 	void DeferredRenderSystem::CreateBlitDescriptorSet()
@@ -642,6 +965,18 @@ namespace cve {
 		vkUpdateDescriptorSets(m_Device.device(), 1, &write, 0, nullptr);
 	}
 
+	const char* DeferredRenderSystem::GetLightingVariantName(LightingVariant variant)
+	{
+		static const char* names[] = {
+		"IBL only",
+		"point only",
+		"directional only",
+		"mixed"
+		};
+		static_assert(std::size(names) == static_cast<size_t>(LightingVariant::COUNT));
+		return names[static_cast<size_t>(variant)];
+	}
+
 	void DeferredRenderSystem::CycleDebugOutput()
 	{
 		int mode = static_cast<int>(m_DebugOutput);
@@ -713,7 +1048,7 @@ namespace cve {
 		vkUpdateDescriptorSets(m_Device.device(), 1, &write, 0, nullptr);
 
 		// Bind blit/tone-map pipeline
-		m_BlitPipeline->Bind(commandBuffer);
+		m_BlitPipelines[static_cast<size_t>(m_DebugOutput)]->Bind(commandBuffer);
 		vkCmdBindDescriptorSets(
 			commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
 			m_BlitPipelineLayout, 0, 1,
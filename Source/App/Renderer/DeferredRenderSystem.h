@@ -1,14 +1,18 @@
 #pragma once
 #include "Pipeline.h"
+#include "PipelineBuilder.h"
 #include "Device.h"
 #include "GameObject.h"
 #include "Camera.h"
 #include "Texture.h"
 #include "GBuffer.h"
+#include "SwapChain.h"
 
 
 
 //std 
+#include <array>
+#include <future>
 #include <memory>
 #include <vector>
 
@@ -19,14 +23,12 @@
 namespace cve
 {
 
+	//matrices are pushed when the drawn object changes, the material index when the material does
 	struct GeometryPassPush
 	{
 		glm::mat4 transform;       //  64 bytes
 		glm::mat4 modelMatrix;     //  64 bytes
-		uint32_t albedoIndex;      //   4 bytes
-		uint32_t normalIndex;      //   4 bytes
-		uint32_t metalRoughIndex;  //   4 bytes
-		uint32_t occlusionIndex;   //   4 bytes
+		uint32_t materialIndex;    //   4 bytes, row in the MaterialTable
 
 	};
 
@@ -42,7 +44,7 @@ namespace cve
 	struct DepthPush
 	{
 		glm::mat4 mvp;
-		uint32_t baseColorIndex;
+		uint32_t materialIndex;
 	};
 
 	enum class LightType : uint32_t { Point = 0, Directional = 1 };
@@ -57,6 +59,29 @@ namespace cve
 		float     lightIntensity{};
 	};
 
+	//per frame counters of the meshlet culling pass and the passes drawing its result
+	struct CullingStats
+	{
+		uint32_t clustersTested = 0;
+		uint32_t clustersDrawn = 0;
+		uint32_t drawCalls = 0;	//visible neighbouring clusters are merged into one draw
+		uint64_t trianglesDrawn = 0;
+		uint32_t submeshesPerLod[Model::MAX_LOD_COUNT]{};	//counts instances
+		uint32_t geometryBinds = 0;	//GeometryArena binds and color stream switches over both passes
+		uint32_t modelSwitches = 0;	//draws that moved on to another object, each was a bind with buffers per model
+	};
+
+	//lighting pass pipelines, the value is LightingPass.frag's LIGHT_TYPES specialization constant: one bit per LightType
+	//present in the lights. The render system binds the variant matching its lights
+	enum class LightingVariant : uint32_t {
+		IBLOnly = 0,
+		PointOnly = 1 << static_cast<uint32_t>(LightType::Point),
+		DirectionalOnly = 1 << static_cast<uint32_t>(LightType::Directional),
+		Mixed = PointOnly | DirectionalOnly,	//branches per light, what every frame ran before the variants
+		COUNT
+	};
+
+	//also the DEBUG_OUTPUT specialization constant of Blit.frag, one blit pipeline per value
 	enum class DebugOutput { 
 		Lighting = 0,
 		Position,
@@ -71,7 +96,8 @@ namespace cve
 	class DeferredRenderSystem final
 	{
 	public:
-		DeferredRenderSystem(Device& device, VkExtent2D extent, VkFormat swapFormat,std::shared_ptr<HDRImage>& hdrImage, std::vector<Light>& lights);
+		//the pipelines are handed to the builder, nothing may be recorded before ArePipelinesReady returned true
+		DeferredRenderSystem(Device& device, PipelineBuilder& pipelineBuilder, VkExtent2D extent, VkFormat swapFormat,std::shared_ptr<HDRImage>& hdrImage, std::vector<Light>& lights);
 		~DeferredRenderSystem();
 
 		DeferredRenderSystem(const DeferredRenderSystem& other) = delete;
@@ -80,6 +106,8 @@ namespace cve
 		DeferredRenderSystem& operator=(const DeferredRenderSystem&& rhs) = delete;
 
 		void Initialize(VkExtent2D extent, VkFormat swapFormat); 
+		//doesn't block, true once every pipeline is built (rethrows a failed build)
+		bool ArePipelinesReady();
 		void RenderGeometry(VkCommandBuffer commandBuffer, std::vector<GameObject>& gameObjects, const Camera& camera);
 		void UpdateGeometry(std::vector<GameObject>& gameObjects, float deltaTime);
 		void RenderLighting(VkCommandBuffer cb, const Camera& camera, VkExtent2D extent);
@@ -87,6 +115,34 @@ namespace cve
 		void RecreateGBuffer(VkExtent2D extent, VkFormat swapFormat);
 		void RenderDepthPrepass(VkCommandBuffer commandBuffer, std::vector<GameObject>& gameObjects, const Camera& camera);
 		void CycleDebugOutput(); 
+		DebugOutput GetDebugOutput() const { return m_DebugOutput; }
+
+		//false: always the Mixed lighting variant, for comparing against the specialized ones
+		static bool s_SpecializedLighting;
+		LightingVariant GetLightingVariant() const { return m_LightingVariant; }
+		static const char* GetLightingVariantName(LightingVariant variant);
+
+		//picks a LOD per submesh, then frustum + normal cone test per meshlet of that LOD. Fills the draw list both the depth prepass
+		//and the geometry pass use, call once per frame before them
+		void CullMeshlets(std::vector<GameObject>& gameObjects, const Camera& camera, VkExtent2D extent);
+		void ToggleMeshletCulling() { m_MeshletCulling = !m_MeshletCulling; }
+
+		//scales the projected error a LOD may have, 0 always draws LOD 0 and 2 allows twice the error of 1
+		void SetLodBias(float bias) { m_LodBias = glm::max(bias, 0.0f); }
+		float GetLodBias() const { return m_LodBias; }
+		const CullingStats& GetCullingStats() const { return m_CullingStats; }
+
+		//GPU timestamps around the geometry pass. Begin goes before BeginRenderingGeometry (it resets the frame's queries), End after
+		//EndRenderingGeometry. The result is read back once the frame slot comes around again, so it lags MAX_FRAMES_IN_FLIGHT frames
+		void BeginGeometryTimer(VkCommandBuffer commandBuffer, int frameIndex);
+		void EndGeometryTimer(VkCommandBuffer commandBuffer, int frameIndex);
+		float GetGeometryPassMs() const { return m_GeometryPassMs; }
+		//same around the lighting pass (BeginRenderingLighting / EndRenderingLighting), measured per variant
+		void BeginLightingTimer(VkCommandBuffer commandBuffer, int frameIndex);
+		void EndLightingTimer(VkCommandBuffer commandBuffer, int frameIndex);
+		float GetLightingPassMs() const { return m_LightingPassMs[static_cast<size_t>(m_LightingVariant)]; }
+		//last measured time of the variant, 0 if it never ran
+		float GetLightingPassMs(LightingVariant variant) const { return m_LightingPassMs[static_cast<size_t>(variant)]; }
 
 		GBuffer& GetGBuffer() { return m_GBuffer;  }
 		LightBuffer& GetLightBuffer() { return m_LightingPassBuffer; }
@@ -108,22 +164,32 @@ namespace cve
 		void CreateBlitPipeline(VkFormat swapFormat);
 		void CreateBlitDescriptorSet();
 		void CreateLightsBuffer(size_t maxLights);
+		void CreateTimestampQueries();
 
 
 
 
 
 		Device& m_Device;
+		PipelineBuilder&			m_PipelineBuilder;
 		GBuffer						m_GBuffer;
 		LightBuffer					m_LightingPassBuffer;  
 		VkPipelineLayout			m_GeometryPipelineLayout, m_LightPipelineLayout, m_DepthPrepassPipelineLayout, m_BlitPipelineLayout;
-		std::unique_ptr<Pipeline>	m_GeometryPipeline, m_LightPipeline, m_DepthPrepassPipeline, m_BlitPipeline;
+		std::shared_ptr<Pipeline>	m_GeometryPipeline, m_DepthPrepassPipeline;
+		std::array<std::shared_ptr<Pipeline>, static_cast<size_t>(LightingVariant::COUNT)> m_LightPipelines;
+		std::array<std::shared_ptr<Pipeline>, static_cast<size_t>(DebugOutput::COUNT)>     m_BlitPipelines;
+		struct PendingPipeline
+		{
+			std::future<std::shared_ptr<Pipeline>> build;
+			std::shared_ptr<Pipeline>*             pipeline;	//member the build moves into
+		};
+		std::vector<PendingPipeline> m_PendingPipelines;
 		VkDescriptorSet				m_GeometryDescriptorSet, m_LightDescriptorSet, m_BlitDescriptorSet; 
 		VkDescriptorSetLayout		m_LightingPassDescriptorSetLayout, m_BlitDescriptorSetLayout; 
 		VkDescriptorPool			m_LightingPassDescriptorPool, m_BlitDescriptorPool;
 
 		VkBuffer				m_LightsBuffer; 
-		VkDeviceMemory			m_LightsBufferMemory;
+		MemoryAllocation		m_LightsBufferMemory;
 		size_t					m_MaxLights = 0; 
 		VkDescriptorSetLayout   m_PointLightsDescriptorSetLayout;
 		VkDescriptorPool        m_PointLightsDescriptorPool;
@@ -131,6 +197,31 @@ namespace cve
 
 		std::vector<Light> m_CPULights;
 
+		struct MeshletDraw
+		{
+			uint32_t objectIndex;
+			uint32_t materialIndex;
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			uint32_t firstInstance;
+			uint32_t instanceCount;
+		};
+		std::vector<MeshletDraw> m_VisibleDraws;
+		std::vector<glm::mat4>   m_ObjectMatrices;
+		CullingStats             m_CullingStats{};
+		bool                     m_MeshletCulling = true;
+		float                    m_LodBias = 1.0f;
+
+		//per frame in flight: geometry begin / end, lighting begin / end. Null when the queue cannot write timestamps
+		VkQueryPool              m_TimestampPool = VK_NULL_HANDLE;
+		static constexpr uint32_t QUERIES_PER_FRAME = 4;
+		std::array<bool, SwapChain::MAX_FRAMES_IN_FLIGHT> m_TimestampsWritten{};
+		std::array<bool, SwapChain::MAX_FRAMES_IN_FLIGHT> m_LightingTimestampsWritten{};
+		std::array<LightingVariant, SwapChain::MAX_FRAMES_IN_FLIGHT> m_TimedLightingVariants{};	//the variant the frame's lighting queries measured
+		float                    m_GeometryPassMs = 0.0f;
+		std::array<float, static_cast<size_t>(LightingVariant::COUNT)> m_LightingPassMs{};
+		LightingVariant          m_LightingVariant{ LightingVariant::Mixed };
+
 		std::shared_ptr<HDRImage> m_HDRImage;
 		DebugOutput m_DebugOutput{ DebugOutput::Lighting };
 
@@ -24,6 +24,11 @@ namespace cve {
 
 		auto result = m_SwapChain->acquireNextImage(&m_CurrentImageIndex);
 
+		//acquireNextImage waited on the fence of this frame's slot: the frame submitted to it MAX_FRAMES_IN_FLIGHT frames
+		//ago is done, the ones before it were waited on by the earlier frames
+		const uint64_t completedFrames = m_FrameNumber >= SwapChain::MAX_FRAMES_IN_FLIGHT ? m_FrameNumber - SwapChain::MAX_FRAMES_IN_FLIGHT + 1 : 0;
+		m_Device.deletionQueue().collect(m_FrameNumber, completedFrames);
+
 		if (result == VK_ERROR_OUT_OF_DATE_KHR)
 		{
 			RecreateSwapChain();
@@ -78,6 +83,7 @@ namespace cve {
 
 		m_IsFrameStarted = false; 
 		m_CurrentFrameIndex = (m_CurrentFrameIndex + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT; 
+		++m_FrameNumber;
 	}
 
 
@@ -162,7 +168,7 @@ namespace cve {
 		colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
 		colorAttachment.imageView = lightingBuffer.getImageView();
 		colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;	//the full screen triangle writes every pixel
 		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		colorAttachment.clearValue.color = { 0.01f,0.01f,0.01f,1.f };
 
@@ -210,7 +216,7 @@ namespace cve {
 #pragma endregion
 
 #pragma region GEOMETRY_PASS
-	void Renderer::BeginRenderingGeometry(VkCommandBuffer commandBuffer, GBuffer& gBuffer)
+	void Renderer::BeginRenderingGeometry(VkCommandBuffer commandBuffer, GBuffer& gBuffer, bool clearColors)
 	{
 		// 1) Set up the three G-Buffer color attachments (pos, normal, albedo, metalRough, occlusion):
 		VkRenderingAttachmentInfo cols[5]{};
@@ -298,12 +304,18 @@ namespace cve {
 			);
 			layoutDepth = desiredDepth;  
 		}
+		// the lighting pass writes the sky wherever the depth prepass left the far plane and reads the G-buffer everywhere
+		// else, so DONT_CARE is only safe while the geometry pass writes every pixel the prepass covered. Both passes must
+		// keep identical coverage (same alpha test, MaterialBaseColor in MaterialTable.glsl), or those pixels read
+		// undefined memory. The debug views show the sky pixels as well
+		const VkAttachmentLoadOp colorLoadOp = clearColors ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+
 		// Position (RGBA16F)
 		cols[0].sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
 		cols[0].pNext = nullptr;
 		cols[0].imageView = gBuffer.getPositionView();
 		cols[0].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		cols[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		cols[0].loadOp = colorLoadOp;
 		cols[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		cols[0].clearValue.color = { {0.0f, 0.0f, 0.0f, 1.0f} };
 
@@ -312,7 +324,7 @@ namespace cve {
 		cols[1].pNext = nullptr;
 		cols[1].imageView = gBuffer.getNormalView();
 		cols[1].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		cols[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		cols[1].loadOp = colorLoadOp;
 		cols[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		cols[1].clearValue.color = { {0.0f, 0.0f, 0.0f, 1.0f} };
 
@@ -321,7 +333,7 @@ namespace cve {
 		cols[2].pNext = nullptr;
 		cols[2].imageView = gBuffer.getAlbedoSpecView();
 		cols[2].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		cols[2].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		cols[2].loadOp = colorLoadOp;
 		cols[2].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		cols[2].clearValue.color = { {0.0f, 0.0f, 0.0f, 1.0f} };
 
@@ -330,7 +342,7 @@ namespace cve {
 		cols[3].pNext = nullptr;
 		cols[3].imageView = gBuffer.getMetalRoughView();
 		cols[3].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		cols[3].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		cols[3].loadOp = colorLoadOp;
 		cols[3].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		cols[3].clearValue.color = { {0.0f, 0.0f, 0.0f, 1.0f} };
 
@@ -339,7 +351,7 @@ namespace cve {
 		cols[4].pNext = nullptr;
 		cols[4].imageView = gBuffer.getOcclusionView();
 		cols[4].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		cols[4].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		cols[4].loadOp = colorLoadOp;
 		cols[4].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		cols[4].clearValue.color = { {0.0f, 0.0f, 0.0f, 1.0f} };
 
@@ -352,7 +364,7 @@ namespace cve {
 		depth.imageView = gBuffer.getDepthView();
 		depth.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 		depth.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-		depth.storeOp = VK_ATTACHMENT_STORE_OP_STORE; 
+		depth.storeOp = VK_ATTACHMENT_STORE_OP_NONE;	//depth test only, the prepass already stored what lighting reads
 		depth.clearValue.depthStencil = { 1.0f, 0 };
 
 		// 3) The VkRenderingInfo itself
@@ -470,7 +482,7 @@ namespace cve {
 
 #pragma region BLITTING
 
-	void Renderer::BeginRenderingBlittingPass(VkCommandBuffer commandBuffer)
+	void Renderer::BeginRenderingBlittingPass(VkCommandBuffer commandBuffer, bool clear)
 	{
 		assert(m_IsFrameStarted && "Can't call BeginRenderingBlittingPass while frame not in progress");
 		assert(commandBuffer == GetCurrentCommandBuffer() && "Wrong command buffer");
@@ -492,7 +504,7 @@ namespace cve {
 		colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
 		colorAttachment.imageView = m_SwapChain->getImageView(m_CurrentImageIndex);
 		colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;	//the blit writes every pixel
 		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		colorAttachment.clearValue.color = { {0.0f, 0.0f, 0.0f, 1.0f} };
 
@@ -636,7 +648,6 @@ namespace cve {
 			glfwWaitEvents();
 		}
 
-		vkDeviceWaitIdle(m_Device.device());
 		if (m_SwapChain == nullptr)
 		{
 			m_SwapChain = std::make_unique<SwapChain>(m_Device, extent);
@@ -650,6 +661,9 @@ namespace cve {
 			{
 				throw std::runtime_error("Swap chain image or depth has changed :)");
 			}
+
+			//no wait for the device, the frames in flight still present from the old swap chain
+			m_Device.deletionQueue().retire([oldSwapChain]() mutable { oldSwapChain.reset(); });
 		}
 
 		m_SwapchainImageLayouts = std::vector<VkImageLayout>(
@@ -26,11 +26,13 @@ namespace cve {
 		void EndFrame(); 
 		void BeginRenderingLighting(VkCommandBuffer commandBuffer, LightBuffer& lightBuffer);
 		void EndRenderingLighting(VkCommandBuffer commandBuffer, LightBuffer& lightBuffer);
-		void BeginRenderingGeometry(VkCommandBuffer commandBuffer, GBuffer& gBuffer);
+		//clearColors: clear the color targets instead of leaving them undefined where no geometry is, for the debug views
+		void BeginRenderingGeometry(VkCommandBuffer commandBuffer, GBuffer& gBuffer, bool clearColors = false);
 		void EndRenderingGeometry(VkCommandBuffer commandBuffer, GBuffer& gBuffer); 
 		void BeginRenderingDepthPrepass(VkCommandBuffer commandBuffer, GBuffer& gBuffer);
 		void EndRenderingDepthPrepass(VkCommandBuffer commandBuffer);
-		void BeginRenderingBlittingPass(VkCommandBuffer commandBuffer);
+		//clear: for frames that draw nothing into the swapchain image, the blit overwrites every pixel otherwise
+		void BeginRenderingBlittingPass(VkCommandBuffer commandBuffer, bool clear = false);
 		void EndRenderingBlittingPass(VkCommandBuffer commandBuffer); 
 
 
@@ -72,6 +74,7 @@ namespace cve {
 
 		uint32_t m_CurrentImageIndex;
 		int m_CurrentFrameIndex = 0;
+		uint64_t m_FrameNumber = 0;	//frames submitted so far, the frame count the DeletionQueue is collected with
 		bool m_IsFrameStarted = false;
 		std::vector<VkImageLayout> m_SwapchainImageLayouts;
 
@@ -0,0 +1,106 @@
+#pragma once
+
+//std
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace cve
+{
+	// bounded multi producer / multi consumer queue (Vyukov). Every cell carries a sequence number, producers and consumers
+	// claim a position with a CAS on their own counter and never wait on each other, a full or empty queue just fails
+	template <typename T>
+	class LockFreeQueue final
+	{
+	public:
+		// capacity is rounded up to a power of two
+		explicit LockFreeQueue(std::size_t capacity)
+			: m_Capacity{ std::bit_ceil(capacity < 2 ? std::size_t{ 2 } : capacity) }
+			, m_Cells{ std::make_unique<Cell[]>(m_Capacity) }
+		{
+			for (std::size_t i = 0; i < m_Capacity; ++i)
+			{
+				m_Cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		LockFreeQueue(const LockFreeQueue&) = delete;
+		LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+		// false when the queue is full, value is left untouched then
+		bool TryPush(T&& value)
+		{
+			std::size_t pos = m_EnqueuePos.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				Cell& cell = m_Cells[pos & (m_Capacity - 1)];
+				std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+				std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+				if (diff == 0)
+				{
+					if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						cell.value = std::move(value);
+						cell.sequence.store(pos + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = m_EnqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// false when the queue is empty
+		bool TryPop(T& out)
+		{
+			std::size_t pos = m_DequeuePos.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				Cell& cell = m_Cells[pos & (m_Capacity - 1)];
+				std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+				std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1);
+				if (diff == 0)
+				{
+					if (m_DequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						out = std::move(cell.value);
+						cell.value = T{};
+						cell.sequence.store(pos + m_Capacity, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = m_DequeuePos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+	private:
+		struct Cell
+		{
+			std::atomic<std::size_t> sequence;
+			T                        value{};
+		};
+
+		const std::size_t       m_Capacity;
+		std::unique_ptr<Cell[]> m_Cells;
+
+		// separate cache lines so producers and consumers do not false share
+		alignas(64) std::atomic<std::size_t> m_EnqueuePos{ 0 };
+		alignas(64) std::atomic<std::size_t> m_DequeuePos{ 0 };
+	};
+}
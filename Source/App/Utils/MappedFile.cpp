@@ -0,0 +1,70 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cve
+{
+#ifdef _WIN32
+
+	MappedFile::MappedFile(const std::string& filepath)
+	{
+		HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return;
+		m_FileHandle = file;
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) return;
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) return;
+		m_MappingHandle = mapping;
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == nullptr) return;
+
+		m_Data = static_cast<const std::byte*>(view);
+		m_Size = static_cast<std::size_t>(size.QuadPart);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_Data) UnmapViewOfFile(m_Data);
+		if (m_MappingHandle) CloseHandle(m_MappingHandle);
+		if (m_FileHandle) CloseHandle(m_FileHandle);
+	}
+
+#else
+
+	MappedFile::MappedFile(const std::string& filepath)
+	{
+		m_FileDescriptor = open(filepath.c_str(), O_RDONLY);
+		if (m_FileDescriptor < 0) return;
+
+		struct stat info{};
+		if (fstat(m_FileDescriptor, &info) != 0 || info.st_size == 0) return;
+
+		void* view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0);
+		if (view == MAP_FAILED) return;
+
+		m_Data = static_cast<const std::byte*>(view);
+		m_Size = static_cast<std::size_t>(info.st_size);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_Data) munmap(const_cast<std::byte*>(m_Data), m_Size);
+		if (m_FileDescriptor >= 0) close(m_FileDescriptor);
+	}
+
+#endif
+}
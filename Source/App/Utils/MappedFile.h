@@ -0,0 +1,43 @@
+#pragma once
+
+//std
+#include <cstddef>
+#include <span>
+#include <string>
+
+namespace cve
+{
+	// read-only memory mapping of a whole file, the OS pages the data in on first access
+	class MappedFile final
+	{
+	public:
+		explicit MappedFile(const std::string& filepath);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) = delete;
+		MappedFile& operator=(MappedFile&&) = delete;
+
+		bool IsValid() const { return m_Data != nullptr; }
+		const std::byte* GetData() const { return m_Data; }
+		std::size_t GetSize() const { return m_Size; }
+
+		template <typename T>
+		std::span<const T> GetSpan(std::size_t byteOffset, std::size_t count) const
+		{
+			return { reinterpret_cast<const T*>(m_Data + byteOffset), count };
+		}
+
+	private:
+		const std::byte* m_Data = nullptr;
+		std::size_t      m_Size = 0;
+
+#ifdef _WIN32
+		void* m_FileHandle = nullptr;
+		void* m_MappingHandle = nullptr;
+#else
+		int   m_FileDescriptor = -1;
+#endif
+	};
+}
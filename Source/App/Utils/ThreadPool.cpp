@@ -0,0 +1,74 @@
+#include "ThreadPool.h"
+
+//std
+#include <algorithm>
+
+namespace cve
+{
+	ThreadPool::ThreadPool(uint32_t threadCount)
+	{
+		if (threadCount == 0)
+		{
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		m_Workers.reserve(threadCount);
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			m_Workers.emplace_back([this]() { WorkerLoop(); });
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_Stopping = true;
+		}
+		m_Condition.notify_all();
+
+		for (auto& worker : m_Workers)
+		{
+			worker.join();
+		}
+	}
+
+	void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+	{
+		std::vector<std::future<void>> futures;
+		futures.reserve(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			futures.push_back(Submit([&func, i]() { func(i); }));
+		}
+
+		// wait for every job before rethrowing so none of them outlives func
+		for (auto& future : futures)
+		{
+			future.wait();
+		}
+		for (auto& future : futures)
+		{
+			future.get();
+		}
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock lock{ m_Mutex };
+				m_Condition.wait(lock, [this]() { return m_Stopping || !m_Jobs.empty(); });
+
+				// drain the queue before exiting so no submitted future is left unresolved
+				if (m_Jobs.empty()) return;
+
+				job = std::move(m_Jobs.front());
+				m_Jobs.pop();
+			}
+			job();
+		}
+	}
+}
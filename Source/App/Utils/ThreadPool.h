@@ -0,0 +1,56 @@
+#pragma once
+
+//std
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace cve
+{
+	// fixed size pool of worker threads pulling jobs from a shared FIFO queue
+	class ThreadPool final
+	{
+	public:
+		// threadCount 0 = one worker per hardware thread
+		explicit ThreadPool(uint32_t threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+		// exceptions thrown by the job are rethrown from the returned future's get()
+		template <typename Func>
+		auto Submit(Func&& func) -> std::future<std::invoke_result_t<Func>>
+		{
+			using Result = std::invoke_result_t<Func>;
+			auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+			std::future<Result> future = task->get_future();
+			{
+				std::lock_guard lock{ m_Mutex };
+				m_Jobs.emplace([task]() { (*task)(); });
+			}
+			m_Condition.notify_one();
+			return future;
+		}
+
+		// runs func(i) for every i in [0, count) and blocks until all of them are done
+		void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+	private:
+		std::vector<std::thread>          m_Workers;
+		std::queue<std::function<void()>> m_Jobs;
+		std::mutex                        m_Mutex;
+		std::condition_variable           m_Condition;
+		bool                              m_Stopping = false;
+
+		void WorkerLoop();
+	};
+}
@@ -1,5 +1,10 @@
 #pragma once
 
+//std
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
 namespace cve
 {
 
@@ -11,4 +16,22 @@ namespace cve
 		(hashCombine(seed, rest), ...);
 	};
 
-}
\ No newline at end of file
+	// 64 bit FNV-1a, stable across runs and compilers (unlike std::hash) so it can be stored on disk
+	inline uint64_t hashFNV1a(const void* data, std::size_t size, uint64_t seed = 0xcbf29ce484222325ull)
+	{
+		auto bytes = static_cast<const unsigned char*>(data);
+		uint64_t hash = seed;
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	inline uint64_t hashFNV1a(std::string_view text)
+	{
+		return hashFNV1a(text.data(), text.size());
+	}
+
+}
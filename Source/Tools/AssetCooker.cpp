@@ -0,0 +1,277 @@
+// Headless asset cooker: imports glTF scenes, runs the ModelImport::ImportOptions processing, decodes every material texture,
+// builds its mip chain and block compresses it (BC7/BC5/BC4, also written as a .ktx2 next to the image), then writes an
+// AssetPackage next to each scene. Never creates a window or a Vulkan device.
+//
+// usage: AssetCooker [-j threads] [--flatten] [--no-weld] [--no-optimize-indices] [--no-lods] [--no-compress] [scene files or folders...]
+// folders are searched recursively for .gltf/.glb, the default is Resources/. The import options must match the ones the app runs with.
+
+//std
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "AssetPackage.h"
+#include "BlockCompressor.h"
+#include "Ktx2.h"
+#include "ModelImport.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	struct CookJob
+	{
+		std::string sourcePath;
+		cve::ModelImport::Data data;
+		std::vector<cve::ModelImport::TextureFile> textureFiles;
+		std::vector<uint32_t> textureJobs;	//TextureJob per texture file, scenes sharing an image share its job
+		std::vector<std::shared_ptr<const cve::TextureDecoder::DecodedImage>> images;
+		uint64_t sourceBytes = 0;	//scene file, the .bin buffers next to it and its textures
+		uint64_t packageBytes = 0;
+		std::string error;
+	};
+
+	// one per distinct image and format, however many scenes reference it
+	struct TextureJob
+	{
+		cve::ModelImport::TextureFile file;
+		bool writeKtx2 = false;	//first job for this .ktx2 path, so every .ktx2 has a single writer
+		std::shared_ptr<cve::TextureDecoder::DecodedImage> image;
+		std::string error;
+	};
+
+	bool IsScene(const std::filesystem::path& path)
+	{
+		return path.extension() == ".gltf" || path.extension() == ".glb";
+	}
+
+	uint64_t GetSceneFileBytes(const std::filesystem::path& scene)
+	{
+		uint64_t bytes = std::filesystem::file_size(scene);
+		if (scene.extension() == ".gltf")
+		{
+			for (const auto& entry : std::filesystem::directory_iterator{ scene.parent_path() })
+			{
+				if (entry.is_regular_file() && entry.path().extension() == ".bin") bytes += entry.file_size();
+			}
+		}
+		return bytes;
+	}
+
+	double ToMb(uint64_t bytes)
+	{
+		return static_cast<double>(bytes) / (1024.0 * 1024.0);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	using clock = std::chrono::high_resolution_clock;
+	auto toMs = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+	uint32_t threadCount = 0;
+	bool compress = true;
+	std::vector<std::filesystem::path> inputs;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+		{
+			threadCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--flatten") == 0)
+		{
+			cve::ModelImport::s_ImportOptions.keepHierarchy = false;
+		}
+		else if (std::strcmp(argv[i], "--no-weld") == 0)
+		{
+			cve::ModelImport::s_ImportOptions.weldVertices = false;
+		}
+		else if (std::strcmp(argv[i], "--no-optimize-indices") == 0)
+		{
+			cve::ModelImport::s_ImportOptions.optimizeIndices = false;
+		}
+		else if (std::strcmp(argv[i], "--no-lods") == 0)
+		{
+			cve::ModelImport::s_ImportOptions.generateLods = false;
+		}
+		else if (std::strcmp(argv[i], "--no-compress") == 0)
+		{
+			compress = false;
+		}
+		else
+		{
+			inputs.emplace_back(argv[i]);
+		}
+	}
+	if (inputs.empty()) inputs.emplace_back("Resources");
+
+	try
+	{
+		std::vector<CookJob> jobs;
+		for (const auto& input : inputs)
+		{
+			if (std::filesystem::is_directory(input))
+			{
+				for (const auto& entry : std::filesystem::recursive_directory_iterator{ input })
+				{
+					if (entry.is_regular_file() && IsScene(entry.path())) jobs.push_back({ entry.path().generic_string() });
+				}
+			}
+			else if (std::filesystem::exists(input) && IsScene(input))
+			{
+				jobs.push_back({ input.generic_string() });
+			}
+			else
+			{
+				std::cerr << "[AssetCooker] " << input.string() << ": not a scene or folder, skipped" << std::endl;
+			}
+		}
+		if (jobs.empty())
+		{
+			std::cerr << "[AssetCooker] nothing to cook" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		// every scene and every texture is an independent job, so one big scene still keeps all workers busy
+		cve::ThreadPool pool{ threadCount };
+		std::mutex errorMutex;
+		auto fail = [&](CookJob& job, const std::exception& e)
+			{
+				std::lock_guard lock{ errorMutex };
+				if (job.error.empty()) job.error = e.what();
+			};
+
+		auto start = clock::now();
+
+		// 1. geometry: Assimp import + weld / index optimization / LODs / meshlets
+		pool.ParallelFor(static_cast<uint32_t>(jobs.size()), [&](uint32_t i)
+			{
+				auto& job = jobs[i];
+				try
+				{
+					job.data = cve::ModelImport::ImportData(job.sourcePath);
+					job.textureFiles = cve::ModelImport::GatherTextureFiles(job.data, std::filesystem::path{ job.sourcePath }.parent_path().string() + "/");
+					job.sourceBytes = GetSceneFileBytes(job.sourcePath);
+				}
+				catch (const std::exception& e)
+				{
+					fail(job, e);
+				}
+			});
+		auto geometryEnd = clock::now();
+
+		// 2. textures: decode + CPU mip chain + block compression, once per image even when several scenes use it
+		std::vector<TextureJob> textureJobs;
+		std::unordered_map<std::string, uint32_t> textureJobIndices;
+		std::unordered_set<std::string> ktx2Paths;
+		for (auto& job : jobs)
+		{
+			for (const auto& textureFile : job.textureFiles)
+			{
+				const std::string path = std::filesystem::absolute(textureFile.path).lexically_normal().generic_string();
+				const std::string key = path + "|" + std::to_string(static_cast<int>(textureFile.format)) + "|" +
+					std::to_string(static_cast<int>(textureFile.compressedFormat));
+				auto [it, inserted] = textureJobIndices.try_emplace(key, static_cast<uint32_t>(textureJobs.size()));
+				if (inserted)
+				{
+					textureJobs.push_back({ textureFile, ktx2Paths.insert(cve::Ktx2::GetPath(path, textureFile.compressedFormat)).second });
+				}
+				job.textureJobs.push_back(it->second);
+			}
+		}
+		pool.ParallelFor(static_cast<uint32_t>(textureJobs.size()), [&](uint32_t i)
+			{
+				auto& textureJob = textureJobs[i];
+				const auto& textureFile = textureJob.file;
+				try
+				{
+					auto image = cve::TextureDecoder::decode(textureFile.path, textureFile.format);
+					cve::TextureDecoder::generateMipChain(image);
+					if (compress)
+					{
+						image = cve::BlockCompressor::Compress(image, textureFile.compressedFormat);
+						if (textureJob.writeKtx2) cve::Ktx2::Write(cve::Ktx2::GetPath(textureFile.path, textureFile.compressedFormat), image, textureFile.path);
+					}
+					textureJob.image = std::make_shared<cve::TextureDecoder::DecodedImage>(std::move(image));
+				}
+				catch (const std::exception& e)
+				{
+					textureJob.error = textureFile.path + ": " + e.what();
+				}
+			});
+
+		// the scenes hold the only references from here on, so each image is released with the last package using it
+		for (auto& job : jobs)
+		{
+			for (uint32_t textureJob : job.textureJobs)
+			{
+				if (!textureJobs[textureJob].error.empty() && job.error.empty()) job.error = textureJobs[textureJob].error;
+				job.images.push_back(textureJobs[textureJob].image);
+			}
+		}
+		for (auto& textureJob : textureJobs) textureJob.image.reset();
+		auto texturesEnd = clock::now();
+
+		// 3. packages, each image is released as soon as the last package holding it is on disk
+		pool.ParallelFor(static_cast<uint32_t>(jobs.size()), [&](uint32_t i)
+			{
+				auto& job = jobs[i];
+				if (!job.error.empty()) return;
+				try
+				{
+					for (const auto& textureFile : job.textureFiles) job.sourceBytes += std::filesystem::file_size(textureFile.path);
+					job.packageBytes = cve::AssetPackage::Write(job.sourcePath, job.data, job.images);
+				}
+				catch (const std::exception& e)
+				{
+					fail(job, e);
+				}
+				job.images.clear();
+				job.data = {};
+			});
+		auto end = clock::now();
+
+		uint64_t sourceBytes = 0;
+		uint64_t packageBytes = 0;
+		uint32_t failed = 0;
+		std::cout << std::fixed << std::setprecision(2);
+		for (const auto& job : jobs)
+		{
+			if (!job.error.empty())
+			{
+				++failed;
+				std::cerr << "[AssetCooker] " << job.sourcePath << ": FAILED, " << job.error << std::endl;
+				continue;
+			}
+			sourceBytes += job.sourceBytes;
+			packageBytes += job.packageBytes;
+			std::cout << "[AssetCooker] " << job.sourcePath << ": " << job.textureFiles.size() << " textures, "
+				<< ToMb(job.sourceBytes) << " MB -> " << cve::AssetPackage::GetPackagePath(job.sourcePath) << " (" << ToMb(job.packageBytes) << " MB)" << std::endl;
+		}
+
+		const double totalSeconds = std::max(toMs(end - start), 0.001) / 1000.0;
+		std::cout << "[AssetCooker] " << jobs.size() - failed << "/" << jobs.size() << " scenes, " << textureJobs.size() << " textures on "
+			<< pool.GetThreadCount() << " threads" << (compress ? " (block compressed)" : "") << ": geometry " << toMs(geometryEnd - start) << " ms, textures " << toMs(texturesEnd - geometryEnd)
+			<< " ms, write " << toMs(end - texturesEnd) << " ms" << std::endl;
+		std::cout << "[AssetCooker] read " << ToMb(sourceBytes) << " MB, wrote " << ToMb(packageBytes) << " MB in " << totalSeconds << " s ("
+			<< ToMb(sourceBytes) / totalSeconds << " MB/s in, " << ToMb(packageBytes) / totalSeconds << " MB/s out)" << std::endl;
+
+		return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+}
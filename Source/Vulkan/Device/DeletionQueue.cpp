@@ -0,0 +1,35 @@
+#include "DeletionQueue.h"
+
+namespace cve
+{
+	DeletionQueue::~DeletionQueue()
+	{
+		flush();
+	}
+
+	void DeletionQueue::retire(std::function<void()> destroy)
+	{
+		pending_.push_back({ frame_, std::move(destroy) });
+	}
+
+	void DeletionQueue::collect(uint64_t frame, uint64_t completedFrames)
+	{
+		frame_ = frame;
+		while (!pending_.empty() && pending_.front().frame < completedFrames)
+		{
+			auto destroy = std::move(pending_.front().destroy);
+			pending_.pop_front();
+			destroy();
+		}
+	}
+
+	void DeletionQueue::flush()
+	{
+		while (!pending_.empty())
+		{
+			auto destroy = std::move(pending_.front().destroy);
+			pending_.pop_front();
+			destroy();
+		}
+	}
+}
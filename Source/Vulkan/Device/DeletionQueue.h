@@ -0,0 +1,44 @@
+#pragma once
+
+// std lib headers
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+namespace cve
+{
+	// Destroys resources the frames in flight may still use once those frames finished, instead of waiting for the device
+	// to go idle. A retired resource is tagged with the frame being recorded and destroyed once the renderer reports that
+	// frame as complete, which it knows from the fence of the frame's slot (SwapChain::MAX_FRAMES_IN_FLIGHT frames later).
+	// Capture what the destroy function needs by value, it runs long after the caller returned.
+	// Render thread only.
+	class DeletionQueue
+	{
+	public:
+		DeletionQueue() = default;
+		~DeletionQueue();
+
+		DeletionQueue(const DeletionQueue&) = delete;
+		DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+		void retire(std::function<void()> destroy);
+
+		// frame is about to be recorded and the first completedFrames frames finished on the GPU. Destroys what only
+		// those used
+		void collect(uint64_t frame, uint64_t completedFrames);
+		// destroys everything, the device must be idle
+		void flush();
+
+		size_t getPendingCount() const { return pending_.size(); }
+
+	private:
+		struct Entry
+		{
+			uint64_t              frame;	// frames up to this one may use the resource
+			std::function<void()> destroy;
+		};
+
+		uint64_t frame_ = 0;	// the frame being recorded
+		std::deque<Entry> pending_;	// in retire order, so frames never decrease
+	};
+}
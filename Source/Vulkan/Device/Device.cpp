@@ -1,8 +1,12 @@
 #include "Device.h"
 
 // std headers
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -57,10 +61,35 @@ namespace cve
 		pickPhysicalDevice();
 		createLogicalDevice();
 		createCommandPool();
+		allocator_ = std::make_unique<MemoryAllocator>(physicalDevice, device_);
+		createPipelineCache();
+
+		VkSemaphoreTypeCreateInfo timelineInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+		timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		timelineInfo.initialValue = 0;
+		VkSemaphoreCreateInfo semaphoreInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+		semaphoreInfo.pNext = &timelineInfo;
+		if (vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &uploadTimeline_) != VK_SUCCESS ||
+			vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &transferTimeline_) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload timeline semaphore!");
+		}
+
+		stagingRing_ = std::make_unique<StagingRing>(*this);
+		updateMemoryBudget();
 	}
 
 	Device::~Device() {
+		waitForUploads();
+		vkDeviceWaitIdle(device_);
+		deletionQueue_.flush();
+		savePipelineCache();
+		vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
+		stagingRing_.reset();
+		vkDestroySemaphore(device_, uploadTimeline_, nullptr);
+		vkDestroySemaphore(device_, transferTimeline_, nullptr);
+		allocator_.reset();
 		vkDestroyCommandPool(device_, commandPool, nullptr);
+		if (transferCommandPool_ != VK_NULL_HANDLE) vkDestroyCommandPool(device_, transferCommandPool_, nullptr);
 		vkDestroyDevice(device_, nullptr);
 
 		if (enableValidationLayers) {
@@ -149,6 +178,8 @@ namespace cve
 
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 		std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+		hasTransferQueue_ = s_UseTransferQueue && indices.transferFamilyHasValue;
+		if (hasTransferQueue_) uniqueQueueFamilies.insert(indices.transferFamily);
 
 		float queuePriority = 1.0f;
 		for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -171,10 +202,16 @@ namespace cve
 		indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
 
 
+		// upload batches signal a timeline semaphore
+		VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{};
+		timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+		timelineSemaphoreFeatures.pNext = &indexingFeatures;
+
 		VkPhysicalDeviceSynchronization2Features synchronization2{};
 		synchronization2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
 		synchronization2.synchronization2 = VK_TRUE;
-		synchronization2.pNext = &indexingFeatures; 
+		synchronization2.pNext = &timelineSemaphoreFeatures; 
 
 		VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
 		dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
@@ -187,14 +224,32 @@ namespace cve
 		features2.features = {}; 
 		features2.features.samplerAnisotropy = VK_TRUE;
 
+		// optional, without it the textures are decoded from their source images instead of the block compressed KTX2 files
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+		textureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
+		features2.features.textureCompressionBC = textureCompressionBC ? VK_TRUE : VK_FALSE;
+
+
+		// optional, without it the budget is estimated from the heap sizes
+		std::vector<const char*> enabledExtensions = deviceExtensions;
+		uint32_t extensionCount = 0;
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+		memoryBudgetSupported_ = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const VkExtensionProperties& extension)
+			{
+				return std::strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+			});
+		if (memoryBudgetSupported_) enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 
 		VkDeviceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 		createInfo.pNext = &features2;
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+		createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 		// might not really be necessary anymore because device specific validation layers
 		// have been deprecated
@@ -212,6 +267,17 @@ namespace cve
 
 		vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
 		vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+		graphicsFamily_ = indices.graphicsFamily;
+		if (hasTransferQueue_)
+		{
+			transferFamily_ = indices.transferFamily;
+			vkGetDeviceQueue(device_, transferFamily_, 0, &transferQueue_);
+			std::cout << "uploads on transfer queue family " << transferFamily_ << std::endl;
+		}
+		else
+		{
+			std::cout << "uploads on the graphics queue" << std::endl;
+		}
 	}
 
 	void  Device::createCommandPool() {
@@ -226,6 +292,13 @@ namespace cve
 		if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create command pool!");
 		}
+
+		if (hasTransferQueue_) {
+			poolInfo.queueFamilyIndex = transferFamily_;
+			if (vkCreateCommandPool(device_, &poolInfo, nullptr, &transferCommandPool_) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create transfer command pool!");
+			}
+		}
 	}
 
 	void  Device::createSurface() { window.CreateWindowSurface(instance, &surface_); }
@@ -376,6 +449,16 @@ namespace cve
 		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
 		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
+		// transfer only families are the copy engines, a compute family without graphics is the next best thing
+		for (uint32_t family = 0; family < queueFamilyCount; ++family) {
+			const VkQueueFlags flags = queueFamilies[family].queueFlags;
+			if (queueFamilies[family].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) continue;
+			if (!indices.transferFamilyHasValue || !(flags & VK_QUEUE_COMPUTE_BIT)) {
+				indices.transferFamily = family;
+				indices.transferFamilyHasValue = true;
+			}
+		}
+
 		int i = 0;
 		for (const auto& queueFamily : queueFamilies) {
 			if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
@@ -459,13 +542,22 @@ namespace cve
 		VkBufferUsageFlags usage,
 		VkMemoryPropertyFlags properties,
 		VkBuffer& buffer,
-		VkDeviceMemory& bufferMemory) {
+		MemoryAllocation& bufferMemory,
+		bool sharedWithTransferQueue) {
 		VkBufferCreateInfo bufferInfo{};
 		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		bufferInfo.size = size;
 		bufferInfo.usage = usage;
 		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+		// staging buffers are read by copies on both queues, the host writes them so there is nothing to hand over
+		const uint32_t queueFamilies[] = { graphicsFamily_, transferFamily_ };
+		if (hasTransferQueue_ && (usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT || sharedWithTransferQueue)) {
+			bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			bufferInfo.queueFamilyIndexCount = 2;
+			bufferInfo.pQueueFamilyIndices = queueFamilies;
+		}
+
 		if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create vertex buffer!");
 		}
@@ -473,24 +565,209 @@ namespace cve
 		VkMemoryRequirements memRequirements;
 		vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+		MemoryCategory category = MemoryCategory::Buffer;
+		if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT)) category = MemoryCategory::Geometry;
+		else if (usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT) category = MemoryCategory::Staging;
 
-		if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate vertex buffer memory!");
+		bufferMemory = allocator_->allocate(memRequirements, properties, true, category);
+		if (vkBindBufferMemory(device_, buffer, bufferMemory.memory, bufferMemory.offset) != VK_SUCCESS) {
+			throw std::runtime_error("failed to bind buffer memory!");
 		}
+	}
 
-		vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+	void Device::destroyBuffer(VkBuffer& buffer, MemoryAllocation& bufferMemory) {
+		if (buffer != VK_NULL_HANDLE) vkDestroyBuffer(device_, buffer, nullptr);
+		allocator_->free(bufferMemory);
+		buffer = VK_NULL_HANDLE;
 	}
 
+	bool Device::s_BatchUploads = true;
+	bool Device::s_UseTransferQueue = true;
+	std::string Device::s_PipelineCachePath = "Cache/pipelines.bin";
+
 	VkCommandBuffer  Device::beginSingleTimeCommands()
+	{
+		if (uploadBatch_ != VK_NULL_HANDLE) return uploadBatch_;
+		return allocateUploadCommandBuffer(commandPool);
+	}
+
+	UploadToken Device::endSingleTimeCommands(VkCommandBuffer commandBuffer)
+	{
+		// recorded into the open batch, it is submitted with the batch
+		if (commandBuffer == uploadBatch_) return uploadValue_ + 1;
+		return queueUploads(commandBuffer, VK_NULL_HANDLE);
+	}
+
+	VkCommandBuffer Device::beginTransferCommands()
+	{
+		if (uploadBatch_ == VK_NULL_HANDLE || !hasTransferQueue_) return beginSingleTimeCommands();
+		if (transferBatch_ == VK_NULL_HANDLE) transferBatch_ = allocateUploadCommandBuffer(transferCommandPool_);
+		return transferBatch_;
+	}
+
+	void Device::endTransferCommands(VkCommandBuffer commandBuffer)
+	{
+		if (commandBuffer != transferBatch_) endSingleTimeCommands(commandBuffer);
+	}
+
+	void Device::transferOwnership(const VkBufferMemoryBarrier2& barrier)
+	{
+		// written on the graphics queue, the trailing barrier of the submit covers it
+		if (transferBatch_ == VK_NULL_HANDLE) return;
+
+		VkDependencyInfo dependencyInfo{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+		dependencyInfo.bufferMemoryBarrierCount = 1;
+
+		VkBufferMemoryBarrier2 release = barrier;
+		release.srcQueueFamilyIndex = transferFamily_;
+		release.dstQueueFamilyIndex = graphicsFamily_;
+		release.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+		release.dstAccessMask = VK_ACCESS_2_NONE;
+		dependencyInfo.pBufferMemoryBarriers = &release;
+		vkCmdPipelineBarrier2(transferBatch_, &dependencyInfo);
+
+		VkBufferMemoryBarrier2 acquire = barrier;
+		acquire.srcQueueFamilyIndex = transferFamily_;
+		acquire.dstQueueFamilyIndex = graphicsFamily_;
+		acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+		acquire.srcAccessMask = VK_ACCESS_2_NONE;
+
+		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		dependencyInfo.pBufferMemoryBarriers = &acquire;
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+		endSingleTimeCommands(commandBuffer);
+	}
+
+	void Device::transferOwnership(const VkImageMemoryBarrier2& barrier)
+	{
+		VkDependencyInfo dependencyInfo{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+		dependencyInfo.imageMemoryBarrierCount = 1;
+
+		// both halves carry the same layouts, the transition happens once
+		VkImageMemoryBarrier2 acquire = barrier;
+		if (transferBatch_ == VK_NULL_HANDLE)
+		{
+			acquire.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			acquire.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		}
+		else
+		{
+			VkImageMemoryBarrier2 release = barrier;
+			release.srcQueueFamilyIndex = transferFamily_;
+			release.dstQueueFamilyIndex = graphicsFamily_;
+			release.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+			release.dstAccessMask = VK_ACCESS_2_NONE;
+			dependencyInfo.pImageMemoryBarriers = &release;
+			vkCmdPipelineBarrier2(transferBatch_, &dependencyInfo);
+
+			acquire.srcQueueFamilyIndex = transferFamily_;
+			acquire.dstQueueFamilyIndex = graphicsFamily_;
+			acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+			acquire.srcAccessMask = VK_ACCESS_2_NONE;
+		}
+
+		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		dependencyInfo.pImageMemoryBarriers = &acquire;
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+		endSingleTimeCommands(commandBuffer);
+	}
+
+	void Device::beginUploadBatch()
+	{
+		if (!s_BatchUploads) return;
+		if (uploadBatchDepth_++ == 0)
+		{
+			uploadBatch_ = allocateUploadCommandBuffer(commandPool);
+		}
+	}
+
+	UploadToken Device::endUploadBatch()
+	{
+		if (!s_BatchUploads || uploadBatchDepth_ == 0) return uploadValue_;
+		if (--uploadBatchDepth_ > 0) return uploadValue_ + 1;
+
+		VkCommandBuffer commandBuffer = uploadBatch_;
+		VkCommandBuffer transferCommandBuffer = transferBatch_;
+		uploadBatch_ = VK_NULL_HANDLE;
+		transferBatch_ = VK_NULL_HANDLE;
+		return queueUploads(commandBuffer, transferCommandBuffer);
+	}
+
+	bool Device::flushUploadBatch()
+	{
+		if (uploadBatch_ == VK_NULL_HANDLE) return false;
+
+		VkCommandBuffer commandBuffer = uploadBatch_;
+		VkCommandBuffer transferCommandBuffer = transferBatch_;
+		uploadBatch_ = VK_NULL_HANDLE;
+		transferBatch_ = VK_NULL_HANDLE;
+		queueUploads(commandBuffer, transferCommandBuffer);
+		uploadBatch_ = allocateUploadCommandBuffer(commandPool);
+		return true;
+	}
+
+	bool Device::isUploadComplete(UploadToken token)
+	{
+		submitQueuedUploads();
+		uint64_t value = 0;
+		vkGetSemaphoreCounterValue(device_, uploadTimeline_, &value);
+		return value >= token;
+	}
+
+	void Device::waitForUpload(UploadToken token)
+	{
+		if (token > uploadValue_)
+		{
+			throw std::runtime_error("waiting for an upload batch that was not submitted yet!");
+		}
+
+		submitQueuedUploads(token);
+		VkSemaphoreWaitInfo waitInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &uploadTimeline_;
+		waitInfo.pValues = &token;
+		vkWaitSemaphores(device_, &waitInfo, UINT64_MAX);
+		collectUploads();
+	}
+
+	void Device::waitForUploads()
+	{
+		if (uploadValue_ > 0) waitForUpload(uploadValue_);
+	}
+
+	void Device::onUploadComplete(std::function<void()> callback)
+	{
+		if (uploadBatch_ != VK_NULL_HANDLE) uploadCallbacks_.push_back(std::move(callback));
+		else if (!queuedUploads_.empty()) queuedUploads_.back().callbacks.push_back(std::move(callback));
+		else if (!pendingUploads_.empty()) pendingUploads_.back().callbacks.push_back(std::move(callback));
+		else callback();
+	}
+
+	void Device::collectUploads()
+	{
+		submitQueuedUploads();
+
+		uint64_t value = 0;
+		vkGetSemaphoreCounterValue(device_, uploadTimeline_, &value);
+		while (!pendingUploads_.empty() && pendingUploads_.front().token <= value)
+		{
+			PendingUpload upload = std::move(pendingUploads_.front());
+			pendingUploads_.pop_front();
+
+			vkFreeCommandBuffers(device_, commandPool, 1, &upload.commandBuffer);
+			if (upload.transferCommandBuffer != VK_NULL_HANDLE) {
+				vkFreeCommandBuffers(device_, transferCommandPool_, 1, &upload.transferCommandBuffer);
+			}
+			for (auto& callback : upload.callbacks) callback();
+		}
+	}
+
+	VkCommandBuffer Device::allocateUploadCommandBuffer(VkCommandPool pool)
 	{
 		VkCommandBufferAllocateInfo allocInfo{};
 		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandPool = commandPool;
+		allocInfo.commandPool = pool;
 		allocInfo.commandBufferCount = 1;
 
 		VkCommandBuffer commandBuffer;
@@ -504,43 +781,141 @@ namespace cve
 		return commandBuffer;
 	}
 
-	void Device::endSingleTimeCommands(VkCommandBuffer commandBuffer)
+	UploadToken Device::queueUploads(VkCommandBuffer commandBuffer, VkCommandBuffer transferCommandBuffer)
 	{
+		const UploadToken token = uploadValue_ + 1;
+		uint64_t transferValue = 0;
+
+		if (transferCommandBuffer != VK_NULL_HANDLE)
+		{
+			vkEndCommandBuffer(transferCommandBuffer);
+			transferValue = transferValue_ + 1;
+
+			VkCommandBufferSubmitInfo cmdInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO };
+			cmdInfo.commandBuffer = transferCommandBuffer;
+
+			VkSemaphoreSubmitInfo signalInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+			signalInfo.semaphore = transferTimeline_;
+			signalInfo.value = transferValue;
+			signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+			VkSubmitInfo2 submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 };
+			submitInfo.commandBufferInfoCount = 1;
+			submitInfo.pCommandBufferInfos = &cmdInfo;
+			submitInfo.signalSemaphoreInfoCount = 1;
+			submitInfo.pSignalSemaphoreInfos = &signalInfo;
+
+			if (vkQueueSubmit2(transferQueue_, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+				throw std::runtime_error("failed to submit transfer command buffer!");
+			}
+			transferValue_ = transferValue;
+		}
+
+		// later submissions (the frames) are in the second scope of this barrier, so they see the copies without waiting on the token
+		VkMemoryBarrier2 barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+		barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+
+		VkDependencyInfo dependencyInfo{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+		dependencyInfo.memoryBarrierCount = 1;
+		dependencyInfo.pMemoryBarriers = &barrier;
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
 		vkEndCommandBuffer(commandBuffer);
+		uploadValue_ = token;
+
+		stagingRing_->closeSubmission(token);
+		queuedUploads_.push_back({ token, transferValue, commandBuffer, transferCommandBuffer, std::move(uploadCallbacks_) });
+		uploadCallbacks_.clear();
+
+		if (s_BatchUploads) submitQueuedUploads();
+		else waitForUpload(token);
+		return token;
+	}
 
-		VkCommandBufferSubmitInfo cmdInfo{};
-		cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
-		cmdInfo.commandBuffer = commandBuffer;
+	void Device::submitQueuedUploads(UploadToken waitFor)
+	{
+		uint64_t transferDone = 0;
+		vkGetSemaphoreCounterValue(device_, transferTimeline_, &transferDone);
 
-		VkSubmitInfo2 submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2; 
-		submitInfo.commandBufferInfoCount = 1;
-		submitInfo.pCommandBufferInfos = &cmdInfo;
+		while (!queuedUploads_.empty())
+		{
+			PendingUpload& upload = queuedUploads_.front();
+			if (upload.transferValue > transferDone)
+			{
+				// a graphics submit waiting on the GPU would hold back every frame submitted after it
+				if (upload.token > waitFor) break;
+
+				VkSemaphoreWaitInfo waitInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+				waitInfo.semaphoreCount = 1;
+				waitInfo.pSemaphores = &transferTimeline_;
+				waitInfo.pValues = &upload.transferValue;
+				vkWaitSemaphores(device_, &waitInfo, UINT64_MAX);
+				transferDone = upload.transferValue;
+			}
 
-		vkQueueSubmit2(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(graphicsQueue_);
+			VkCommandBufferSubmitInfo cmdInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO };
+			cmdInfo.commandBuffer = upload.commandBuffer;
+
+			// already signaled, the wait only orders the release before the acquire
+			VkSemaphoreSubmitInfo waitSemaphoreInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+			waitSemaphoreInfo.semaphore = transferTimeline_;
+			waitSemaphoreInfo.value = upload.transferValue;
+			waitSemaphoreInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+			VkSemaphoreSubmitInfo signalInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+			signalInfo.semaphore = uploadTimeline_;
+			signalInfo.value = upload.token;
+			signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+			VkSubmitInfo2 submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2; 
+			submitInfo.waitSemaphoreInfoCount = upload.transferValue > 0 ? 1 : 0;
+			submitInfo.pWaitSemaphoreInfos = &waitSemaphoreInfo;
+			submitInfo.commandBufferInfoCount = 1;
+			submitInfo.pCommandBufferInfos = &cmdInfo;
+			submitInfo.signalSemaphoreInfoCount = 1;
+			submitInfo.pSignalSemaphoreInfos = &signalInfo;
+
+			if (vkQueueSubmit2(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+				throw std::runtime_error("failed to submit upload command buffer!");
+			}
 
-		vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+			pendingUploads_.push_back(std::move(upload));
+			queuedUploads_.pop_front();
+		}
 	}
 
-	void  Device::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+	void  Device::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset) {
+		VkCommandBuffer commandBuffer = beginTransferCommands();
 
 		VkBufferCopy copyRegion{};
-		copyRegion.srcOffset = 0;  // Optional
+		copyRegion.srcOffset = srcOffset;
 		copyRegion.dstOffset = 0;  // Optional
 		copyRegion.size = size;
 		vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-		endSingleTimeCommands(commandBuffer);
+		endTransferCommands(commandBuffer);
+
+		VkBufferMemoryBarrier2 barrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+		barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+		barrier.buffer = dstBuffer;
+		barrier.offset = 0;
+		barrier.size = size;
+		transferOwnership(barrier);
 	}
 
 	void  Device::copyBufferToImage(
-		VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount) {
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount, VkDeviceSize bufferOffset) {
+		VkCommandBuffer commandBuffer = beginTransferCommands();
 
 		VkBufferImageCopy region{};
-		region.bufferOffset = 0;
+		region.bufferOffset = bufferOffset;
 		region.bufferRowLength = 0;
 		region.bufferImageHeight = 0;
 
@@ -559,14 +934,15 @@ namespace cve
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			1,
 			&region);
-		endSingleTimeCommands(commandBuffer);
+		endTransferCommands(commandBuffer);
 	}
 
 	void  Device::createImageWithInfo(
 		const VkImageCreateInfo& imageInfo,
 		VkMemoryPropertyFlags properties,
 		VkImage& image,  
-		VkDeviceMemory& imageMemory) {
+		MemoryAllocation& imageMemory,
+		std::optional<MemoryCategory> category) {
 		if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create image!");
 		}
@@ -574,18 +950,176 @@ namespace cve
 		VkMemoryRequirements memRequirements;
 		vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-		if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate image memory!");
+		if (!category) {
+			category = imageInfo.usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
+				? MemoryCategory::RenderTarget : MemoryCategory::Texture;
 		}
 
-		if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+		imageMemory = allocator_->allocate(memRequirements, properties, imageInfo.tiling == VK_IMAGE_TILING_LINEAR, *category);
+		if (vkBindImageMemory(device_, image, imageMemory.memory, imageMemory.offset) != VK_SUCCESS) {
 			throw std::runtime_error("failed to bind image memory!");
 		}
 	}
 
-}
\ No newline at end of file
+	void Device::destroyImage(VkImage& image, MemoryAllocation& imageMemory) {
+		if (image != VK_NULL_HANDLE) vkDestroyImage(device_, image, nullptr);
+		allocator_->free(imageMemory);
+		image = VK_NULL_HANDLE;
+	}
+
+	void Device::updateMemoryBudget()
+	{
+		const VkPhysicalDeviceMemoryProperties& memoryProperties = allocator_->getMemoryProperties();
+		const MemoryAllocator::Stats stats = allocator_->getStats();
+
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT };
+		if (memoryBudgetSupported_) {
+			VkPhysicalDeviceMemoryProperties2 properties2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2 };
+			properties2.pNext = &budgetProperties;
+			vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties2);
+		}
+
+		const bool wasOverBudget = memoryBudget_.overBudget;
+		memoryBudget_.heaps.resize(memoryProperties.memoryHeapCount);
+		memoryBudget_.fromExtension = memoryBudgetSupported_;
+		memoryBudget_.overBudget = false;
+		for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i) {
+			auto& heap = memoryBudget_.heaps[i];
+			heap.deviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+			heap.allocated = stats.heapBytes[i];
+			if (memoryBudgetSupported_) {
+				heap.budget = budgetProperties.heapBudget[i];
+				heap.usage = budgetProperties.heapUsage[i];
+			}
+			else {
+				heap.budget = static_cast<VkDeviceSize>(static_cast<double>(memoryProperties.memoryHeaps[i].size) * FALLBACK_BUDGET_SHARE);
+				heap.usage = heap.allocated;
+			}
+			if (heap.deviceLocal && heap.usage > heap.budget) memoryBudget_.overBudget = true;
+		}
+
+		if (memoryBudget_.overBudget != wasOverBudget) {
+			for (auto& callback : memoryBudgetCallbacks_) callback(memoryBudget_.overBudget);
+		}
+	}
+
+	void Device::onMemoryBudgetChange(std::function<void(bool overBudget)> callback)
+	{
+		memoryBudgetCallbacks_.push_back(std::move(callback));
+	}
+
+	void Device::printMemoryBudget(std::ostream& out) const
+	{
+		auto toMb = [](VkDeviceSize bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+		const std::ios_base::fmtflags flags = out.flags();
+		const std::streamsize precision = out.precision();
+
+		out << std::fixed << std::setprecision(1) << "[Memory]";
+		for (size_t i = 0; i < memoryBudget_.heaps.size(); ++i) {
+			const auto& heap = memoryBudget_.heaps[i];
+			if (!heap.deviceLocal) continue;
+			out << " heap " << i << ": " << toMb(heap.usage) << " / " << toMb(heap.budget) << " MB"
+				<< (memoryBudget_.fromExtension ? "" : " (estimated)") << (heap.usage > heap.budget ? " OVER BUDGET" : "");
+		}
+		out << " |";
+		const MemoryAllocator::Stats stats = allocator_->getStats();
+		for (size_t i = 0; i < stats.categories.size(); ++i) {
+			if (stats.categories[i].allocationCount == 0) continue;
+			out << " " << MemoryAllocator::getCategoryName(static_cast<MemoryCategory>(i)) << " " << toMb(stats.categories[i].usedBytes);
+		}
+		out << " MB" << std::endl;
+
+		out.flags(flags);
+		out.precision(precision);
+	}
+
+	void Device::createPipelineCache() {
+		std::vector<char> data;
+		if (!s_PipelineCachePath.empty()) {
+			std::ifstream file{ s_PipelineCachePath, std::ios::binary | std::ios::ate };
+			if (file.is_open()) {
+				data.resize(static_cast<size_t>(file.tellg()));
+				file.seekg(0);
+				if (!file.read(data.data(), data.size())) data.clear();
+			}
+		}
+
+		// drivers ignore a cache that is not theirs, but only the header tells us whether the warm start is real.
+		// pipelineCacheUUID changes with every driver version that can't read the old data
+		VkPipelineCacheHeaderVersionOne header{};
+		if (data.size() >= sizeof(header)) std::memcpy(&header, data.data(), sizeof(header));
+		const bool compatible = data.size() >= sizeof(header) &&
+			header.headerSize >= sizeof(header) && header.headerSize <= data.size() &&
+			header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			header.vendorID == properties.vendorID &&
+			header.deviceID == properties.deviceID &&
+			std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+		if (!data.empty() && !compatible) {
+			std::cout << "[PipelineCache] " << s_PipelineCachePath << " is from another device or driver, starting cold" << std::endl;
+			data.clear();
+		}
+
+		VkPipelineCacheCreateInfo createInfo{ VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+		createInfo.initialDataSize = data.size();
+		createInfo.pInitialData = data.empty() ? nullptr : data.data();
+		if (vkCreatePipelineCache(device_, &createInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline cache!");
+		}
+		pipelineCacheStats_.loadedBytes = data.size();
+	}
+
+	void Device::savePipelineCache() {
+		if (s_PipelineCachePath.empty() || pipelineCache_ == VK_NULL_HANDLE) return;
+
+		size_t size = 0;
+		if (vkGetPipelineCacheData(device_, pipelineCache_, &size, nullptr) != VK_SUCCESS || size == 0) return;
+		std::vector<char> data(size);
+		if (vkGetPipelineCacheData(device_, pipelineCache_, &size, data.data()) != VK_SUCCESS) return;
+
+		std::error_code ec;
+		const std::filesystem::path path{ s_PipelineCachePath };
+		if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), ec);
+
+		const std::string tempPath = s_PipelineCachePath + ".tmp";
+		{
+			std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!file.write(data.data(), size)) {
+				std::cerr << "[PipelineCache] could not write " << tempPath << std::endl;
+				return;
+			}
+		}
+
+		// write to a temp file first so a crash mid-write never leaves a truncated cache behind
+		std::filesystem::rename(tempPath, path, ec);
+		if (ec) {
+			std::cerr << "[PipelineCache] could not finalize " << s_PipelineCachePath << ": " << ec.message() << std::endl;
+		}
+	}
+
+	void Device::recordPipelineCreation(std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end) {
+		std::lock_guard lock{ pipelineCacheStatsMutex_ };
+		if (pipelineCacheStats_.pipelineCount == 0 || start < firstPipelineCreation_) firstPipelineCreation_ = start;
+		++pipelineCacheStats_.pipelineCount;
+		pipelineCacheStats_.creationMs += std::chrono::duration<float, std::milli>(end - start).count();
+		// the builds overlap on the workers, so the wall time is the span they cover rather than their sum
+		pipelineCacheStats_.wallMs = std::max(pipelineCacheStats_.wallMs, std::chrono::duration<float, std::milli>(end - firstPipelineCreation_).count());
+	}
+
+	void Device::printPipelineCacheStats(std::ostream& out) const {
+		const std::ios_base::fmtflags flags = out.flags();
+		const std::streamsize precision = out.precision();
+
+		out << std::fixed << std::setprecision(1) << "[PipelineCache] " << pipelineCacheStats_.pipelineCount << " pipelines created in "
+			<< pipelineCacheStats_.wallMs << " ms wall (" << pipelineCacheStats_.creationMs << " ms summed over the build threads), ";
+		if (pipelineCacheStats_.loadedBytes > 0) {
+			out << "warm (" << static_cast<double>(pipelineCacheStats_.loadedBytes) / 1024.0 << " KB loaded)" << std::endl;
+		}
+		else {
+			out << "cold" << (s_PipelineCachePath.empty() ? " (cache file disabled)" : "") << std::endl;
+		}
+
+		out.flags(flags);
+		out.precision(precision);
+	}
+
+}
@@ -1,7 +1,17 @@
 #pragma once
 
 #include "Window.h"
+#include "MemoryAllocator.h"
+#include "StagingRing.h"
+#include "DeletionQueue.h"
 // std lib headers                                                                                                                                          
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
 #include <string>
 #include <vector>
 
@@ -19,8 +29,10 @@ namespace cve
 	{
 		uint32_t graphicsFamily;
 		uint32_t presentFamily;
+		uint32_t transferFamily;	// a family with transfer but no graphics support, optional
 		bool graphicsFamilyHasValue = false;
 		bool presentFamilyHasValue = false;
+		bool transferFamilyHasValue = false;
 		bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 	};
 
@@ -47,6 +59,8 @@ namespace cve
 		VkSurfaceKHR surface() { return surface_; }
 		VkQueue graphicsQueue() { return graphicsQueue_; }
 		VkQueue presentQueue() { return presentQueue_; }
+		// false: there is no transfer only family (or it was switched off) and uploads run on the graphics queue
+		bool hasTransferQueue() const { return hasTransferQueue_; }
 		VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
 		
 		SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
@@ -56,25 +70,118 @@ namespace cve
 			const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
 		// Buffer Helper Functions
+		// memory comes from the sub-allocator, release with destroyBuffer / destroyImage. Shared buffers are concurrent
+		// between the graphics and transfer queue, for buffers whose ranges are written while the graphics queue reads
+		// other ranges (there is no ownership to transfer, the batch's graphics half waiting on the copies is enough)
 		void createBuffer(
 			VkDeviceSize size,
 			VkBufferUsageFlags usage,
 			VkMemoryPropertyFlags properties,
 			VkBuffer& buffer,
-			VkDeviceMemory& bufferMemory);
+			MemoryAllocation& bufferMemory,
+			bool sharedWithTransferQueue = false);
+		void destroyBuffer(VkBuffer& buffer, MemoryAllocation& bufferMemory);
+		// inside an upload batch these hand out and keep recording into the batch's command buffer, outside of one
+		// endSingleTimeCommands submits right away. Neither waits for the GPU, use the token for that
 		VkCommandBuffer beginSingleTimeCommands();
-		void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-		void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+		UploadToken endSingleTimeCommands(VkCommandBuffer commandBuffer);
+
+		// Upload batches: everything recorded between begin and end goes out in one submit that signals the upload
+		// timeline, ending it returns the value it signals. Batches nest, an inner end returns the token of the outer one.
+		// A trailing barrier makes the copies visible to every later submission, frames don't need to wait on the token
+		static bool s_BatchUploads;	// false: every submit waits until the GPU finished it (no batching)
+		// With a transfer queue a batch has two halves. Copies go to the transfer queue right away, the graphics half
+		// (ownership acquire, mip blits, rendering) is submitted once the CPU saw the copies finish, so frames never queue
+		// up behind an upload. Read at device creation
+		static bool s_UseTransferQueue;
+		void beginUploadBatch();
+		UploadToken endUploadBatch();
+		// submits what the open batch recorded so far and keeps it open, false when no batch is open
+		bool flushUploadBatch();
+		bool isUploadComplete(UploadToken token);
+		void waitForUpload(UploadToken token);
+		// runs once the commands recorded so far finished, for objects they use (pipelines, descriptor pools ...)
+		void onUploadComplete(std::function<void()> callback);
+		// frees the command buffers of finished uploads and runs their callbacks, once per frame
+		void collectUploads();
+		// submits whatever is still queued and waits for all of it
+		void waitForUploads();
+		uint64_t getUploadSubmitCount() const { return uploadValue_; }
+		// batches submitted or queued that the GPU has not finished yet, as of the last collectUploads
+		uint32_t getUploadsInFlight() const { return static_cast<uint32_t>(queuedUploads_.size() + pendingUploads_.size()); }
+
+		// inside an upload batch on a device with a transfer queue these record into the batch's transfer half, otherwise
+		// they are beginSingleTimeCommands / endSingleTimeCommands. Only transfer commands and barriers, anything written
+		// here goes through transferOwnership before the graphics half touches it (or lives in a shared buffer)
+		VkCommandBuffer beginTransferCommands();
+		void endTransferCommands(VkCommandBuffer commandBuffer);
+		// Hands a buffer / image written by transfer commands over to the graphics queue. The barrier is filled in as if
+		// there was one queue (src = the copy, dst = the first use, old / new layout), it is split into the release in
+		// the transfer half and the acquire in the graphics half. Without a transfer queue images only get the layout
+		// transition and buffers nothing, the batch's trailing barrier covers them
+		void transferOwnership(const VkBufferMemoryBarrier2& barrier);
+		void transferOwnership(const VkImageMemoryBarrier2& barrier);
+
+		void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0);
 		void copyBufferToImage(
-			VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
+			VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount, VkDeviceSize bufferOffset = 0);
 
+		// the category is derived from the usage (attachments are render targets) unless one is given
 		void createImageWithInfo(
 			const VkImageCreateInfo& imageInfo,
 			VkMemoryPropertyFlags properties,
 			VkImage& image,
-			VkDeviceMemory& imageMemory);
+			MemoryAllocation& imageMemory,
+			std::optional<MemoryCategory> category = std::nullopt);
+		void destroyImage(VkImage& image, MemoryAllocation& imageMemory);
+
+		MemoryAllocator& memoryAllocator() { return *allocator_; }
+		StagingRing& stagingRing() { return *stagingRing_; }
+		// resources the frames in flight may still use, the Renderer collects it every frame
+		DeletionQueue& deletionQueue() { return deletionQueue_; }
+
+		// Device memory against its budget per heap. With VK_EXT_memory_budget usage and budget come from the driver,
+		// without it usage is what the allocator took and the budget is a fixed share of the heap
+		struct MemoryBudget
+		{
+			struct Heap
+			{
+				VkDeviceSize budget = 0;
+				VkDeviceSize usage = 0;
+				VkDeviceSize allocated = 0;	// by our allocator, part of usage
+				bool         deviceLocal = false;
+			};
+			std::vector<Heap> heaps;
+			bool fromExtension = false;
+			bool overBudget = false;	// usage above budget on a device local heap
+		};
+		static constexpr float FALLBACK_BUDGET_SHARE = 0.8f;
+		// queries the budget again, once per frame. Runs the onMemoryBudgetChange callbacks when overBudget flipped
+		void updateMemoryBudget();
+		const MemoryBudget& getMemoryBudget() const { return memoryBudget_; }
+		// for streaming systems to back off while over budget and resume once back under it
+		void onMemoryBudgetChange(std::function<void(bool overBudget)> callback);
+		// device local usage / budget and the allocator's bytes per category on one line
+		void printMemoryBudget(std::ostream& out) const;
+
+		// One pipeline cache for every pipeline. Loaded from s_PipelineCachePath at device creation when the file was written
+		// by the same vendor, device and driver (header ids and pipelineCacheUUID), saved back when the device is destroyed
+		static std::string s_PipelineCachePath;	// empty: no file, every run compiles the pipelines from scratch
+		struct PipelineCacheStats
+		{
+			size_t   loadedBytes = 0;	// 0 = cold start, no usable cache file
+			uint32_t pipelineCount = 0;
+			float    creationMs = 0.0f;	// time spent in vkCreateGraphicsPipelines over every pipeline, summed over the build threads
+			float    wallMs = 0.0f;	// first creation start to last creation end, what the builds cost startup
+		};
+		VkPipelineCache pipelineCache() const { return pipelineCache_; }
+		// thread safe, pipelines are built on the PipelineBuilder's workers
+		void recordPipelineCreation(std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end);
+		const PipelineCacheStats& getPipelineCacheStats() const { return pipelineCacheStats_; }
+		void printPipelineCacheStats(std::ostream& out) const;
 
 		VkPhysicalDeviceProperties properties;
+		bool textureCompressionBC = false;	//BC1-7 sampling, the cooked KTX2 textures need it
 
 	private:
 		void createInstance();
@@ -83,6 +190,8 @@ namespace cve
 		void pickPhysicalDevice();
 		void createLogicalDevice();
 		void createCommandPool();
+		void createPipelineCache();
+		void savePipelineCache();
 
 		// helper functions
 		bool isDeviceSuitable(VkPhysicalDevice device);
@@ -104,6 +213,48 @@ namespace cve
 		VkSurfaceKHR surface_;
 		VkQueue graphicsQueue_;
 		VkQueue presentQueue_;
+		std::unique_ptr<MemoryAllocator> allocator_;
+		std::unique_ptr<StagingRing> stagingRing_;
+		DeletionQueue deletionQueue_;
+
+		struct PendingUpload
+		{
+			UploadToken token;
+			uint64_t transferValue;	// the transfer half signals this on transferTimeline_, 0 = graphics only
+			VkCommandBuffer commandBuffer;
+			VkCommandBuffer transferCommandBuffer;
+			std::vector<std::function<void()>> callbacks;
+		};
+		VkCommandBuffer allocateUploadCommandBuffer(VkCommandPool pool);
+		UploadToken queueUploads(VkCommandBuffer commandBuffer, VkCommandBuffer transferCommandBuffer);
+		// submits the graphics halves whose copies finished, in order. Up to waitFor it waits for the copies instead
+		void submitQueuedUploads(UploadToken waitFor = 0);
+
+		uint32_t graphicsFamily_ = 0;
+		uint32_t transferFamily_ = 0;
+		bool hasTransferQueue_ = false;
+		VkQueue transferQueue_ = VK_NULL_HANDLE;
+		VkCommandPool transferCommandPool_ = VK_NULL_HANDLE;
+
+		VkSemaphore uploadTimeline_ = VK_NULL_HANDLE;
+		UploadToken uploadValue_ = 0;	// token of the last batch handed out, its graphics half might still be queued
+		VkSemaphore transferTimeline_ = VK_NULL_HANDLE;
+		uint64_t transferValue_ = 0;
+		VkCommandBuffer uploadBatch_ = VK_NULL_HANDLE;
+		VkCommandBuffer transferBatch_ = VK_NULL_HANDLE;	// allocated on the first transfer command of the batch
+		uint32_t uploadBatchDepth_ = 0;
+		std::vector<std::function<void()>> uploadCallbacks_;	// of the batch being recorded
+		std::deque<PendingUpload> queuedUploads_;	// graphics halves waiting for their copies, not submitted yet
+		std::deque<PendingUpload> pendingUploads_;	// submitted
+
+		VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+		PipelineCacheStats pipelineCacheStats_{};
+		std::chrono::high_resolution_clock::time_point firstPipelineCreation_{};
+		std::mutex pipelineCacheStatsMutex_;
+
+		bool memoryBudgetSupported_ = false;	// VK_EXT_memory_budget is enabled
+		MemoryBudget memoryBudget_{};
+		std::vector<std::function<void(bool)>> memoryBudgetCallbacks_;
 
 		const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
 		const std::vector<const char*> deviceExtensions =
@@ -0,0 +1,327 @@
+#include "MemoryAllocator.h"
+
+// std headers
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <iomanip>
+#include <stdexcept>
+
+namespace cve
+{
+	namespace
+	{
+		constexpr const char* CATEGORY_NAMES[] = { "staging", "geometry", "buffer", "texture", "render target", "environment" };
+		static_assert(std::size(CATEGORY_NAMES) == static_cast<size_t>(MemoryCategory::COUNT));
+
+		VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		uint32_t getOrder(VkDeviceSize size)
+		{
+			return static_cast<uint32_t>(std::countr_zero(std::bit_ceil(std::max(size, MemoryAllocator::BUDDY_MIN_SIZE)) / MemoryAllocator::BUDDY_MIN_SIZE));
+		}
+
+		double toMb(VkDeviceSize bytes)
+		{
+			return static_cast<double>(bytes) / (1024.0 * 1024.0);
+		}
+	}
+
+	MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device)
+		: device_{ device }
+	{
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties_);
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		maxAllocationCount_ = properties.limits.maxMemoryAllocationCount;
+	}
+
+	MemoryAllocator::~MemoryAllocator()
+	{
+		// whatever is still alive here leaked its resource, the memory goes anyway
+		for (auto& pool : pools_)
+		{
+			for (auto& block : pool.blocks)
+			{
+				freeDeviceMemory(block->memory, block->mapped != nullptr, pool.memoryType, block->size);
+			}
+		}
+	}
+
+	MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linearResource, MemoryCategory category)
+	{
+		std::lock_guard lock{ mutex_ };
+
+		MemoryAllocation allocation{};
+		allocation.size = requirements.size;
+		allocation.category = category;
+
+		const uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+		allocation.memoryType = memoryType;
+		const Strategy strategy = category == MemoryCategory::Staging ? Strategy::Linear : Strategy::Buddy;
+		const VkDeviceSize maxSize = strategy == Strategy::Linear ? LINEAR_BLOCK_SIZE : BUDDY_MAX_SIZE;
+
+		if (requirements.size > maxSize)
+		{
+			allocation.memory = allocateDeviceMemory(memoryType, requirements.size, &allocation.mapped);
+			allocation.blockSize = requirements.size;
+			++stats_.dedicatedCount;
+			stats_.dedicatedBytes += requirements.size;
+		}
+		else
+		{
+			auto poolIt = std::find_if(pools_.begin(), pools_.end(), [&](const Pool& pool)
+				{
+					return pool.memoryType == memoryType && pool.linearResources == linearResource && pool.strategy == strategy;
+				});
+			if (poolIt == pools_.end())
+			{
+				pools_.push_back({ memoryType, linearResource, strategy, {} });
+				poolIt = pools_.end() - 1;
+			}
+			Pool& pool = *poolIt;
+
+			// buddy ranges are aligned to their own size, so rounding up to the alignment covers it
+			const VkDeviceSize buddySize = std::bit_ceil(std::max({ requirements.size, requirements.alignment, BUDDY_MIN_SIZE }));
+			VkDeviceSize offset = 0;
+			VkDeviceSize taken = 0;
+			auto tryBlock = [&](MemoryBlock& block)
+				{
+					if (strategy == Strategy::Buddy)
+					{
+						taken = buddySize;
+						return allocateBuddy(block, buddySize, offset);
+					}
+					return allocateLinear(block, requirements.size, requirements.alignment, offset, taken);
+				};
+
+			MemoryBlock* block = nullptr;
+			for (auto& candidate : pool.blocks)
+			{
+				if (tryBlock(*candidate))
+				{
+					block = candidate.get();
+					break;
+				}
+			}
+			if (!block)
+			{
+				block = createBlock(pool, strategy == Strategy::Linear ? LINEAR_BLOCK_SIZE : BUDDY_BLOCK_SIZE);
+				if (!tryBlock(*block))
+				{
+					throw std::runtime_error("failed to sub-allocate from a fresh memory block!");
+				}
+			}
+
+			++block->liveAllocations;
+			allocation.memory = block->memory;
+			allocation.offset = offset;
+			allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + offset : nullptr;
+			allocation.block = block;
+			allocation.blockSize = taken;
+		}
+
+		auto& categoryStats = stats_.categories[static_cast<size_t>(category)];
+		++categoryStats.allocationCount;
+		categoryStats.requestedBytes += allocation.size;
+		categoryStats.usedBytes += allocation.blockSize;
+		++stats_.totalAllocations;
+		return allocation;
+	}
+
+	void MemoryAllocator::free(MemoryAllocation& allocation)
+	{
+		if (!allocation) return;
+
+		std::lock_guard lock{ mutex_ };
+
+		auto& categoryStats = stats_.categories[static_cast<size_t>(allocation.category)];
+		--categoryStats.allocationCount;
+		categoryStats.requestedBytes -= allocation.size;
+		categoryStats.usedBytes -= allocation.blockSize;
+
+		if (!allocation.block)
+		{
+			freeDeviceMemory(allocation.memory, allocation.mapped != nullptr, allocation.memoryType, allocation.blockSize);
+			--stats_.dedicatedCount;
+			stats_.dedicatedBytes -= allocation.blockSize;
+		}
+		else
+		{
+			MemoryBlock& block = *allocation.block;
+			Pool& pool = pools_[block.poolIndex];
+			if (pool.strategy == Strategy::Buddy)
+			{
+				freeBuddy(block, allocation.offset, allocation.blockSize);
+			}
+
+			// an empty block rewinds (linear) and is released unless it is the last one of its pool, which stays around for reuse
+			if (--block.liveAllocations == 0)
+			{
+				block.head = 0;
+				if (pool.blocks.size() > 1)
+				{
+					destroyBlock(pool, &block);
+				}
+			}
+		}
+		allocation = {};
+	}
+
+	MemoryAllocator::Stats MemoryAllocator::getStats() const
+	{
+		std::lock_guard lock{ mutex_ };
+		return stats_;
+	}
+
+	void MemoryAllocator::printStats(std::ostream& out) const
+	{
+		const Stats stats = getStats();
+		out << std::fixed << std::setprecision(2)
+			<< "[Memory] " << stats.deviceMemoryCount << " device memory objects (peak " << stats.peakDeviceMemoryCount
+			<< ", limit " << maxAllocationCount_ << ") for " << stats.totalAllocations << " allocations so far: "
+			<< stats.blockCount << " blocks (" << toMb(stats.blockBytes) << " MB), "
+			<< stats.dedicatedCount << " dedicated (" << toMb(stats.dedicatedBytes) << " MB)\n";
+		for (size_t i = 0; i < stats.categories.size(); ++i)
+		{
+			const auto& category = stats.categories[i];
+			if (category.allocationCount == 0) continue;
+			out << "[Memory]   " << std::left << std::setw(14) << CATEGORY_NAMES[i] << std::right
+				<< std::setw(6) << category.allocationCount << " live, "
+				<< std::setw(9) << toMb(category.requestedBytes) << " MB requested, "
+				<< std::setw(9) << toMb(category.usedBytes) << " MB used\n";
+		}
+		out << std::flush;
+	}
+
+	const char* MemoryAllocator::getCategoryName(MemoryCategory category)
+	{
+		return CATEGORY_NAMES[static_cast<size_t>(category)];
+	}
+
+	uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+	{
+		for (uint32_t i = 0; i < memoryProperties_.memoryTypeCount; i++)
+		{
+			if ((typeFilter & (1 << i)) &&
+				(memoryProperties_.memoryTypes[i].propertyFlags & properties) == properties)
+			{
+				return i;
+			}
+		}
+		throw std::runtime_error("failed to find suitable memory type!");
+	}
+
+	MemoryBlock* MemoryAllocator::createBlock(Pool& pool, VkDeviceSize size)
+	{
+		auto block = std::make_unique<MemoryBlock>();
+		block->memory = allocateDeviceMemory(pool.memoryType, size, &block->mapped);
+		block->size = size;
+		block->poolIndex = static_cast<uint32_t>(&pool - pools_.data());
+		if (pool.strategy == Strategy::Buddy)
+		{
+			block->freeLists.resize(getOrder(size) + 1);
+			block->freeLists.back().insert(0);
+		}
+
+		++stats_.blockCount;
+		stats_.blockBytes += size;
+		pool.blocks.push_back(std::move(block));
+		return pool.blocks.back().get();
+	}
+
+	void MemoryAllocator::destroyBlock(Pool& pool, MemoryBlock* block)
+	{
+		auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(), [block](const auto& candidate) { return candidate.get() == block; });
+		assert(it != pool.blocks.end());
+
+		freeDeviceMemory(block->memory, block->mapped != nullptr, pool.memoryType, block->size);
+		--stats_.blockCount;
+		stats_.blockBytes -= block->size;
+		pool.blocks.erase(it);
+	}
+
+	VkDeviceMemory MemoryAllocator::allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, void** mapped)
+	{
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryType;
+
+		VkDeviceMemory memory;
+		if (vkAllocateMemory(device_, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate device memory!");
+		}
+
+		*mapped = nullptr;
+		if (memoryProperties_.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			vkMapMemory(device_, memory, 0, VK_WHOLE_SIZE, 0, mapped);
+		}
+
+		++stats_.deviceMemoryCount;
+		stats_.peakDeviceMemoryCount = std::max(stats_.peakDeviceMemoryCount, stats_.deviceMemoryCount);
+		stats_.heapBytes[memoryProperties_.memoryTypes[memoryType].heapIndex] += size;
+		return memory;
+	}
+
+	void MemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, bool mapped, uint32_t memoryType, VkDeviceSize size)
+	{
+		if (mapped) vkUnmapMemory(device_, memory);
+		vkFreeMemory(device_, memory, nullptr);
+		--stats_.deviceMemoryCount;
+		stats_.heapBytes[memoryProperties_.memoryTypes[memoryType].heapIndex] -= size;
+	}
+
+	bool MemoryAllocator::allocateBuddy(MemoryBlock& block, VkDeviceSize size, VkDeviceSize& outOffset)
+	{
+		const uint32_t order = getOrder(size);
+		if (order >= block.freeLists.size()) return false;
+
+		uint32_t available = order;
+		while (available < block.freeLists.size() && block.freeLists[available].empty()) ++available;
+		if (available == block.freeLists.size()) return false;
+
+		// lowest free range of the smallest order that fits, split down to the requested order
+		VkDeviceSize offset = *block.freeLists[available].begin();
+		block.freeLists[available].erase(block.freeLists[available].begin());
+		while (available > order)
+		{
+			--available;
+			block.freeLists[available].insert(offset + (BUDDY_MIN_SIZE << available));
+		}
+		outOffset = offset;
+		return true;
+	}
+
+	void MemoryAllocator::freeBuddy(MemoryBlock& block, VkDeviceSize offset, VkDeviceSize size)
+	{
+		uint32_t order = getOrder(size);
+		while (order + 1 < block.freeLists.size())
+		{
+			const VkDeviceSize buddy = offset ^ (BUDDY_MIN_SIZE << order);
+			auto it = block.freeLists[order].find(buddy);
+			if (it == block.freeLists[order].end()) break;
+
+			block.freeLists[order].erase(it);
+			offset = std::min(offset, buddy);
+			++order;
+		}
+		block.freeLists[order].insert(offset);
+	}
+
+	bool MemoryAllocator::allocateLinear(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& outOffset, VkDeviceSize& outTaken)
+	{
+		const VkDeviceSize offset = alignUp(block.head, alignment);
+		if (offset + size > block.size) return false;
+
+		outOffset = offset;
+		outTaken = offset + size - block.head;
+		block.head = offset + size;
+		return true;
+	}
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// std lib headers
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <vector>
+
+namespace cve
+{
+	// what an allocation is used for, only for the stats
+	enum class MemoryCategory : uint32_t
+	{
+		Staging,		// transfer source buffers
+		Geometry,		// vertex / index buffers
+		Buffer,			// uniform / storage buffers
+		Texture,		// sampled images
+		RenderTarget,	// color / depth attachments
+		Environment,	// HDR environment map, its cubemaps and the IBL maps
+		COUNT
+	};
+
+	struct MemoryBlock;
+
+	// a range of a VkDeviceMemory, bind the resource at offset. mapped points at offset when the memory is host visible
+	struct MemoryAllocation
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize   offset = 0;
+		VkDeviceSize   size = 0;	// as requested by the resource
+		void*          mapped = nullptr;
+
+		// bookkeeping for free
+		MemoryBlock*   block = nullptr;	// null for dedicated allocations
+		VkDeviceSize   blockSize = 0;	// bytes taken from the block (buddy size or aligned linear size)
+		MemoryCategory category = MemoryCategory::Buffer;
+		uint32_t       memoryType = 0;
+
+		explicit operator bool() const { return memory != VK_NULL_HANDLE; }
+	};
+
+	// Sub-allocates buffers and images out of large VkDeviceMemory blocks instead of one vkAllocateMemory per resource.
+	// Pools are per memory type and per resource kind (buffers and optimal tiling images never share a block, so
+	// bufferImageGranularity can't be violated). Size classes:
+	//  - staging buffers: linear blocks, bump allocated and rewound once every allocation in the block is freed
+	//  - everything else up to BUDDY_MAX_SIZE: buddy blocks, power of two ranges that are naturally aligned
+	//  - anything larger: a dedicated vkAllocateMemory
+	// Host visible blocks stay mapped for their whole lifetime. Thread safe.
+	class MemoryAllocator
+	{
+	public:
+		static constexpr VkDeviceSize BUDDY_BLOCK_SIZE = 64ull << 20;
+		static constexpr VkDeviceSize BUDDY_MIN_SIZE = 256;
+		static constexpr VkDeviceSize BUDDY_MAX_SIZE = 16ull << 20;
+		static constexpr VkDeviceSize LINEAR_BLOCK_SIZE = 32ull << 20;
+
+		struct CategoryStats
+		{
+			uint64_t     allocationCount = 0;
+			VkDeviceSize requestedBytes = 0;	// sum of the resources' sizes
+			VkDeviceSize usedBytes = 0;			// including buddy rounding and alignment padding
+		};
+
+		struct Stats
+		{
+			std::array<CategoryStats, static_cast<size_t>(MemoryCategory::COUNT)> categories{};
+			uint32_t     blockCount = 0;
+			VkDeviceSize blockBytes = 0;
+			uint32_t     dedicatedCount = 0;
+			VkDeviceSize dedicatedBytes = 0;
+			uint32_t     deviceMemoryCount = 0;	// live vkAllocateMemory objects (blocks + dedicated)
+			uint32_t     peakDeviceMemoryCount = 0;
+			uint64_t     totalAllocations = 0;	// every allocate() so far, what used to be a vkAllocateMemory each
+			std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapBytes{};	// device memory per heap (blocks + dedicated)
+		};
+
+		MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+		~MemoryAllocator();
+
+		MemoryAllocator(const MemoryAllocator&) = delete;
+		MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+		MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linearResource, MemoryCategory category);
+		void free(MemoryAllocation& allocation);
+
+		Stats getStats() const;
+		void printStats(std::ostream& out) const;
+		static const char* getCategoryName(MemoryCategory category);
+
+		const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const { return memoryProperties_; }
+
+	private:
+		enum class Strategy : uint32_t { Linear, Buddy };
+
+		struct Pool
+		{
+			uint32_t memoryType;
+			bool     linearResources;
+			Strategy strategy;
+			std::vector<std::unique_ptr<MemoryBlock>> blocks;
+		};
+
+		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+		MemoryBlock* createBlock(Pool& pool, VkDeviceSize size);
+		void destroyBlock(Pool& pool, MemoryBlock* block);
+		VkDeviceMemory allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, void** mapped);
+		void freeDeviceMemory(VkDeviceMemory memory, bool mapped, uint32_t memoryType, VkDeviceSize size);
+
+		static bool allocateBuddy(MemoryBlock& block, VkDeviceSize size, VkDeviceSize& outOffset);
+		static void freeBuddy(MemoryBlock& block, VkDeviceSize offset, VkDeviceSize size);
+		static bool allocateLinear(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& outOffset, VkDeviceSize& outTaken);
+
+		VkDevice device_;
+		VkPhysicalDeviceMemoryProperties memoryProperties_{};
+		uint32_t maxAllocationCount_ = 0;
+
+		mutable std::mutex mutex_;
+		std::vector<Pool> pools_;
+		Stats stats_{};
+	};
+
+	// one VkDeviceMemory of a pool
+	struct MemoryBlock
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize   size = 0;
+		void*          mapped = nullptr;
+		uint32_t       poolIndex = 0;
+		uint32_t       liveAllocations = 0;
+
+		// buddy: free offsets per order, order k spans BUDDY_MIN_SIZE << k bytes
+		std::vector<std::set<VkDeviceSize>> freeLists;
+		// linear: next free byte
+		VkDeviceSize   head = 0;
+	};
+}
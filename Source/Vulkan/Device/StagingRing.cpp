@@ -0,0 +1,139 @@
+#include "StagingRing.h"
+#include "Device.h"
+
+// std headers
+#include <algorithm>
+
+namespace cve
+{
+	StagingRing::StagingRing(Device& device, VkDeviceSize size)
+		: device_{ device }
+		, size_{ size }
+	{
+		device_.createBuffer(
+			size_,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			buffer_,
+			memory_);
+	}
+
+	StagingRing::~StagingRing()
+	{
+		// the device waited for every upload before destroying the ring
+		for (auto& submission : inFlight_)
+		{
+			retire(submission);
+		}
+		for (auto& temporary : pendingTemporaryBuffers_)
+		{
+			device_.destroyBuffer(temporary.buffer, temporary.memory);
+		}
+		device_.destroyBuffer(buffer_, memory_);
+	}
+
+	StagingRing::Region StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		if (size > size_) return allocateTemporary(size);
+
+		reclaim();
+		VkDeviceSize offset = 0;
+		while (!tryAllocate(size, alignment, offset))
+		{
+			// the rest of the ring is taken by regions of the batch being recorded, submit what it has so far
+			if (inFlight_.empty() && !device_.flushUploadBatch()) return allocateTemporary(size);
+
+			++stats_.waits;
+			device_.waitForUpload(inFlight_.front().token);
+			reclaim();
+		}
+
+		pending_ = true;
+		++stats_.ringAllocations;
+		stats_.allocatedBytes += size;
+		const VkDeviceSize used = head_ > tail_ ? head_ - tail_ : size_ - tail_ + head_;
+		stats_.peakUsedBytes = std::max(stats_.peakUsedBytes, used);
+		return { buffer_, offset, size, static_cast<char*>(memory_.mapped) + offset };
+	}
+
+	void StagingRing::closeSubmission(UploadToken token)
+	{
+		if (!pending_ && pendingTemporaryBuffers_.empty()) return;
+
+		inFlight_.push_back({ token, head_, std::move(pendingTemporaryBuffers_) });
+		pendingTemporaryBuffers_.clear();
+		pending_ = false;
+	}
+
+	void StagingRing::reclaim()
+	{
+		// submissions finish in order, the first unfinished one keeps everything behind it alive
+		while (!inFlight_.empty() && device_.isUploadComplete(inFlight_.front().token))
+		{
+			retire(inFlight_.front());
+			inFlight_.pop_front();
+		}
+		if (!isLive())
+		{
+			head_ = 0;
+			tail_ = 0;
+		}
+	}
+
+	bool StagingRing::tryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& outOffset)
+	{
+		const VkDeviceSize offset = (head_ + alignment - 1) / alignment * alignment;
+		if (!isLive() || head_ > tail_)
+		{
+			// free: [head_, size_) and [0, tail_)
+			if (offset + size <= size_)
+			{
+				outOffset = offset;
+				head_ = offset + size;
+				return true;
+			}
+			if (size <= tail_)
+			{
+				// the bytes left at the end are skipped, the tail passes them once the submissions before the wrap finish
+				outOffset = 0;
+				head_ = size;
+				return true;
+			}
+			return false;
+		}
+		if (head_ < tail_ && offset + size <= tail_)
+		{
+			// free: [head_, tail_)
+			outOffset = offset;
+			head_ = offset + size;
+			return true;
+		}
+		return false;
+	}
+
+	StagingRing::Region StagingRing::allocateTemporary(VkDeviceSize size)
+	{
+		TemporaryBuffer temporary{};
+		device_.createBuffer(
+			size,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			temporary.buffer,
+			temporary.memory);
+		pendingTemporaryBuffers_.push_back(temporary);
+
+		++stats_.overflowAllocations;
+		stats_.allocatedBytes += size;
+		return { temporary.buffer, 0, size, temporary.memory.mapped };
+	}
+
+	void StagingRing::retire(Submission& submission)
+	{
+		tail_ = submission.end;
+		for (auto& temporary : submission.temporaryBuffers)
+		{
+			device_.destroyBuffer(temporary.buffer, temporary.memory);
+		}
+		submission.temporaryBuffers.clear();
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+
+// std lib headers
+#include <deque>
+#include <vector>
+
+namespace cve
+{
+	class Device;
+
+	// timeline semaphore value an upload submission signals, see Device::endUploadBatch
+	using UploadToken = uint64_t;
+
+	// One persistently mapped host visible buffer that uploads copy their payload into, instead of creating, mapping and
+	// destroying a staging buffer per upload. Regions are handed out front to back and wrap around. Every region allocated
+	// since the last closeSubmission() belongs to that upload submission and is reclaimed once its token completed.
+	// When only regions of the batch being recorded are left, the batch is flushed to make room. Payloads larger than
+	// the ring get a temporary buffer that is released the same way.
+	// Allocate a region right before recording the commands that read it, Device submits close the submission.
+	// Render thread only.
+	class StagingRing
+	{
+	public:
+		static constexpr VkDeviceSize DEFAULT_SIZE = 64ull << 20;
+		static constexpr VkDeviceSize DEFAULT_ALIGNMENT = 16;	// covers vkCmdCopyBufferToImage for every format we upload
+
+		struct Region
+		{
+			VkBuffer     buffer = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;	// use as srcOffset / bufferOffset of the copy
+			VkDeviceSize size = 0;
+			void*        mapped = nullptr;	// already points at offset
+		};
+
+		struct Stats
+		{
+			uint64_t     ringAllocations = 0;
+			uint64_t     overflowAllocations = 0;	// payloads that got a temporary buffer
+			uint64_t     waits = 0;					// allocations that had to wait for the GPU to free space
+			VkDeviceSize allocatedBytes = 0;		// every payload so far, ring and temporary buffers
+			VkDeviceSize peakUsedBytes = 0;
+		};
+
+		StagingRing(Device& device, VkDeviceSize size = DEFAULT_SIZE);
+		~StagingRing();
+
+		StagingRing(const StagingRing&) = delete;
+		StagingRing& operator=(const StagingRing&) = delete;
+
+		Region allocate(VkDeviceSize size, VkDeviceSize alignment = DEFAULT_ALIGNMENT);
+
+		// the regions allocated so far are read by the submission that signals token
+		void closeSubmission(UploadToken token);
+
+		// frees the regions of every finished submission, allocate() does this on its own
+		void reclaim();
+
+		const Stats& getStats() const { return stats_; }
+		VkDeviceSize getSize() const { return size_; }
+
+	private:
+		struct TemporaryBuffer
+		{
+			VkBuffer         buffer;
+			MemoryAllocation memory;
+		};
+
+		struct Submission
+		{
+			UploadToken  token;
+			VkDeviceSize end;	// head at close, the tail moves here once the token completed
+			std::vector<TemporaryBuffer> temporaryBuffers;
+		};
+
+		bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& outOffset);
+		Region allocateTemporary(VkDeviceSize size);
+		void retire(Submission& submission);
+		bool isLive() const { return pending_ || !inFlight_.empty(); }
+
+		Device& device_;
+		VkBuffer buffer_ = VK_NULL_HANDLE;
+		MemoryAllocation memory_{};
+		VkDeviceSize size_ = 0;
+
+		VkDeviceSize head_ = 0;	// next free byte
+		VkDeviceSize tail_ = 0;	// first byte an unfinished submission still reads, head_ == tail_ while live means full
+		bool pending_ = false;	// regions were handed out since the last closeSubmission
+		std::vector<TemporaryBuffer> pendingTemporaryBuffers_;
+		std::deque<Submission> inFlight_;
+		Stats stats_{};
+	};
+}
@@ -1,6 +1,7 @@
 #include "HDRImage.h"
 #include <array>
 #include <filesystem>
+#include <memory>
 #include <stdexcept>
 
 #include "Pipeline.h"
@@ -9,9 +10,13 @@
 
 namespace cve
 {
-	HDRImage::HDRImage(Device& device, const std::string& filename)
-		:m_Device{device}
-	{
+    void HDRImage::DecodedImage::PixelDeleter::operator()(float* pixels) const
+    {
+        stbi_image_free(pixels);
+    }
+
+    HDRImage::DecodedImage HDRImage::decode(const std::string& filename)
+    {
         // 1) Load the HDR pixels with stb_image
         if (!std::filesystem::exists(filename)) {
             throw std::runtime_error("File does not exist: " + filename);
@@ -25,31 +30,40 @@ namespace cve
         if (!pixels) {
             throw std::runtime_error("Failed to load HDR image: " + filename);
         }
+
+        DecodedImage image{};
+        image.filename = filename;
+        image.width = uint32_t(texWidth);
+        image.height = uint32_t(texHeight);
+        image.pixels.reset(pixels);
+        return image;
+    }
+
+	HDRImage::HDRImage(Device& device, PipelineBuilder& pipelineBuilder, const std::string& filename)
+		:HDRImage{device, pipelineBuilder, decode(filename)}
+	{
+	}
+
+	HDRImage::HDRImage(Device& device, PipelineBuilder& pipelineBuilder, const DecodedImage& image)
+		:m_Device{device}
+	{
+        // upload, cube map and irradiance map rendering go out in one batch, the rendering waits for the copy
+        m_Device.beginUploadBatch();
+
+        const int texWidth = int(image.width);
+        const int texHeight = int(image.height);
         m_EquirectMipLevels = 1; // only one mip level for now
         m_EquirectExtent = { uint32_t(texWidth), uint32_t(texHeight) };
         m_EquirectFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
 
-        VkDeviceSize imageSize = VkDeviceSize(texWidth) * texHeight * 4 * sizeof(float);
+        // both pipelines compile while the images below are created and the copy is recorded
+        CreateCapturePipelineLayout();
+        PipelineBuild skyPipeline = BuildCapturePipeline(pipelineBuilder, m_SkyFragPath);
+        PipelineBuild irradiancePipeline = BuildCapturePipeline(pipelineBuilder, m_IBLFragPath);
 
-        // 2) Create a host?visible staging buffer
-        VkBuffer       stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        m_Device.createBuffer(
-            imageSize,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            stagingBuffer,
-            stagingBufferMemory
-        );
-
-        // 3) Copy pixels into the staging buffer
-        void* data;
-        vkMapMemory(m_Device.device(), stagingBufferMemory, 0, imageSize, 0, &data);
-        std::memcpy(data, pixels, static_cast<size_t>(imageSize));
-        vkUnmapMemory(m_Device.device(), stagingBufferMemory);
-        stbi_image_free(pixels);
+        VkDeviceSize imageSize = VkDeviceSize(texWidth) * texHeight * 4 * sizeof(float);
 
-        // 4) Create the equirectangular image (device?local)
+        // 2) Create the equirectangular image (device?local)
         CreateEquirectImage(
             texWidth,
             texHeight,
@@ -59,7 +73,7 @@ namespace cve
         );
         CreateEquirectTextureImageView();
 
-        // 5) Transition image to TRANSFER_DST_OPTIMAL, copy, then to SHADER_READ_ONLY_OPTIMAL
+        // 3) Transition image to TRANSFER_DST_OPTIMAL, copy, then to SHADER_READ_ONLY_OPTIMAL
         TransitionImageLayout(
             m_EquirectImage,
             m_EquirectFormat,
@@ -68,12 +82,16 @@ namespace cve
             m_EquirectMipLevels
         );
 
+        // the pixels go through the staging ring right before the copy that reads them
+        const StagingRing::Region staging = m_Device.stagingRing().allocate(imageSize);
+        std::memcpy(staging.mapped, image.pixels.get(), static_cast<size_t>(imageSize));
         m_Device.copyBufferToImage(
-            stagingBuffer,
+            staging.buffer,
             m_EquirectImage,
             texWidth,
             texHeight,
-            1
+            1,
+            staging.offset
         );
 
         TransitionImageLayout(
@@ -85,24 +103,26 @@ namespace cve
         );
         m_EquirectImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-        // 6) Cleanup staging
-        vkDestroyBuffer(m_Device.device(), stagingBuffer, nullptr);
-        vkFreeMemory(m_Device.device(), stagingBufferMemory, nullptr);
-
-        // 7) Create the sampler
+        // 4) Create the sampler
         CreateEquirectTextureSampler(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
 
-        // 8) Build the cube?map from this equirectangular image
-        CreateCubeMap();
-        CreateIrradianceMap(); 
+        // 5) Build the cube?map from this equirectangular image
+        CreateCubeMap(skyPipeline);
+        CreateIrradianceMap(irradiancePipeline); 
+
+        m_Device.onUploadComplete([device = m_Device.device(), setLayout = m_CaptureSetLayout, pipelineLayout = m_CapturePipelineLayout]()
+            {
+                vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+                vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+            });
+        m_UploadToken = m_Device.endUploadBatch();
 
 	}
 	HDRImage::~HDRImage()
 	{
         vkDestroySampler(m_Device.device(), m_EquirectSampler, nullptr);
         vkDestroyImageView(m_Device.device(), m_EquirectImageView, nullptr);
-        vkDestroyImage(m_Device.device(), m_EquirectImage, nullptr);
-        vkFreeMemory(m_Device.device(), m_EquirectImageMemory, nullptr);
+        m_Device.destroyImage(m_EquirectImage, m_EquirectImageMemory);
 
         vkDestroySampler(m_Device.device(), m_CubeMapSampler, nullptr);
         vkDestroyImageView(m_Device.device(), m_CubeMapImageView, nullptr);
@@ -119,10 +139,8 @@ namespace cve
 
 		vkDestroySampler(m_Device.device(), m_IrradianceMapSampler, nullptr);
         vkDestroyImageView(m_Device.device(), m_IrradianceMapImageView, nullptr);
-        vkDestroyImage(m_Device.device(), m_IrradianceMapImage, nullptr);
-        vkDestroyImage(m_Device.device(), m_CubeMapImage, nullptr);
-        vkFreeMemory(m_Device.device(), m_CubeMapImageMemory, nullptr);
-        vkFreeMemory(m_Device.device(), m_IrradianceMapImageMemory, nullptr);
+        m_Device.destroyImage(m_IrradianceMapImage, m_IrradianceMapImageMemory);
+        m_Device.destroyImage(m_CubeMapImage, m_CubeMapImageMemory);
 	}
     void HDRImage::CreateEquirectImage(
         uint32_t          width,
@@ -147,12 +165,13 @@ namespace cve
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
         // 2) Use your Device helper to create the image and allocate/bind its memory
-        //    (under the hood this does vkCreateImage + vkAllocateMemory + vkBindImageMemory)
+        //    (under the hood this does vkCreateImage + a sub-allocation + vkBindImageMemory)
         m_Device.createImageWithInfo( 
             imageInfo,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
             m_EquirectImage,
-            m_EquirectImageMemory   // <-- store the VkDeviceMemory here
+            m_EquirectImageMemory,   // <-- store the allocation here
+            MemoryCategory::Environment
         );
     }
 
@@ -218,7 +237,55 @@ namespace cve
         }
     }
 
-    void HDRImage::CreateCubeMap()
+    void HDRImage::CreateCapturePipelineLayout()
+    {
+        VkDescriptorSetLayoutBinding b{ 0,
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            1,
+            VK_SHADER_STAGE_FRAGMENT_BIT,
+            nullptr
+        };
+        VkDescriptorSetLayoutCreateInfo li{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+        li.bindingCount = 1;
+        li.pBindings = &b;
+        if (vkCreateDescriptorSetLayout(m_Device.device(), &li, nullptr, &m_CaptureSetLayout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create cube capture descriptor set layout!");
+        }
+
+        // 2mat4 push-constants: view + projection
+        VkPushConstantRange pc{};
+        pc.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pc.offset = 0;
+        pc.size = sizeof(glm::mat4) * 2;
+
+        VkPipelineLayoutCreateInfo pli{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+        pli.setLayoutCount = 1;
+        pli.pSetLayouts = &m_CaptureSetLayout;
+        pli.pushConstantRangeCount = 1;
+        pli.pPushConstantRanges = &pc;
+        if (vkCreatePipelineLayout(m_Device.device(), &pli, nullptr, &m_CapturePipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create cube capture pipeline layout!");
+        }
+    }
+
+    HDRImage::PipelineBuild HDRImage::BuildCapturePipeline(PipelineBuilder& pipelineBuilder, const std::string& fragPath)
+    {
+        // a minimal pipeline drawing the cube from gl_VertexIndex into one face
+        auto cfg = std::make_unique<PipelineConfigInfo>();
+        Pipeline::DefaultPipelineConfigInfo(*cfg);
+        cfg->vertexBindings.clear();    // no vertex buffers
+        cfg->vertexAttributes.clear();
+        cfg->colorAttachmentFormats = { m_EquirectFormat };
+        cfg->depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+        cfg->pipelineLayout = m_CapturePipelineLayout;
+        cfg->renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+        cfg->renderingInfo.colorAttachmentCount = 1;
+        cfg->renderingInfo.pColorAttachmentFormats = cfg->colorAttachmentFormats.data();
+
+        return pipelineBuilder.Build(std::move(cfg), m_CubeVertPath, fragPath);
+    }
+
+    void HDRImage::CreateCubeMap(PipelineBuild& pipelineBuild)
     {
         // We only need one mip level for now
         uint32_t cubeMipLevels = 1;
@@ -243,12 +310,13 @@ namespace cve
         imageInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
 
         // Allocate and bind memory via your Device wrapper
-        // You'll need a member VkDeviceMemory m_CubeMapImageMemory;
+        // You'll need a member MemoryAllocation m_CubeMapImageMemory;
         m_Device.createImageWithInfo(
             imageInfo,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
             m_CubeMapImage,
-            m_CubeMapImageMemory
+            m_CubeMapImageMemory,
+            MemoryCategory::Environment
         );
 
         // 2. Create the cube?map view
@@ -312,8 +380,7 @@ namespace cve
         RenderToCubeMap(
             m_CubeMapExtent,
             cubeMipLevels,
-            m_CubeVertPath,
-            m_SkyFragPath,
+            pipelineBuild,
             m_EquirectImage,
             m_EquirectImageView,
             m_EquirectSampler,
@@ -324,8 +391,7 @@ namespace cve
 
 	void HDRImage::RenderToCubeMap(const VkExtent2D& extent,
 		uint32_t mipLevels,
-		const std::string& vertPath,
-		const std::string& fragPath,
+		PipelineBuild& pipelineBuild,
 		VkImage& inputImage,
 		const VkImageView& inputImageView,
 		VkSampler inputSampler,
@@ -365,20 +431,6 @@ namespace cve
         }
 
         // 4) Build a one-off descriptor set to sample the equirectangular map
-        VkDescriptorSetLayout descriptorLayout;
-        {
-            VkDescriptorSetLayoutBinding b{ 0,
-                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                1,
-                VK_SHADER_STAGE_FRAGMENT_BIT,
-                nullptr
-            };
-            VkDescriptorSetLayoutCreateInfo li{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
-            li.bindingCount = 1;
-            li.pBindings = &b;
-            vkCreateDescriptorSetLayout(m_Device.device(), &li, nullptr, &descriptorLayout);
-        }
-
         VkDescriptorPool descriptorPool;
         {
             VkDescriptorPoolSize sz{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 };
@@ -394,7 +446,7 @@ namespace cve
             VkDescriptorSetAllocateInfo ai{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
             ai.descriptorPool = descriptorPool;
             ai.descriptorSetCount = 1;
-            ai.pSetLayouts = &descriptorLayout;
+            ai.pSetLayouts = &m_CaptureSetLayout;
             vkAllocateDescriptorSets(m_Device.device(), &ai, &descriptorSet);
 
             VkDescriptorImageInfo ii{};
@@ -412,40 +464,9 @@ namespace cve
             vkUpdateDescriptorSets(m_Device.device(), 1, &w, 0, nullptr);
         }
 
-        // 5) Create pipeline layout with 2mat4 push-constants + our single descriptor set
-        VkPipelineLayout pipelineLayout;
-        {
-            VkPushConstantRange pc{};
-            pc.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-            pc.offset = 0;
-            pc.size = sizeof(glm::mat4) * 2;  // view + projection
-
-            VkPipelineLayoutCreateInfo pli{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
-            pli.setLayoutCount = 1;
-            pli.pSetLayouts = &descriptorLayout;
-            pli.pushConstantRangeCount = 1;
-            pli.pPushConstantRanges = &pc;
-            vkCreatePipelineLayout(m_Device.device(), &pli, nullptr, &pipelineLayout);
-        }
-
-        // 6) Configure and build a minimal pipeline
-        PipelineConfigInfo cfg{};
-        Pipeline::DefaultPipelineConfigInfo(cfg);
-        cfg.vertexBindings.clear();    // no vertex buffers
-        cfg.vertexAttributes.clear();
-        cfg.colorAttachmentFormats = { m_EquirectFormat };
-        cfg.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
-        cfg.pipelineLayout = pipelineLayout;
-        cfg.renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
-        cfg.renderingInfo.colorAttachmentCount = 1;
-        cfg.renderingInfo.pColorAttachmentFormats = cfg.colorAttachmentFormats.data();
-
-        auto pipeline = std::make_unique<Pipeline>(
-            m_Device,
-            cfg,
-            vertPath,
-            fragPath
-        );
+        // 5) + 6) the layout is shared, the pipeline was built on the pipeline builder, waits here if it isn't done yet
+        const VkPipelineLayout pipelineLayout = m_CapturePipelineLayout;
+        std::shared_ptr<Pipeline> pipeline = pipelineBuild.get();
 
         // 7) Prepare capture projection / views
         const glm::mat4 captureProj = [] {
@@ -530,13 +551,16 @@ namespace cve
             // 10) End and submit
             m_Device.endSingleTimeCommands(cmd);
 
-            // 11) Clean up
-            vkDestroyPipelineLayout(m_Device.device(), pipelineLayout, nullptr);
-            vkDestroyDescriptorPool(m_Device.device(), descriptorPool, nullptr);
-            vkDestroyDescriptorSetLayout(m_Device.device(), descriptorLayout, nullptr);
+            // 11) Clean up once the GPU has run the commands, they may still be waiting in an upload batch
+            std::shared_ptr<Pipeline> usedPipeline = std::move(pipeline);
+            m_Device.onUploadComplete([device = m_Device.device(), usedPipeline, descriptorPool]() mutable
+                {
+                    usedPipeline.reset();
+                    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+                });
 	}
 
-    void HDRImage::CreateIrradianceMap()
+    void HDRImage::CreateIrradianceMap(PipelineBuild& pipelineBuild)
     {
         uint32_t irradianceMipLevels = 1;
 
@@ -565,7 +589,8 @@ namespace cve
                 imageInfo,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                 m_IrradianceMapImage,
-                m_IrradianceMapImageMemory 
+                m_IrradianceMapImageMemory,
+                MemoryCategory::Environment
             );
         }
 
@@ -636,7 +661,7 @@ namespace cve
                 faceViews[i].push_back(m_IrradianceMapFaceViews[i]);
 
             RenderToCubeMap(m_IrradianceMapExtent, irradianceMipLevels,
-                m_CubeVertPath, m_IBLFragPath, m_CubeMapImage,
+                pipelineBuild, m_CubeMapImage,
                 m_CubeMapImageView, m_EquirectSampler, m_IrradianceMapImage, faceViews
             );
 
@@ -654,8 +679,6 @@ namespace cve
         VkImageLayout newLayout,
         uint32_t mipLevels)
     {
-        VkCommandBuffer cmd = m_Device.beginSingleTimeCommands();
-
         VkImageMemoryBarrier2 barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
         barrier.oldLayout = oldLayout;
@@ -693,14 +716,23 @@ namespace cve
         barrier.srcStageMask = srcStage;
         barrier.dstStageMask = dstStage;
 
-        VkDependencyInfo depInfo{};
-        depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
-        depInfo.imageMemoryBarrierCount = 1;
-        depInfo.pImageMemoryBarriers = &barrier;
-
-        vkCmdPipelineBarrier2(cmd, &depInfo);
-
-        m_Device.endSingleTimeCommands(cmd);
+        if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+        {
+            // goes with the copy, on the transfer queue when there is one
+            VkDependencyInfo depInfo{};
+            depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            depInfo.imageMemoryBarrierCount = 1;
+            depInfo.pImageMemoryBarriers = &barrier;
+
+            VkCommandBuffer cmd = m_Device.beginTransferCommands();
+            vkCmdPipelineBarrier2(cmd, &depInfo);
+            m_Device.endTransferCommands(cmd);
+        }
+        else
+        {
+            // the cube map rendering samples it on the graphics queue
+            m_Device.transferOwnership(barrier);
+        }
     }
 
 
@@ -1,17 +1,34 @@
 #pragma once 
 #include "Device.h"
+#include "PipelineBuilder.h"
 #include <glm/glm.hpp> 
 #include <glm/gtc/matrix_transform.hpp>
 #include "glm/vec3.hpp"
 #include <memory>
 #include <array>
+#include <future>
+#include <string>
 
 namespace cve
 {
 	class HDRImage final
 	{
 	public: 
-		HDRImage(Device& device, const std::string& filename);
+		//float RGBA pixels straight from stb_image, decode() is thread safe so it can run off the render thread
+		struct DecodedImage
+		{
+			struct PixelDeleter { void operator()(float* pixels) const; };
+
+			std::string filename;
+			uint32_t    width = 0;
+			uint32_t    height = 0;
+			std::unique_ptr<float, PixelDeleter> pixels;
+		};
+		static DecodedImage decode(const std::string& filename);
+
+		//the cube map and irradiance pipelines are built on the pipelineBuilder while the equirectangular image uploads
+		HDRImage(Device& device, PipelineBuilder& pipelineBuilder, const std::string& filename);
+		HDRImage(Device& device, PipelineBuilder& pipelineBuilder, const DecodedImage& image);
 		~HDRImage();
 
 
@@ -25,18 +42,25 @@ namespace cve
 		VkSampler& GetCubeMapSampler() { return m_CubeMapSampler;  }
 		VkImageView& GetIrradianceView() { return m_IrradianceMapImageView; }
 		VkSampler& GetIrradianceSampler() { return m_IrradianceMapSampler; }
+		// the cube maps can be sampled once this completed, see Device::isUploadComplete
+		UploadToken GetUploadToken() const { return m_UploadToken; }
 
 	private: 
 
-		void RenderToCubeMap(const VkExtent2D& extent, uint32_t mipLevels, const std::string& vertPath, const std::string& fragPath, VkImage&
+		using PipelineBuild = std::future<std::shared_ptr<Pipeline>>;
+
+		void RenderToCubeMap(const VkExtent2D& extent, uint32_t mipLevels, PipelineBuild& pipelineBuild, VkImage&
 			inputImage, const VkImageView& inputImageView, VkSampler
 			inputSampler, VkImage& outputCubeMapImage, std::array<std::vector<VkImageView>, 6>& outputCubeMapImageViews);
 
-		void CreateIrradianceMap();
+		//one sampled image + view and projection push constants, shared by both capture pipelines
+		void CreateCapturePipelineLayout();
+		PipelineBuild BuildCapturePipeline(PipelineBuilder& pipelineBuilder, const std::string& fragPath);
+		void CreateIrradianceMap(PipelineBuild& pipelineBuild);
 
 		void TransitionImageLayout(VkImage image, VkFormat, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
 		VkImageAspectFlags GetImageAspect(VkFormat format);
-		void CreateCubeMap();
+		void CreateCubeMap(PipelineBuild& pipelineBuild);
 		void CreateEquirectImage(uint32_t width, uint32_t height, uint32_t miplevels, VkFormat format, VkImageUsageFlags usage);
 		void CreateEquirectTextureImageView();
 		void CreateEquirectTextureSampler(VkFilter filter, VkSamplerAddressMode addressMode);
@@ -48,7 +72,7 @@ namespace cve
 
 		// IMAGES
 		VkImage m_EquirectImage;
-		VkDeviceMemory m_EquirectImageMemory;
+		MemoryAllocation m_EquirectImageMemory;
 		VkImageView m_EquirectImageView;
 		VkSampler m_EquirectSampler = VK_NULL_HANDLE;
 		uint32_t m_EquirectMipLevels{};
@@ -57,19 +81,24 @@ namespace cve
 		VkImageLayout m_EquirectImageLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
 
 		VkImage m_CubeMapImage;
-		VkDeviceMemory m_CubeMapImageMemory;
+		MemoryAllocation m_CubeMapImageMemory;
 		VkImageView m_CubeMapImageView;
 		VkSampler m_CubeMapSampler = VK_NULL_HANDLE;
 		VkExtent2D m_CubeMapExtent{ 1024, 1024 };
 		std::array<std::vector<VkImageView>, m_FACE_COUNT> m_CubeMapFaceViews;
 
 		VkImage m_IrradianceMapImage;
-		VkDeviceMemory m_IrradianceMapImageMemory;
+		MemoryAllocation m_IrradianceMapImageMemory;
 		VkImageView m_IrradianceMapImageView;
 		VkSampler m_IrradianceMapSampler = VK_NULL_HANDLE;
 		VkExtent2D m_IrradianceMapExtent{ 32, 32 };
 		std::array<VkImageView, m_FACE_COUNT> m_IrradianceMapFaceViews;
 
+		UploadToken m_UploadToken = 0;
+
+		VkDescriptorSetLayout m_CaptureSetLayout = VK_NULL_HANDLE;
+		VkPipelineLayout m_CapturePipelineLayout = VK_NULL_HANDLE;
+
 		const std::string m_CubeVertPath = "Shaders/Cube.vert.spv";
 		const std::string m_SkyFragPath = "Shaders/Sky.frag.spv";
 		const std::string m_IBLFragPath = "shaders/ImageBasedLighting.frag.spv";
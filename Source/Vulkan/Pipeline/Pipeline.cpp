@@ -1,6 +1,7 @@
 #include "Pipeline.h"
 #include "Model.h"
 //std
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <cassert>
@@ -10,14 +11,26 @@ namespace cve
 						const PipelineConfigInfo& configInfo,
 						const std::string& vertFilePath,
 						const std::string& fragFilePath)
-		:m_Device{device}
+		:Pipeline{device, configInfo, readFile(vertFilePath), readFile(fragFilePath)}
+	{
+	}
+	Pipeline::Pipeline(Device& device,
+						const PipelineConfigInfo& configInfo,
+						const std::vector<char>& vertCode,
+						const std::vector<char>& fragCode)
+		:Pipeline{device, configInfo, std::make_shared<const ShaderModule>(device, vertCode), std::make_shared<const ShaderModule>(device, fragCode)}
+	{
+	}
+	Pipeline::Pipeline(Device& device,
+						const PipelineConfigInfo& configInfo,
+						std::shared_ptr<const ShaderModule> vertModule,
+						std::shared_ptr<const ShaderModule> fragModule)
+		:m_Device{device}, m_VertShaderModule{std::move(vertModule)}, m_FragShaderModule{std::move(fragModule)}
 	{
-		CreateGraphicsPipeline(configInfo, vertFilePath, fragFilePath); 
+		CreateGraphicsPipeline(configInfo); 
 	}
 	Pipeline::~Pipeline()
 	{
-		vkDestroyShaderModule(m_Device.device(), m_VertShaderModule, nullptr); 
-		vkDestroyShaderModule(m_Device.device(), m_FragShaderModule, nullptr); 
 		vkDestroyPipeline(m_Device.device(), m_GraphicsPipeline, nullptr); 
 
 
@@ -44,19 +57,11 @@ namespace cve
 
 
 	}
-	void Pipeline::CreateGraphicsPipeline(const PipelineConfigInfo& configInfo,
-		const std::string& vertFilePath,
-		const std::string& fragFilePath)
+	void Pipeline::CreateGraphicsPipeline(const PipelineConfigInfo& configInfo)
 	{
 		assert(configInfo.pipelineLayout != VK_NULL_HANDLE &&
 			"Cannot create graphics pipeline: no pipelineLayout provided in configInfo");
 
-		std::vector<char> vertCode = readFile(vertFilePath); 
-		std::vector<char> fragCode = readFile(fragFilePath); 
-
-		CreateShaderModule(vertCode, &m_VertShaderModule);
-		CreateShaderModule(fragCode, &m_FragShaderModule);
-
 		const uint8_t amountOfShaders = 2; 
 		//similar to Direct3D you have to set shaderStages and specify a bunch of stuff like the kind of shader (vertex, fragment,...)
 		VkPipelineShaderStageCreateInfo shaderStages[amountOfShaders]; 
@@ -64,7 +69,7 @@ namespace cve
 		//vertex shader
 		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO; 
 		shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT; 
-		shaderStages[0].module = m_VertShaderModule; 
+		shaderStages[0].module = m_VertShaderModule->GetHandle(); 
 		shaderStages[0].pName = "main"; //name to the entry function of the shader (I guess it can be changed then if you change both the function and this name?)
 		shaderStages[0].flags = 0; 
 		shaderStages[0].pNext = nullptr; 
@@ -73,12 +78,28 @@ namespace cve
 		//fragment shader
 		shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		shaderStages[1].module = m_FragShaderModule;
+		shaderStages[1].module = m_FragShaderModule->GetHandle();
 		shaderStages[1].pName = "main"; //name to the entry function of the shader (I guess it can be changed then if you change both the function and this name?)
 		shaderStages[1].flags = 0;
 		shaderStages[1].pNext = nullptr;
 		shaderStages[1].pSpecializationInfo = nullptr;
 
+		//picks the shader variant, the compiler folds the constants and drops the branches they switch off
+		std::vector<VkSpecializationMapEntry> specializationEntries(configInfo.fragmentSpecialization.size());
+		for (uint32_t i = 0; i < specializationEntries.size(); ++i)
+		{
+			specializationEntries[i] = { i, i * static_cast<uint32_t>(sizeof(uint32_t)), sizeof(uint32_t) };
+		}
+		VkSpecializationInfo specializationInfo{};
+		specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+		specializationInfo.pMapEntries = specializationEntries.data();
+		specializationInfo.dataSize = configInfo.fragmentSpecialization.size() * sizeof(uint32_t);
+		specializationInfo.pData = configInfo.fragmentSpecialization.data();
+		if (!specializationEntries.empty())
+		{
+			shaderStages[1].pSpecializationInfo = &specializationInfo;
+		}
+
 
 		const auto & bindingDescriptions = configInfo.vertexBindings;
 		const auto & attributeDescriptions = configInfo.vertexAttributes;
@@ -118,26 +139,31 @@ namespace cve
 		pipelineInfo.basePipelineIndex = -1; 
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; 
 
-		//and finally create the shit
-		if (vkCreateGraphicsPipelines(m_Device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_GraphicsPipeline) != VK_SUCCESS)
+		//and finally create the shit, through the device's pipeline cache so a warm start skips the compile
+		const auto start = std::chrono::high_resolution_clock::now();
+		if (vkCreateGraphicsPipelines(m_Device.device(), m_Device.pipelineCache(), 1, &pipelineInfo, nullptr, &m_GraphicsPipeline) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to create graphics pipeline"); 
 		}
+		m_Device.recordPipelineCreation(start, std::chrono::high_resolution_clock::now());
 
 	}
-	void Pipeline::CreateShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule)
+	ShaderModule::ShaderModule(Device& device, const std::vector<char>& code)
+		:m_Device{device}
 	{
 		VkShaderModuleCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 		createInfo.codeSize = code.size();
 		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
-		if (vkCreateShaderModule(m_Device.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS)
+		if (vkCreateShaderModule(m_Device.device(), &createInfo, nullptr, &m_Module) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to create shader module (pipeline class)"); 
 		}
-
-
+	}
+	ShaderModule::~ShaderModule()
+	{
+		vkDestroyShaderModule(m_Device.device(), m_Module, nullptr); 
 	}
 
 	void Pipeline::DefaultPipelineConfigInfo(PipelineConfigInfo& configInfo)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Device.h"
+#include <memory>
 #include <string>
 #include <vector>
 namespace cve {
@@ -17,6 +18,7 @@ struct PipelineConfigInfo
 	VkPipelineRasterizationStateCreateInfo rasterizationInfo;
 	VkPipelineMultisampleStateCreateInfo multisampleInfo;
 	VkPipelineColorBlendAttachmentState colorBlendAttachment;
+	std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments{};	//one per color attachment when there are several, colorBlendInfo points here
 	VkPipelineColorBlendStateCreateInfo colorBlendInfo;
 	VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
 	std::vector<VkDynamicState> dynamicStateEnables; 
@@ -30,6 +32,26 @@ struct PipelineConfigInfo
 	std::vector<VkFormat> colorAttachmentFormats{};
 	VkFormat depthAttachmentFormat = VK_FORMAT_UNDEFINED;
 	VkPipelineRenderingCreateInfo renderingInfo{};
+
+	//fragment shader specialization constants, entry i goes to constant_id i (32 bit uint / bool constants)
+	std::vector<uint32_t> fragmentSpecialization{};
+};
+
+//owns a VkShaderModule, pipelines created from the same SPIR-V share one through the PipelineRegistry
+class ShaderModule
+{
+public:
+	ShaderModule(Device& device, const std::vector<char>& code);
+	~ShaderModule();
+
+	ShaderModule(const ShaderModule&) = delete;
+	ShaderModule& operator=(const ShaderModule&) = delete;
+
+	VkShaderModule GetHandle() const { return m_Module; }
+
+private:
+	Device& m_Device;
+	VkShaderModule m_Module = VK_NULL_HANDLE;
 };
 
 class Pipeline
@@ -40,6 +62,16 @@ public:
 			 const PipelineConfigInfo& configInfo,
 			 const std::string& vertFilePath ,
 			 const std::string& fragFilePath); 
+	//SPIR-V already in memory, see PipelineBuilder
+	Pipeline(Device& device,
+			 const PipelineConfigInfo& configInfo,
+			 const std::vector<char>& vertCode,
+			 const std::vector<char>& fragCode);
+	//modules that may be shared with other pipelines, they live as long as the pipeline does
+	Pipeline(Device& device,
+			 const PipelineConfigInfo& configInfo,
+			 std::shared_ptr<const ShaderModule> vertModule,
+			 std::shared_ptr<const ShaderModule> fragModule);
 
 	~Pipeline();
 
@@ -51,19 +83,16 @@ public:
 
 	void Bind(VkCommandBuffer commandBuffer); 
 
+	static std::vector<char> readFile(const std::string& filePath); 
 
 private: 
 
-	static std::vector<char> readFile(const std::string& filePath); 
-	void CreateGraphicsPipeline(const PipelineConfigInfo& configInfo, 
-								const std::string& verFilePath, 
-								const std::string& fragFilePath); 
-	void CreateShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule); 
+	void CreateGraphicsPipeline(const PipelineConfigInfo& configInfo); 
 
 	Device& m_Device; //agregation, be carefull not to create a dangling pointer
 	VkPipeline m_GraphicsPipeline; 
-	VkShaderModule m_VertShaderModule; 
-	VkShaderModule m_FragShaderModule; 
+	std::shared_ptr<const ShaderModule> m_VertShaderModule; 
+	std::shared_ptr<const ShaderModule> m_FragShaderModule; 
 
 
 };
@@ -0,0 +1,33 @@
+#include "PipelineBuilder.h"
+
+namespace cve
+{
+	PipelineBuilder::PipelineBuilder(Device& device, uint32_t threadCount)
+		:m_Device{ device }, m_Registry{ device }, m_Pool{ threadCount }
+	{
+	}
+
+	std::future<std::shared_ptr<Pipeline>> PipelineBuilder::Build(std::unique_ptr<PipelineConfigInfo> config, const std::string& vertFilePath, const std::string& fragFilePath)
+	{
+		// shared so the job stays copyable
+		std::shared_ptr<const PipelineConfigInfo> sharedConfig = std::move(config);
+		return m_Pool.Submit([this, sharedConfig, vertFilePath, fragFilePath]()
+			{
+				auto vertModule = m_Registry.GetShaderModule(*GetSpirv(vertFilePath));
+				auto fragModule = m_Registry.GetShaderModule(*GetSpirv(fragFilePath));
+				return m_Registry.GetPipeline(*sharedConfig, std::move(vertModule), std::move(fragModule));
+			});
+	}
+
+	std::shared_ptr<const std::vector<char>> PipelineBuilder::GetSpirv(const std::string& filePath)
+	{
+		// the files are a few KB, reading under the lock keeps two builds from reading the same one
+		std::lock_guard lock{ m_SpirvMutex };
+		auto& code = m_Spirv[filePath];
+		if (!code)
+		{
+			code = std::make_shared<const std::vector<char>>(Pipeline::readFile(filePath));
+		}
+		return code;
+	}
+}
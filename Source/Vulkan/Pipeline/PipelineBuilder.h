@@ -0,0 +1,48 @@
+#pragma once
+#include "Pipeline.h"
+#include "PipelineRegistry.h"
+#include "ThreadPool.h"
+
+//std
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cve
+{
+	// Creates pipelines on worker threads. Build hands back a future right away, shader modules and the pipeline are taken
+	// from the registry on a worker, what it has to create goes through the device's pipeline cache (vkCreateShaderModule and
+	// vkCreateGraphicsPipelines may run on several threads at once, the cache synchronizes itself). Every SPIR-V file is read
+	// once per builder. The pipeline layout in the config has to outlive the build, wait for the future before destroying it.
+	class PipelineBuilder final
+	{
+	public:
+		// threadCount 0 = one worker per hardware thread
+		explicit PipelineBuilder(Device& device, uint32_t threadCount = 0);
+
+		PipelineBuilder(const PipelineBuilder&) = delete;
+		PipelineBuilder& operator=(const PipelineBuilder&) = delete;
+
+		// the config is heap allocated so the pointers it keeps into itself stay valid, the builder owns it until the pipeline
+		// is created. Exceptions (missing file, failed creation) are rethrown from the future's get()
+		std::future<std::shared_ptr<Pipeline>> Build(std::unique_ptr<PipelineConfigInfo> config, const std::string& vertFilePath, const std::string& fragFilePath);
+
+		// the file's bytes, read on the first request for the path. Thread safe
+		std::shared_ptr<const std::vector<char>> GetSpirv(const std::string& filePath);
+
+		PipelineRegistry& GetRegistry() { return m_Registry; }
+
+	private:
+		Device& m_Device;
+		PipelineRegistry m_Registry;
+
+		std::mutex m_SpirvMutex;
+		std::unordered_map<std::string, std::shared_ptr<const std::vector<char>>> m_Spirv;
+
+		// last, the workers finish their builds before the SPIR-V goes
+		ThreadPool m_Pool;
+	};
+}
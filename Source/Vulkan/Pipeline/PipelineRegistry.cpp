@@ -0,0 +1,242 @@
+#include "PipelineRegistry.h"
+
+//std
+#include <exception>
+#include <type_traits>
+
+namespace cve
+{
+	namespace
+	{
+		template <typename T>
+		void Append(std::string& key, const T& value)
+		{
+			static_assert(std::is_scalar_v<T>, "append the fields, structs have padding and pointers");
+			key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		void AppendStencilOp(std::string& key, const VkStencilOpState& op)
+		{
+			Append(key, op.failOp);
+			Append(key, op.passOp);
+			Append(key, op.depthFailOp);
+			Append(key, op.compareOp);
+			Append(key, op.compareMask);
+			Append(key, op.writeMask);
+			Append(key, op.reference);
+		}
+
+		//everything Pipeline::CreateGraphicsPipeline hands to vkCreateGraphicsPipelines, field by field
+		std::string SerializeState(const PipelineConfigInfo& config, VkShaderModule vertModule, VkShaderModule fragModule)
+		{
+			std::string key;
+			key.reserve(512);
+			Append(key, vertModule);
+			Append(key, fragModule);
+			Append(key, config.pipelineLayout);
+
+			Append(key, config.vertexBindings.size());
+			for (const auto& binding : config.vertexBindings)
+			{
+				Append(key, binding.binding);
+				Append(key, binding.stride);
+				Append(key, binding.inputRate);
+			}
+			Append(key, config.vertexAttributes.size());
+			for (const auto& attribute : config.vertexAttributes)
+			{
+				Append(key, attribute.location);
+				Append(key, attribute.binding);
+				Append(key, attribute.format);
+				Append(key, attribute.offset);
+			}
+
+			Append(key, config.inputAssemblyInfo.topology);
+			Append(key, config.inputAssemblyInfo.primitiveRestartEnable);
+
+			const auto& viewport = config.viewportInfo;
+			Append(key, viewport.viewportCount);
+			Append(key, viewport.scissorCount);
+			for (uint32_t i = 0; viewport.pViewports && i < viewport.viewportCount; ++i)
+			{
+				Append(key, viewport.pViewports[i].x);
+				Append(key, viewport.pViewports[i].y);
+				Append(key, viewport.pViewports[i].width);
+				Append(key, viewport.pViewports[i].height);
+				Append(key, viewport.pViewports[i].minDepth);
+				Append(key, viewport.pViewports[i].maxDepth);
+			}
+			for (uint32_t i = 0; viewport.pScissors && i < viewport.scissorCount; ++i)
+			{
+				Append(key, viewport.pScissors[i].offset.x);
+				Append(key, viewport.pScissors[i].offset.y);
+				Append(key, viewport.pScissors[i].extent.width);
+				Append(key, viewport.pScissors[i].extent.height);
+			}
+
+			const auto& raster = config.rasterizationInfo;
+			Append(key, raster.depthClampEnable);
+			Append(key, raster.rasterizerDiscardEnable);
+			Append(key, raster.polygonMode);
+			Append(key, raster.cullMode);
+			Append(key, raster.frontFace);
+			Append(key, raster.depthBiasEnable);
+			Append(key, raster.depthBiasConstantFactor);
+			Append(key, raster.depthBiasClamp);
+			Append(key, raster.depthBiasSlopeFactor);
+			Append(key, raster.lineWidth);
+
+			const auto& multisample = config.multisampleInfo;
+			Append(key, multisample.rasterizationSamples);
+			Append(key, multisample.sampleShadingEnable);
+			Append(key, multisample.minSampleShading);
+			Append(key, multisample.pSampleMask ? multisample.pSampleMask[0] : ~0u);
+			Append(key, multisample.alphaToCoverageEnable);
+			Append(key, multisample.alphaToOneEnable);
+
+			const auto& blend = config.colorBlendInfo;
+			Append(key, blend.logicOpEnable);
+			Append(key, blend.logicOp);
+			Append(key, blend.attachmentCount);
+			for (uint32_t i = 0; i < blend.attachmentCount; ++i)
+			{
+				const auto& attachment = blend.pAttachments[i];
+				Append(key, attachment.blendEnable);
+				Append(key, attachment.srcColorBlendFactor);
+				Append(key, attachment.dstColorBlendFactor);
+				Append(key, attachment.colorBlendOp);
+				Append(key, attachment.srcAlphaBlendFactor);
+				Append(key, attachment.dstAlphaBlendFactor);
+				Append(key, attachment.alphaBlendOp);
+				Append(key, attachment.colorWriteMask);
+			}
+			for (float constant : blend.blendConstants)
+			{
+				Append(key, constant);
+			}
+
+			const auto& depth = config.depthStencilInfo;
+			Append(key, depth.depthTestEnable);
+			Append(key, depth.depthWriteEnable);
+			Append(key, depth.depthCompareOp);
+			Append(key, depth.depthBoundsTestEnable);
+			Append(key, depth.stencilTestEnable);
+			AppendStencilOp(key, depth.front);
+			AppendStencilOp(key, depth.back);
+			Append(key, depth.minDepthBounds);
+			Append(key, depth.maxDepthBounds);
+
+			Append(key, config.dynamicStateInfo.dynamicStateCount);
+			for (uint32_t i = 0; i < config.dynamicStateInfo.dynamicStateCount; ++i)
+			{
+				Append(key, config.dynamicStateInfo.pDynamicStates[i]);
+			}
+
+			Append(key, config.colorAttachmentFormats.size());
+			for (VkFormat format : config.colorAttachmentFormats)
+			{
+				Append(key, format);
+			}
+			Append(key, config.depthAttachmentFormat);
+			Append(key, config.renderingInfo.stencilAttachmentFormat);
+			Append(key, config.renderingInfo.viewMask);
+
+			Append(key, config.fragmentSpecialization.size());
+			for (uint32_t constant : config.fragmentSpecialization)
+			{
+				Append(key, constant);
+			}
+			return key;
+		}
+	}
+
+	PipelineRegistry::PipelineRegistry(Device& device)
+		:m_Device{ device }
+	{
+	}
+
+	std::shared_ptr<const ShaderModule> PipelineRegistry::GetShaderModule(const std::vector<char>& code)
+	{
+		std::string key(code.begin(), code.end());
+
+		// creating a module only copies the SPIR-V, cheap enough to do under the lock
+		std::lock_guard lock{ m_Mutex };
+		if (auto it = m_Modules.find(key); it != m_Modules.end())
+		{
+			if (auto module = it->second.lock())
+			{
+				++m_Stats.moduleHits;
+				return module;
+			}
+		}
+
+		++m_Stats.moduleMisses;
+		std::erase_if(m_Modules, [](const auto& entry) { return entry.second.expired(); });
+		auto module = std::make_shared<const ShaderModule>(m_Device, code);
+		m_Modules[std::move(key)] = module;
+		return module;
+	}
+
+	std::shared_ptr<Pipeline> PipelineRegistry::GetPipeline(const PipelineConfigInfo& config, std::shared_ptr<const ShaderModule> vertModule, std::shared_ptr<const ShaderModule> fragModule)
+	{
+		const std::string key = SerializeState(config, vertModule->GetHandle(), fragModule->GetHandle());
+
+		std::promise<std::shared_ptr<Pipeline>> creating;
+		{
+			std::unique_lock lock{ m_Mutex };
+			if (auto it = m_Pipelines.find(key); it != m_Pipelines.end())
+			{
+				if (auto pipeline = it->second.pipeline.lock())
+				{
+					++m_Stats.pipelineHits;
+					return pipeline;
+				}
+				if (it->second.creating.valid())
+				{
+					++m_Stats.pipelineHits;
+					auto other = it->second.creating;
+					lock.unlock();
+					return other.get();
+				}
+			}
+
+			++m_Stats.pipelineMisses;
+			std::erase_if(m_Pipelines, [](const auto& entry) { return entry.second.pipeline.expired() && !entry.second.creating.valid(); });
+			m_Pipelines[key].creating = creating.get_future().share();
+		}
+
+		// outside the lock, pipelines with other state are created on other threads meanwhile
+		std::shared_ptr<Pipeline> pipeline;
+		try
+		{
+			pipeline = std::make_shared<Pipeline>(m_Device, config, std::move(vertModule), std::move(fragModule));
+		}
+		catch (...)
+		{
+			creating.set_exception(std::current_exception());
+			std::lock_guard lock{ m_Mutex };
+			m_Pipelines.erase(key);
+			throw;
+		}
+
+		creating.set_value(pipeline);
+		std::lock_guard lock{ m_Mutex };
+		auto& entry = m_Pipelines[key];
+		entry.pipeline = pipeline;
+		entry.creating = {};
+		return pipeline;
+	}
+
+	PipelineRegistry::Stats PipelineRegistry::GetStats() const
+	{
+		std::lock_guard lock{ m_Mutex };
+		return m_Stats;
+	}
+
+	void PipelineRegistry::PrintStats(std::ostream& out) const
+	{
+		const Stats stats = GetStats();
+		out << "[PipelineRegistry] shader modules: " << stats.moduleHits << " shared, " << stats.moduleMisses << " created | pipelines: "
+			<< stats.pipelineHits << " shared, " << stats.pipelineMisses << " created" << std::endl;
+	}
+}
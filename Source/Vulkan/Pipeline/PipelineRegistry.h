@@ -0,0 +1,58 @@
+#pragma once
+#include "Pipeline.h"
+
+//std
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cve
+{
+	// Hands out shared shader modules and pipelines. Modules are keyed by their SPIR-V, pipelines by every piece of state
+	// vkCreateGraphicsPipelines sees (the config, the layout handle and the modules), so the same bytecode or the same state
+	// requested twice gives back the object that is still alive instead of creating another one. The registry only keeps
+	// weak references, an object goes away with its last user. Layouts are compared by handle, two identical layouts
+	// created separately don't share pipelines.
+	// Thread safe. A pipeline requested while another thread creates the same one waits for that one.
+	class PipelineRegistry final
+	{
+	public:
+		struct Stats
+		{
+			uint32_t moduleHits = 0;
+			uint32_t moduleMisses = 0;	// modules created
+			uint32_t pipelineHits = 0;
+			uint32_t pipelineMisses = 0;	// pipelines created
+		};
+
+		explicit PipelineRegistry(Device& device);
+
+		PipelineRegistry(const PipelineRegistry&) = delete;
+		PipelineRegistry& operator=(const PipelineRegistry&) = delete;
+
+		std::shared_ptr<const ShaderModule> GetShaderModule(const std::vector<char>& code);
+		std::shared_ptr<Pipeline> GetPipeline(const PipelineConfigInfo& config, std::shared_ptr<const ShaderModule> vertModule, std::shared_ptr<const ShaderModule> fragModule);
+
+		Stats GetStats() const;
+		void PrintStats(std::ostream& out) const;
+
+	private:
+		struct PipelineEntry
+		{
+			std::weak_ptr<Pipeline>                      pipeline;
+			std::shared_future<std::shared_ptr<Pipeline>> creating;	// valid while a thread creates it
+		};
+
+		Device& m_Device;
+
+		mutable std::mutex m_Mutex;
+		std::unordered_map<std::string, std::weak_ptr<const ShaderModule>> m_Modules;	// SPIR-V bytes as key
+		std::unordered_map<std::string, PipelineEntry> m_Pipelines;	// serialized state as key, see SerializeState
+		Stats m_Stats{};
+	};
+}
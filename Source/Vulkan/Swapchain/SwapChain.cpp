@@ -21,7 +21,7 @@ namespace cve {
 	{
 		init();
 
-		//clean up old swap chain since it s no longer needed
+		//the caller retires the old swap chain once the frames still presenting from it are done
 		oldSwapChain = nullptr;
 	}
 
@@ -29,8 +29,14 @@ namespace cve {
 	{
 		createSwapChain();
 		createImageViews();
-		createDepthResources();
-		createSyncObjects();
+		//no depth images of our own, the passes render against the G-buffer's depth
+		swapChainDepthFormat = findDepthFormat();
+		if (oldSwapChain != nullptr) {
+			adoptSyncObjects(*oldSwapChain);
+		}
+		else {
+			createSyncObjects();
+		}
 	}
 
 	SwapChain::~SwapChain() {
@@ -44,14 +50,8 @@ namespace cve {
 			swapChain = nullptr;
 		}
 
-		for (int i = 0; i < depthImages.size(); i++) {
-			vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-			vkDestroyImage(device.device(), depthImages[i], nullptr);
-			vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
-		}
-
-		// cleanup synchronization objects
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		// cleanup synchronization objects, empty when a newer swap chain took them over
+		for (size_t i = 0; i < inFlightFences.size(); i++) {
 			vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
 			vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
 			vkDestroyFence(device.device(), inFlightFences[i], nullptr);
@@ -216,55 +216,6 @@ namespace cve {
 	}
 
 
-	void SwapChain::createDepthResources() {
-		VkFormat depthFormat = findDepthFormat();
-		swapChainDepthFormat = depthFormat;
-		VkExtent2D swapChainExtent = getSwapChainExtent();
-
-		depthImages.resize(imageCount());
-		depthImageMemorys.resize(imageCount());
-		depthImageViews.resize(imageCount());
-
-		for (int i = 0; i < depthImages.size(); i++) {
-			VkImageCreateInfo imageInfo{};
-			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-			imageInfo.imageType = VK_IMAGE_TYPE_2D;
-			imageInfo.extent.width = swapChainExtent.width;
-			imageInfo.extent.height = swapChainExtent.height;
-			imageInfo.extent.depth = 1;
-			imageInfo.mipLevels = 1;
-			imageInfo.arrayLayers = 1;
-			imageInfo.format = depthFormat;
-			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-			imageInfo.flags = 0;
-
-			device.createImageWithInfo(
-				imageInfo,
-				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-				depthImages[i],
-				depthImageMemorys[i]);
-
-			VkImageViewCreateInfo viewInfo{};
-			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-			viewInfo.image = depthImages[i];
-			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-			viewInfo.format = depthFormat;
-			viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-			viewInfo.subresourceRange.baseMipLevel = 0;
-			viewInfo.subresourceRange.levelCount = 1;
-			viewInfo.subresourceRange.baseArrayLayer = 0;
-			viewInfo.subresourceRange.layerCount = 1;
-
-			if (vkCreateImageView(device.device(), &viewInfo, nullptr, &depthImageViews[i]) != VK_SUCCESS) {
-				throw std::runtime_error("failed to create texture image view!");
-			}
-		}
-	}
-
 	void SwapChain::createSyncObjects() {
 		imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 		renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -289,6 +240,19 @@ namespace cve {
 		}
 	}
 
+	void SwapChain::adoptSyncObjects(SwapChain& previous) {
+		// the frame slots carry on where the old swap chain left them, so waiting on a slot's fence still covers the
+		// frame that was submitted to it before the recreation
+		imageAvailableSemaphores = std::move(previous.imageAvailableSemaphores);
+		renderFinishedSemaphores = std::move(previous.renderFinishedSemaphores);
+		inFlightFences = std::move(previous.inFlightFences);
+		currentFrame = previous.currentFrame;
+		previous.imageAvailableSemaphores.clear();
+		previous.renderFinishedSemaphores.clear();
+		previous.inFlightFences.clear();
+		imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+	}
+
 	VkSurfaceFormatKHR SwapChain::chooseSwapSurfaceFormat(
 		const std::vector<VkSurfaceFormatKHR>& availableFormats) {
 		for (const auto& availableFormat : availableFormats) {
@@ -24,9 +24,7 @@ namespace cve {
 		SwapChain& operator=(const SwapChain&) = delete;
 
 		VkImageView getImageView(int index) { return swapChainImageViews[index]; }
-		VkImageView getDepthImageView(int index) { return depthImageViews[index]; }
 		VkImage getImage(int index) { return swapChainImages[index]; }
-		VkImage getDepthImage(int index) { return depthImages[index]; }
 		size_t imageCount() { return swapChainImages.size(); } 
 		VkFormat getSwapChainImageFormat() const { return swapChainImageFormat; }
 		VkExtent2D getSwapChainExtent() const { return swapChainExtent; }
@@ -51,8 +49,8 @@ namespace cve {
 		void init();
 		void createSwapChain();
 		void createImageViews();
-		void createDepthResources();
 		void createSyncObjects();
+		void adoptSyncObjects(SwapChain& previous);
 
 		// Helper functions
 		VkSurfaceFormatKHR chooseSwapSurfaceFormat(
@@ -65,9 +63,6 @@ namespace cve {
 		VkFormat swapChainDepthFormat;
 		VkExtent2D swapChainExtent;
 
-		std::vector<VkImage> depthImages;
-		std::vector<VkDeviceMemory> depthImageMemorys;
-		std::vector<VkImageView> depthImageViews;
 		std::vector<VkImage> swapChainImages;
 		std::vector<VkImageView> swapChainImageViews;
 
@@ -0,0 +1,403 @@
+#include "BlockCompressor.h"
+
+//std
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace cve
+{
+	namespace
+	{
+		// BC7 4 bit index interpolation weights out of 64
+		constexpr int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		// refit passes after the PCA guess, each one solves the endpoints for the current indices and requantizes
+		constexpr int BC7_REFINE_PASSES = 2;
+
+		struct BitWriter
+		{
+			uint8_t* out;
+			uint32_t position = 0;
+
+			void Write(uint32_t value, uint32_t bits)
+			{
+				for (uint32_t i = 0; i < bits; ++i, ++position)
+				{
+					if ((value >> i) & 1u) out[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+				}
+			}
+		};
+
+		bool IsSrgb(VkFormat format)
+		{
+			return format == VK_FORMAT_R8_SRGB || format == VK_FORMAT_R8G8_SRGB ||
+				format == VK_FORMAT_R8G8B8_SRGB || format == VK_FORMAT_R8G8B8A8_SRGB;
+		}
+
+		// -- BC7 mode 6 ------------------------------------------------------------
+
+		struct Mode6Block
+		{
+			int      endpoints[2][4];	//7 bit
+			int      pbits[2];
+			uint8_t  indices[16];
+			uint64_t error = UINT64_MAX;
+		};
+
+		// best palette entry per texel for the given endpoints, returns the summed squared RGBA error
+		uint64_t AssignMode6Indices(const uint8_t texels[16][4], const int endpoints[2][4], const int pbits[2], uint8_t indices[16])
+		{
+			int palette[16][4];
+			for (int c = 0; c < 4; ++c)
+			{
+				const int e0 = (endpoints[0][c] << 1) | pbits[0];
+				const int e1 = (endpoints[1][c] << 1) | pbits[1];
+				for (int i = 0; i < 16; ++i)
+				{
+					palette[i][c] = ((64 - BC7_WEIGHTS[i]) * e0 + BC7_WEIGHTS[i] * e1 + 32) >> 6;
+				}
+			}
+
+			uint64_t total = 0;
+			for (int t = 0; t < 16; ++t)
+			{
+				int bestError = INT32_MAX;
+				for (int i = 0; i < 16; ++i)
+				{
+					int error = 0;
+					for (int c = 0; c < 4; ++c)
+					{
+						const int d = texels[t][c] - palette[i][c];
+						error += d * d;
+					}
+					if (error < bestError)
+					{
+						bestError = error;
+						indices[t] = static_cast<uint8_t>(i);
+					}
+				}
+				total += static_cast<uint64_t>(bestError);
+			}
+			return total;
+		}
+
+		// quantizes float endpoints with all four p-bit combinations and keeps the best one in best
+		void TryMode6Endpoints(const uint8_t texels[16][4], const float lo[4], const float hi[4], Mode6Block& best)
+		{
+			for (int p = 0; p < 4; ++p)
+			{
+				Mode6Block candidate{};
+				candidate.pbits[0] = p & 1;
+				candidate.pbits[1] = p >> 1;
+				for (int c = 0; c < 4; ++c)
+				{
+					candidate.endpoints[0][c] = std::clamp(static_cast<int>(std::lround((lo[c] - candidate.pbits[0]) * 0.5f)), 0, 127);
+					candidate.endpoints[1][c] = std::clamp(static_cast<int>(std::lround((hi[c] - candidate.pbits[1]) * 0.5f)), 0, 127);
+				}
+				candidate.error = AssignMode6Indices(texels, candidate.endpoints, candidate.pbits, candidate.indices);
+				if (candidate.error < best.error) best = candidate;
+			}
+		}
+
+		// least squares endpoints for fixed indices, false when every texel uses the same weight
+		bool SolveMode6Endpoints(const uint8_t texels[16][4], const uint8_t indices[16], float lo[4], float hi[4])
+		{
+			float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+			float ax[4]{}, bx[4]{};
+			for (int t = 0; t < 16; ++t)
+			{
+				const float w = BC7_WEIGHTS[indices[t]] / 64.0f;
+				aa += (1.0f - w) * (1.0f - w);
+				ab += (1.0f - w) * w;
+				bb += w * w;
+				for (int c = 0; c < 4; ++c)
+				{
+					ax[c] += (1.0f - w) * texels[t][c];
+					bx[c] += w * texels[t][c];
+				}
+			}
+
+			const float det = aa * bb - ab * ab;
+			if (std::fabs(det) < 1e-6f) return false;
+			for (int c = 0; c < 4; ++c)
+			{
+				lo[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+				hi[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+			}
+			return true;
+		}
+
+		// -- BC4 ------------------------------------------------------------------
+
+		// palette as the hardware decodes it, r0 > r1 selects 8 interpolated values, otherwise 6 plus 0 and 255
+		void BuildBC4Palette(int r0, int r1, float palette[8])
+		{
+			palette[0] = static_cast<float>(r0);
+			palette[1] = static_cast<float>(r1);
+			if (r0 > r1)
+			{
+				for (int i = 2; i < 8; ++i) palette[i] = ((8 - i) * r0 + (i - 1) * r1) / 7.0f;
+			}
+			else
+			{
+				for (int i = 2; i < 6; ++i) palette[i] = ((6 - i) * r0 + (i - 1) * r1) / 5.0f;
+				palette[6] = 0.0f;
+				palette[7] = 255.0f;
+			}
+		}
+
+		float AssignBC4Indices(const uint8_t values[16], int r0, int r1, uint8_t indices[16])
+		{
+			float palette[8];
+			BuildBC4Palette(r0, r1, palette);
+
+			float total = 0.0f;
+			for (int t = 0; t < 16; ++t)
+			{
+				float bestError = FLT_MAX;
+				for (int i = 0; i < 8; ++i)
+				{
+					const float d = values[t] - palette[i];
+					if (d * d < bestError)
+					{
+						bestError = d * d;
+						indices[t] = static_cast<uint8_t>(i);
+					}
+				}
+				total += bestError;
+			}
+			return total;
+		}
+	}
+
+	uint32_t BlockCompressor::GetBlockBytes(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+			return 16;
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+			return 8;
+		default:
+			return 0;
+		}
+	}
+
+	void BlockCompressor::EncodeBC7Block(const uint8_t texels[16][4], uint8_t out[16])
+	{
+		// principal axis of the block (power iteration on the covariance), the endpoints start at the extremes along it
+		float mean[4]{};
+		for (int t = 0; t < 16; ++t)
+		{
+			for (int c = 0; c < 4; ++c) mean[c] += texels[t][c] / 16.0f;
+		}
+
+		float covariance[4][4]{};
+		float boxMin[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+		float boxMax[4]{};
+		for (int t = 0; t < 16; ++t)
+		{
+			float d[4];
+			for (int c = 0; c < 4; ++c)
+			{
+				d[c] = texels[t][c] - mean[c];
+				boxMin[c] = std::min(boxMin[c], float(texels[t][c]));
+				boxMax[c] = std::max(boxMax[c], float(texels[t][c]));
+			}
+			for (int i = 0; i < 4; ++i)
+			{
+				for (int j = 0; j < 4; ++j) covariance[i][j] += d[i] * d[j];
+			}
+		}
+
+		float axis[4];
+		for (int c = 0; c < 4; ++c) axis[c] = boxMax[c] - boxMin[c];
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4]{};
+			for (int i = 0; i < 4; ++i)
+			{
+				for (int j = 0; j < 4; ++j) next[i] += covariance[i][j] * axis[j];
+			}
+			const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+			if (length < 1e-6f) break;
+			for (int c = 0; c < 4; ++c) axis[c] = next[c] / length;
+		}
+
+		float minProjection = FLT_MAX, maxProjection = -FLT_MAX;
+		for (int t = 0; t < 16; ++t)
+		{
+			float projection = 0.0f;
+			for (int c = 0; c < 4; ++c) projection += (texels[t][c] - mean[c]) * axis[c];
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+
+		float lo[4], hi[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			lo[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+			hi[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+		}
+
+		Mode6Block best{};
+		TryMode6Endpoints(texels, lo, hi, best);
+		for (int pass = 0; pass < BC7_REFINE_PASSES && best.error > 0; ++pass)
+		{
+			if (!SolveMode6Endpoints(texels, best.indices, lo, hi)) break;
+			TryMode6Endpoints(texels, lo, hi, best);
+		}
+
+		// the anchor texel stores only 3 index bits, so its index must be below 8
+		if (best.indices[0] >= 8)
+		{
+			for (int c = 0; c < 4; ++c) std::swap(best.endpoints[0][c], best.endpoints[1][c]);
+			std::swap(best.pbits[0], best.pbits[1]);
+			for (auto& index : best.indices) index = static_cast<uint8_t>(15 - index);
+		}
+
+		std::memset(out, 0, 16);
+		BitWriter writer{ out };
+		writer.Write(1u << 6, 7);	//mode 6
+		for (int c = 0; c < 4; ++c)
+		{
+			writer.Write(static_cast<uint32_t>(best.endpoints[0][c]), 7);
+			writer.Write(static_cast<uint32_t>(best.endpoints[1][c]), 7);
+		}
+		writer.Write(static_cast<uint32_t>(best.pbits[0]), 1);
+		writer.Write(static_cast<uint32_t>(best.pbits[1]), 1);
+		for (int t = 0; t < 16; ++t)
+		{
+			writer.Write(best.indices[t], t == 0 ? 3 : 4);
+		}
+	}
+
+	void BlockCompressor::EncodeBC4Block(const uint8_t values[16], uint8_t out[8])
+	{
+		int minValue = 255, maxValue = 0;
+		int minInner = 255, maxInner = 0;	//ignoring 0 and 255, which the 6 value mode has for free
+		for (int t = 0; t < 16; ++t)
+		{
+			minValue = std::min<int>(minValue, values[t]);
+			maxValue = std::max<int>(maxValue, values[t]);
+			if (values[t] != 0 && values[t] != 255)
+			{
+				minInner = std::min<int>(minInner, values[t]);
+				maxInner = std::max<int>(maxInner, values[t]);
+			}
+		}
+		if (minInner > maxInner) minInner = maxInner = 0;
+
+		uint8_t indices[16];
+		int r0 = maxValue, r1 = minValue;
+		float error = AssignBC4Indices(values, r0, r1, indices);
+
+		uint8_t innerIndices[16];
+		if (AssignBC4Indices(values, minInner, maxInner, innerIndices) < error)
+		{
+			r0 = minInner;
+			r1 = maxInner;
+			std::memcpy(indices, innerIndices, sizeof(indices));
+		}
+
+		out[0] = static_cast<uint8_t>(r0);
+		out[1] = static_cast<uint8_t>(r1);
+		uint64_t bits = 0;
+		for (int t = 0; t < 16; ++t)
+		{
+			bits |= static_cast<uint64_t>(indices[t]) << (3 * t);
+		}
+		for (int i = 0; i < 6; ++i)
+		{
+			out[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+		}
+	}
+
+	TextureDecoder::DecodedImage BlockCompressor::Compress(const TextureDecoder::DecodedImage& source, VkFormat compressedFormat)
+	{
+		const uint32_t blockBytes = GetBlockBytes(compressedFormat);
+		if (blockBytes == 0 || source.blockBytes != 0 || source.channels <= 0)
+		{
+			throw std::runtime_error("Unsupported block compression of " + source.filename);
+		}
+
+		// every level is encoded from its filtered uncompressed version
+		TextureDecoder::DecodedImage chain{};
+		const TextureDecoder::DecodedImage* image = &source;
+		if (source.mipLevels == 1)
+		{
+			chain = TextureDecoder::allocate(source.filename, source.format, source.width, source.height, source.channels, 1);
+			std::memcpy(chain.pixels.get(), source.pixels.get(), static_cast<size_t>(source.getSize()));
+			TextureDecoder::generateMipChain(chain);
+			image = &chain;
+		}
+
+		static const auto toLinear = []
+			{
+				std::array<uint8_t, 256> table{};
+				for (int i = 0; i < 256; ++i)
+				{
+					float c = i / 255.0f;
+					c = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+					table[i] = static_cast<uint8_t>(c * 255.0f + 0.5f);
+				}
+				return table;
+			}();
+		const bool linearize = compressedFormat == VK_FORMAT_BC4_UNORM_BLOCK && IsSrgb(image->format);
+
+		TextureDecoder::DecodedImage result = TextureDecoder::allocate(image->filename, compressedFormat, image->width, image->height,
+			image->channels, image->mipLevels, blockBytes);
+
+		const int channels = image->channels;
+		const uint8_t* level = image->pixels.get();
+		uint8_t* dst = result.pixels.get();
+		for (uint32_t mip = 0; mip < image->mipLevels; ++mip)
+		{
+			const int width = std::max(1, image->width >> mip);
+			const int height = std::max(1, image->height >> mip);
+
+			for (int by = 0; by < height; by += 4)
+			{
+				for (int bx = 0; bx < width; bx += 4)
+				{
+					// edge blocks repeat the last row/column
+					uint8_t texels[16][4];
+					for (int t = 0; t < 16; ++t)
+					{
+						const int x = std::min(bx + (t & 3), width - 1);
+						const int y = std::min(by + (t >> 2), height - 1);
+						const uint8_t* texel = level + (static_cast<size_t>(y) * width + x) * channels;
+						for (int c = 0; c < 4; ++c)
+						{
+							texels[t][c] = c < channels ? texel[c] : (c == 3 ? 255 : 0);
+						}
+					}
+
+					if (compressedFormat == VK_FORMAT_BC4_UNORM_BLOCK || compressedFormat == VK_FORMAT_BC5_UNORM_BLOCK)
+					{
+						const int channelCount = compressedFormat == VK_FORMAT_BC5_UNORM_BLOCK ? 2 : 1;
+						for (int c = 0; c < channelCount; ++c)
+						{
+							uint8_t values[16];
+							for (int t = 0; t < 16; ++t) values[t] = linearize ? toLinear[texels[t][c]] : texels[t][c];
+							EncodeBC4Block(values, dst + 8 * c);
+						}
+					}
+					else
+					{
+						EncodeBC7Block(texels, dst);
+					}
+					dst += blockBytes;
+				}
+			}
+			level += image->getLevelSize(mip);
+		}
+		return result;
+	}
+}
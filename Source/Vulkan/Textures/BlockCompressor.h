@@ -0,0 +1,27 @@
+#pragma once
+#include "TextureDecoder.h"
+
+//std
+#include <cstdint>
+
+namespace cve
+{
+	// CPU encoders for the 4x4 block compressed formats the asset cooker writes: BC7 for color (mode 6 only, one subset with
+	// 7.7.7.7 endpoints + p-bits and 4 bit indices), BC5 for tangent space normals (two BC4 blocks, z is rebuilt in the shader)
+	// and BC4 for single channel data. No Vulkan device needed, only the VkFormat enums.
+	class BlockCompressor final
+	{
+	public:
+		// 16 for BC7/BC5, 8 for BC4, 0 for formats this encoder does not produce
+		static uint32_t GetBlockBytes(VkFormat format);
+
+		// 16 RGBA texels in row order -> 16 byte BC7 block
+		static void EncodeBC7Block(const uint8_t texels[16][4], uint8_t out[16]);
+		// 16 values in row order -> 8 byte BC4 block
+		static void EncodeBC4Block(const uint8_t values[16], uint8_t out[8]);
+
+		// every mip level of an uncompressed image (a single level gets its chain generated first) into compressedFormat.
+		// BC5 takes red/green, BC4 takes red, converted to linear first when the source format is sRGB since BC4 has no sRGB variant
+		static TextureDecoder::DecodedImage Compress(const TextureDecoder::DecodedImage& image, VkFormat compressedFormat);
+	};
+}
@@ -0,0 +1,279 @@
+#include "Ktx2.h"
+#include "BlockCompressor.h"
+#include "MappedFile.h"
+#include "Utils.h"
+
+//std
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace cve
+{
+	namespace
+	{
+		constexpr uint8_t IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+		struct Header
+		{
+			uint8_t  identifier[12];
+			uint32_t vkFormat;
+			uint32_t typeSize;
+			uint32_t pixelWidth;
+			uint32_t pixelHeight;
+			uint32_t pixelDepth;
+			uint32_t layerCount;
+			uint32_t faceCount;
+			uint32_t levelCount;
+			uint32_t supercompressionScheme;
+			uint32_t dfdByteOffset;
+			uint32_t dfdByteLength;
+			uint32_t kvdByteOffset;
+			uint32_t kvdByteLength;
+			uint64_t sgdByteOffset;
+			uint64_t sgdByteLength;
+		};
+		static_assert(sizeof(Header) == 80, "KTX2 header is 80 bytes");
+
+		struct LevelIndex
+		{
+			uint64_t byteOffset;
+			uint64_t byteLength;
+			uint64_t uncompressedByteLength;
+		};
+
+		// key/value entry naming the source image, keys starting with KTX are reserved by the spec
+		constexpr char SOURCE_KEY[] = "cveSourceImage";
+
+		// size + mtime is the cheap check, the content hash only runs when the mtime differs (the image was copied or touched)
+		struct SourceStamp
+		{
+			uint64_t size;
+			int64_t  writeTime;
+			uint64_t contentHash;
+		};
+
+		SourceStamp DescribeSource(const std::string& sourcePath, bool hashContents)
+		{
+			SourceStamp stamp{};
+			std::error_code ec;
+			if (!std::filesystem::is_regular_file(sourcePath, ec)) return stamp;
+
+			stamp.size = std::filesystem::file_size(sourcePath);
+			stamp.writeTime = static_cast<int64_t>(std::filesystem::last_write_time(sourcePath).time_since_epoch().count());
+			if (hashContents)
+			{
+				MappedFile source{ sourcePath };
+				stamp.contentHash = source.IsValid() ? hashFNV1a(source.GetData(), source.GetSize()) : 0;
+			}
+			return stamp;
+		}
+
+		bool MatchesSource(const SourceStamp& cooked, const std::string& sourcePath)
+		{
+			const SourceStamp current = DescribeSource(sourcePath, false);
+			if (current.size == 0 || current.size != cooked.size) return false;
+			return current.writeTime == cooked.writeTime || DescribeSource(sourcePath, true).contentHash == cooked.contentHash;
+		}
+
+		// Khronos data format descriptor values for the formats we write
+		constexpr uint32_t KHR_DF_MODEL_BC4 = 131;
+		constexpr uint32_t KHR_DF_MODEL_BC5 = 132;
+		constexpr uint32_t KHR_DF_MODEL_BC7 = 134;
+		constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+		constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+		constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+
+		// basic descriptor block with one sample per BC4 channel or one for the whole BC7 block
+		std::vector<uint32_t> BuildDataFormatDescriptor(VkFormat format, uint32_t blockBytes)
+		{
+			uint32_t model = KHR_DF_MODEL_BC7;
+			uint32_t sampleCount = 1;
+			if (format == VK_FORMAT_BC4_UNORM_BLOCK) model = KHR_DF_MODEL_BC4;
+			if (format == VK_FORMAT_BC5_UNORM_BLOCK)
+			{
+				model = KHR_DF_MODEL_BC5;
+				sampleCount = 2;
+			}
+			const uint32_t transfer = format == VK_FORMAT_BC7_SRGB_BLOCK ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+			const uint32_t blockSize = 24 + 16 * sampleCount;
+
+			std::vector<uint32_t> words;
+			words.push_back(4 + blockSize);	//dfdTotalSize
+			words.push_back(0);	//vendor Khronos, descriptor type basic
+			words.push_back(2u | (blockSize << 16));	//version 1.3, block size
+			words.push_back(model | (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16));
+			words.push_back(3u | (3u << 8));	//4x4x1x1 texel block, stored minus one
+			words.push_back(blockBytes);	//bytesPlane0
+			words.push_back(0);
+
+			const uint32_t sampleBits = blockBytes * 8 / sampleCount;
+			for (uint32_t sample = 0; sample < sampleCount; ++sample)
+			{
+				words.push_back((sample * sampleBits) | ((sampleBits - 1) << 16) | (sample << 24));	//bit offset, length, channel id
+				words.push_back(0);	//sample position
+				words.push_back(0);	//lower
+				words.push_back(UINT32_MAX);	//upper
+			}
+			return words;
+		}
+	}
+
+	std::string Ktx2::GetPath(const std::string& imagePath, VkFormat compressedFormat)
+	{
+		const char* suffix = ".ktx2";
+		switch (compressedFormat)
+		{
+		case VK_FORMAT_BC7_SRGB_BLOCK:  suffix = ".bc7srgb.ktx2"; break;
+		case VK_FORMAT_BC7_UNORM_BLOCK: suffix = ".bc7.ktx2"; break;
+		case VK_FORMAT_BC5_UNORM_BLOCK: suffix = ".bc5.ktx2"; break;
+		case VK_FORMAT_BC4_UNORM_BLOCK: suffix = ".bc4.ktx2"; break;
+		default: break;
+		}
+		return std::filesystem::path{ imagePath }.replace_extension(suffix).string();
+	}
+
+	void Ktx2::Write(const std::string& filepath, const TextureDecoder::DecodedImage& image, const std::string& sourcePath)
+	{
+		if (image.blockBytes == 0 || !image.pixels)
+		{
+			throw std::runtime_error("KTX2 writer only takes block compressed images: " + filepath);
+		}
+
+		const auto dfd = BuildDataFormatDescriptor(image.format, image.blockBytes);
+
+		// one key/value entry: uint32 length of key + NUL + value, then padding to 4 bytes
+		const SourceStamp stamp = DescribeSource(sourcePath, true);
+		const uint32_t keyValueLength = static_cast<uint32_t>(sizeof(SOURCE_KEY) + sizeof(stamp));
+		std::vector<char> kvd(sizeof(uint32_t) + (keyValueLength + 3) / 4 * 4, 0);
+		std::memcpy(kvd.data(), &keyValueLength, sizeof(keyValueLength));
+		std::memcpy(kvd.data() + sizeof(uint32_t), SOURCE_KEY, sizeof(SOURCE_KEY));
+		std::memcpy(kvd.data() + sizeof(uint32_t) + sizeof(SOURCE_KEY), &stamp, sizeof(stamp));
+
+		Header header{};
+		std::memcpy(header.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+		header.vkFormat = static_cast<uint32_t>(image.format);
+		header.typeSize = 1;
+		header.pixelWidth = static_cast<uint32_t>(image.width);
+		header.pixelHeight = static_cast<uint32_t>(image.height);
+		header.faceCount = 1;
+		header.levelCount = image.mipLevels;
+		header.dfdByteOffset = static_cast<uint32_t>(sizeof(Header) + image.mipLevels * sizeof(LevelIndex));
+		header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+		header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+		header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+
+		// levels are aligned to the block size (a multiple of 4), smallest one first
+		std::vector<LevelIndex> levels(image.mipLevels);
+		std::vector<uint64_t> sourceOffsets(image.mipLevels);
+		uint64_t sourceOffset = 0;
+		for (uint32_t level = 0; level < image.mipLevels; ++level)
+		{
+			sourceOffsets[level] = sourceOffset;
+			sourceOffset += image.getLevelSize(level);
+		}
+		uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+		for (uint32_t level = image.mipLevels; level-- > 0;)
+		{
+			offset = (offset + image.blockBytes - 1) / image.blockBytes * image.blockBytes;
+			levels[level] = { offset, image.getLevelSize(level), image.getLevelSize(level) };
+			offset += image.getLevelSize(level);
+		}
+
+		const std::string tempPath = filepath + ".tmp";
+		{
+			std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!file.is_open())
+			{
+				throw std::runtime_error("Failed to open KTX2 file for writing: " + tempPath);
+			}
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(levels.data()), static_cast<std::streamsize>(levels.size() * sizeof(LevelIndex)));
+			file.write(reinterpret_cast<const char*>(dfd.data()), static_cast<std::streamsize>(dfd.size() * sizeof(uint32_t)));
+			file.write(kvd.data(), static_cast<std::streamsize>(kvd.size()));
+			for (uint32_t level = image.mipLevels; level-- > 0;)
+			{
+				static const char zeros[16]{};
+				file.write(zeros, static_cast<std::streamsize>(levels[level].byteOffset - static_cast<uint64_t>(file.tellp())));
+				file.write(reinterpret_cast<const char*>(image.pixels.get() + sourceOffsets[level]), static_cast<std::streamsize>(levels[level].byteLength));
+			}
+			if (!file.good())
+			{
+				throw std::runtime_error("Failed to write KTX2 file: " + tempPath);
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tempPath, filepath, ec);
+		if (ec)
+		{
+			throw std::runtime_error("Failed to finalize KTX2 file " + filepath + ": " + ec.message());
+		}
+	}
+
+	bool Ktx2::Read(const std::string& filepath, const std::string& sourcePath, TextureDecoder::DecodedImage& outImage)
+	{
+		if (!std::filesystem::exists(filepath)) return false;
+
+		MappedFile file{ filepath };
+		if (!file.IsValid() || file.GetSize() < sizeof(Header)) return false;
+
+		Header header{};
+		std::memcpy(&header, file.GetData(), sizeof(Header));
+		const VkFormat format = static_cast<VkFormat>(header.vkFormat);
+		const uint32_t blockBytes = BlockCompressor::GetBlockBytes(format);
+		if (std::memcmp(header.identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0 ||
+			blockBytes == 0 ||
+			header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1 ||
+			header.layerCount > 1 || header.faceCount != 1 ||
+			header.levelCount == 0 || header.supercompressionScheme != 0 ||
+			sizeof(Header) + header.levelCount * sizeof(LevelIndex) > file.GetSize() ||
+			static_cast<uint64_t>(header.kvdByteOffset) + header.kvdByteLength > file.GetSize())
+		{
+			return false;
+		}
+
+		// files without the source entry predate it and count as stale too
+		bool sourceMatches = false;
+		for (uint32_t offset = 0; offset + sizeof(uint32_t) <= header.kvdByteLength;)
+		{
+			const std::byte* entry = file.GetData() + header.kvdByteOffset + offset;
+			uint32_t keyValueLength = 0;
+			std::memcpy(&keyValueLength, entry, sizeof(keyValueLength));
+			if (keyValueLength > header.kvdByteLength - offset - sizeof(uint32_t)) break;
+
+			SourceStamp stamp{};
+			if (keyValueLength == sizeof(SOURCE_KEY) + sizeof(stamp) && std::memcmp(entry + sizeof(uint32_t), SOURCE_KEY, sizeof(SOURCE_KEY)) == 0)
+			{
+				std::memcpy(&stamp, entry + sizeof(uint32_t) + sizeof(SOURCE_KEY), sizeof(stamp));
+				sourceMatches = MatchesSource(stamp, sourcePath);
+				break;
+			}
+			offset += sizeof(uint32_t) + (keyValueLength + 3) / 4 * 4;
+		}
+		if (!sourceMatches) return false;
+
+		auto image = TextureDecoder::allocate(filepath, format, static_cast<int>(header.pixelWidth), static_cast<int>(header.pixelHeight),
+			4, header.levelCount, blockBytes);
+
+		// the decoded image keeps level 0 first
+		unsigned char* dst = image.pixels.get();
+		for (uint32_t level = 0; level < header.levelCount; ++level)
+		{
+			LevelIndex index{};
+			std::memcpy(&index, file.GetData() + sizeof(Header) + level * sizeof(LevelIndex), sizeof(LevelIndex));
+			if (index.byteLength != image.getLevelSize(level) || index.byteOffset + index.byteLength > file.GetSize())
+			{
+				return false;
+			}
+			std::memcpy(dst, file.GetData() + index.byteOffset, static_cast<size_t>(index.byteLength));
+			dst += index.byteLength;
+		}
+
+		outImage = std::move(image);
+		return true;
+	}
+}
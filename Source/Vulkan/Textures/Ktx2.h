@@ -0,0 +1,26 @@
+#pragma once
+#include "TextureDecoder.h"
+
+//std
+#include <string>
+
+namespace cve
+{
+	// Minimal KTX2 container for the block compressed textures the asset cooker writes: one 2D image, no array layers or faces,
+	// no supercompression, level 0 to levelCount - 1 in the level index and the data stored smallest level first as the spec requires.
+	class Ktx2 final
+	{
+	public:
+		// the KTX2 the cooker writes next to an image, one per compressed format so an image used in several roles
+		// (BC7 color in one material, BC4 occlusion in another) gets a file for each: albedo.png -> albedo.bc7srgb.ktx2
+		static std::string GetPath(const std::string& imagePath, VkFormat compressedFormat);
+
+		// image must be block compressed (DecodedImage::blockBytes != 0), sourcePath is the image it was compressed from,
+		// its size, mtime and content hash go into a key/value entry so Read can tell when the KTX2 is out of date
+		static void Write(const std::string& filepath, const TextureDecoder::DecodedImage& image, const std::string& sourcePath);
+
+		// false when the file is missing, malformed, holds a format BlockCompressor does not produce or was not
+		// compressed from the current version of sourcePath
+		static bool Read(const std::string& filepath, const std::string& sourcePath, TextureDecoder::DecodedImage& outImage);
+	};
+}
@@ -3,16 +3,20 @@
 #include <cstring>
 #include <algorithm>
 #include <cmath>
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-#include "Model.h" 
+#include <vector>
 namespace cve
 {
 
 	Texture::Texture(Device& device, const std::string& filename, VkFormat format)
         : m_Device(device)
     {
-        createTexture(filename, format);
+        createTexture(TextureDecoder::decode(filename, format));
+    }
+
+    Texture::Texture(Device& device, const DecodedImage& image)
+        : m_Device(device)
+    {
+        createTexture(image);
     }
 
     Texture::Texture(Device& device, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage,
@@ -75,171 +79,30 @@ namespace cve
     {
         if (m_Sampler != VK_NULL_HANDLE) vkDestroySampler(m_Device.device(), m_Sampler, nullptr);
         if (m_ImageView != VK_NULL_HANDLE) vkDestroyImageView(m_Device.device(), m_ImageView, nullptr);
-        if (m_Image != VK_NULL_HANDLE) vkDestroyImage(m_Device.device(), m_Image, nullptr);
-        if (m_DeviceMemory != VK_NULL_HANDLE) vkFreeMemory(m_Device.device(), m_DeviceMemory, nullptr);
-
-    }
-
-
-#pragma region DESCRIPTORS
-
-    VkDescriptorSetLayout Texture::s_BindlessSetLayout     = VK_NULL_HANDLE;
-    VkDescriptorPool      Texture::s_BindlessPool          = VK_NULL_HANDLE; 
-    VkDescriptorSet       Texture::s_BindlessDescriptorSet = VK_NULL_HANDLE;
-
-    void Texture::updateBindless(Device& device, void* rawData) 
-    {
-        auto& data = *static_cast<Model::Data*>(rawData);
-        // we have two textures per material
-        uint32_t N = uint32_t(data.textures.size());
-        std::vector<VkDescriptorImageInfo> infos(N);
-        std::vector<VkWriteDescriptorSet>  writes(N);
-
-        for (uint32_t i = 0; i < N; ++i) {
-            infos[i] = {
-                data.textures[i]->getSampler(),
-                data.textures[i]->getImageView(),
-                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-            };
-            writes[i] = {
-                VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                nullptr,
-                s_BindlessDescriptorSet,
-                /*dstBinding=*/0,
-                /*dstArrayElement=*/i,
-                /*descriptorCount=*/1,
-                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                &infos[i],
-                nullptr,
-                nullptr
-            };
-        }
-
-        vkUpdateDescriptorSets(
-            device.device(),
-            N, writes.data(),
-            0, nullptr
-        ); 
-    }
-
-    void Texture::initBindless(Device& device, uint32_t maxTextures)
-    {
-        if (s_BindlessPool != VK_NULL_HANDLE) return; 
-
-        // Single binding, variable count = maxTextures
-        VkDescriptorSetLayoutBinding binding{};
-        binding.binding = 0;
-        binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        binding.descriptorCount = maxTextures;
-        binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-        VkDescriptorBindingFlags flags =
-            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
-            VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT |
-            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
-
-        VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO };
-        flagsInfo.bindingCount = 1;
-        flagsInfo.pBindingFlags = &flags;
-
-        VkDescriptorSetLayoutCreateInfo layoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
-        layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
-        layoutInfo.bindingCount = 1;
-        layoutInfo.pBindings = &binding;
-        layoutInfo.pNext = &flagsInfo;
-        vkCreateDescriptorSetLayout(device.device(), &layoutInfo, nullptr, &s_BindlessSetLayout);
-
-        // Pool for exactly maxTextures descriptors
-        VkDescriptorPoolSize poolSize{};
-        poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSize.descriptorCount = maxTextures;
-
-        VkDescriptorPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
-        poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
-        poolInfo.poolSizeCount = 1;
-        poolInfo.pPoolSizes = &poolSize;
-        poolInfo.maxSets = 1;
-        vkCreateDescriptorPool(device.device(), &poolInfo, nullptr, &s_BindlessPool);
-
-        // Allocate one set, var-count = maxTextures
-        VkDescriptorSetVariableDescriptorCountAllocateInfo varInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO };
-        varInfo.descriptorSetCount = 1;
-        varInfo.pDescriptorCounts = &maxTextures;
-
-        VkDescriptorSetAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
-        allocInfo.descriptorPool = s_BindlessPool;
-        allocInfo.descriptorSetCount = 1;
-        allocInfo.pSetLayouts = &s_BindlessSetLayout;
-        allocInfo.pNext = &varInfo;
-        vkAllocateDescriptorSets(device.device(), &allocInfo, &s_BindlessDescriptorSet);
+        m_Device.destroyImage(m_Image, m_DeviceMemory);
 
     }
-    void Texture::cleanupBindless(Device& device)
-    {
-        
-        if (s_BindlessPool != VK_NULL_HANDLE)
-        {
-            vkDestroyDescriptorPool(device.device(), s_BindlessPool, nullptr);
-            s_BindlessPool = VK_NULL_HANDLE;
-        }
-        if (s_BindlessSetLayout != VK_NULL_HANDLE) {
-            vkDestroyDescriptorSetLayout(device.device(), s_BindlessSetLayout, nullptr);
-            s_BindlessSetLayout = VK_NULL_HANDLE;
-        }
-        s_BindlessDescriptorSet = VK_NULL_HANDLE;
-
-    }
-    void Texture::bind(VkCommandBuffer& commandBuffer, VkPipelineLayout& pipelineLayout) 
-    {
-        vkCmdBindDescriptorSets(
-            commandBuffer,
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipelineLayout,
-            0, 1,
-            &Texture::s_BindlessDescriptorSet,
-            0, nullptr
-        );
-    }
-#pragma endregion
 
 
 #pragma region TEXTURE
 
-    void Texture::createTexture(const std::string& filename, VkFormat format)
+    void Texture::createTexture(const DecodedImage& image)
     {
-        int desiredChannels = STBI_rgb_alpha;  // default = 4
-        if (format == VK_FORMAT_R8_UNORM)    desiredChannels = STBI_grey;
-        if (format == VK_FORMAT_R8G8_UNORM)  desiredChannels = STBI_grey_alpha;
-        if (format == VK_FORMAT_R8G8B8_UNORM)desiredChannels = STBI_rgb;
-
-        // 1. Load m_Image pixels with stb_image
-        int texWidth, texHeight, texChannels;
-        stbi_uc* pixels = stbi_load(filename.c_str(), &texWidth, &texHeight, &texChannels, desiredChannels);
-        if (!pixels) {
-            throw std::runtime_error("Failed to load texture m_Image: " + filename);
-        }
-
-        VkDeviceSize imageSize = static_cast<VkDeviceSize>(texWidth) * texHeight * 4;
-        m_MipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
-
-        // 2. Create staging buffer and copy pixel data
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        m_Device.createBuffer(
-            imageSize,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            stagingBuffer,
-            stagingBufferMemory);
+        const VkFormat format = image.format;
+        const int texWidth = image.width;
+        const int texHeight = image.height;
 
-        void* data;
-        vkMapMemory(m_Device.device(), stagingBufferMemory, 0, imageSize, 0, &data);
-        std::memcpy(data, pixels, static_cast<size_t>(imageSize));
-        vkUnmapMemory(m_Device.device(), stagingBufferMemory);
+        // 1. Pixels were decoded up front by decode(), cooked images already carry their mip chain. Block compressed images
+        //    cannot be blitted, so they are always uploaded as they are
+        const bool hasMipChain = image.mipLevels > 1 || image.blockBytes != 0;
+        m_Compressed = image.blockBytes != 0;
+        VkDeviceSize imageSize = image.getSize();
+        m_MipLevels = hasMipChain ? image.mipLevels : static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
-        stbi_image_free(pixels);
+        // transition, copy and mip generation go out in one submit (or in the caller's batch)
+        m_Device.beginUploadBatch();
 
-        // 3. Create optimal-tiled VkImage
+        // 2. Create optimal-tiled VkImage
         createImage(
             static_cast<uint32_t>(texWidth),
             static_cast<uint32_t>(texHeight),
@@ -250,7 +113,9 @@ namespace cve
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
         );
 
-        // 4. Transition m_Image to DST for copy
+        m_MemorySize = m_DeviceMemory.size;
+
+        // 3. Transition m_Image to DST for copy
         transitionImageLayout(
             m_Image,
             format,
@@ -259,25 +124,68 @@ namespace cve
             m_MipLevels
         );
 
-        // 5. Copy buffer to m_Image
-        m_Device.copyBufferToImage(
-            stagingBuffer,
-            m_Image,
-            static_cast<uint32_t>(texWidth),
-            static_cast<uint32_t>(texHeight),
-            1
-        );
+        // 4. Copy the pixels into the staging ring, right before the submit that reads them
+        const StagingRing::Region staging = m_Device.stagingRing().allocate(imageSize);
+        std::memcpy(staging.mapped, image.pixels.get(), static_cast<size_t>(imageSize));
 
-        // 6. Generate mipmaps on GPU
-        generateMipmaps(
-            m_Image,
-            texWidth, texHeight,
-            m_MipLevels
-        );
+        if (hasMipChain)
+        {
+            // 5. Copy every level in one submit, no blits needed
+            std::vector<VkBufferImageCopy> regions(m_MipLevels);
+            VkDeviceSize offset = staging.offset;
+            for (uint32_t level = 0; level < m_MipLevels; ++level)
+            {
+                regions[level].bufferOffset = offset;
+                regions[level].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+                regions[level].imageExtent = {
+                    static_cast<uint32_t>(std::max(1, texWidth >> level)),
+                    static_cast<uint32_t>(std::max(1, texHeight >> level)),
+                    1 };
+                offset += image.getLevelSize(level);
+            }
 
-        // Cleanup staging resources
-        vkDestroyBuffer(m_Device.device(), stagingBuffer, nullptr);
-        vkFreeMemory(m_Device.device(), stagingBufferMemory, nullptr);
+            VkCommandBuffer cmd = m_Device.beginTransferCommands();
+            vkCmdCopyBufferToImage(cmd, staging.buffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                static_cast<uint32_t>(regions.size()), regions.data());
+            m_Device.endTransferCommands(cmd);
+
+            // 6. All levels straight to SHADER_READ_ONLY, handing the image to the graphics queue on the way
+            transitionImageLayout(
+                m_Image,
+                format,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                m_MipLevels
+            );
+        }
+        else
+        {
+            // 5. Copy buffer to m_Image
+            m_Device.copyBufferToImage(
+                staging.buffer,
+                m_Image,
+                static_cast<uint32_t>(texWidth),
+                static_cast<uint32_t>(texHeight),
+                1,
+                staging.offset
+            );
+
+            // 6. Blits need the graphics queue, hand the image over and generate mipmaps there
+            transitionImageLayout(
+                m_Image,
+                format,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                m_MipLevels
+            );
+            generateMipmaps(
+                m_Image,
+                texWidth, texHeight,
+                m_MipLevels
+            );
+        }
+
+        m_UploadToken = m_Device.endUploadBatch();
 
         // 7. Create m_Image view and m_Sampler
         createImageView(format, VK_IMAGE_ASPECT_COLOR_BIT, m_MipLevels);
@@ -367,8 +275,6 @@ namespace cve
         VkImageLayout newLayout,
         uint32_t mipLevels)
     {
-        VkCommandBuffer cmd = m_Device.beginSingleTimeCommands();
-
         VkImageMemoryBarrier2 barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
         barrier.oldLayout = oldLayout;
@@ -399,6 +305,14 @@ namespace cve
             srcStage = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
             dstStage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
         }
+        else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
+            newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+            // no transition, only the queue changes before the mip blits
+            barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+            srcStage = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+            dstStage = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        }
         else {
             throw std::invalid_argument("Unsupported layout transition!");
         }
@@ -406,14 +320,22 @@ namespace cve
         barrier.srcStageMask = srcStage;
         barrier.dstStageMask = dstStage;
 
-        VkDependencyInfo depInfo{};
-        depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
-        depInfo.imageMemoryBarrierCount = 1;
-        depInfo.pImageMemoryBarriers = &barrier;
-
-        vkCmdPipelineBarrier2(cmd, &depInfo);
+        if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+        {
+            // recorded with the copy, on the transfer queue when there is one
+            VkDependencyInfo depInfo{};
+            depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            depInfo.imageMemoryBarrierCount = 1;
+            depInfo.pImageMemoryBarriers = &barrier;
 
-        m_Device.endSingleTimeCommands(cmd);
+            VkCommandBuffer cmd = m_Device.beginTransferCommands();
+            vkCmdPipelineBarrier2(cmd, &depInfo);
+            m_Device.endTransferCommands(cmd);
+        }
+        else
+        {
+            m_Device.transferOwnership(barrier);
+        }
     }
 
     void Texture::generateMipmaps(
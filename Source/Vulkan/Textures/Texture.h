@@ -1,7 +1,9 @@
 #pragma once
+#include <algorithm>
 #include <memory>
 
 #include "Device.h"
+#include "TextureDecoder.h"
 #include <string>
 #include <vulkan/vulkan.h>
 
@@ -11,7 +13,11 @@ namespace cve
 	class Texture final
 	{
     public:
+        // decoded pixels live in TextureDecoder so the asset cooker can build without Vulkan or a window
+        using DecodedImage = TextureDecoder::DecodedImage;
+
         Texture(Device& device, const std::string& filename, VkFormat format);
+        Texture(Device& device, const DecodedImage& image);
 
         //ctor for render target / G buffer attachments
         Texture(Device& device,
@@ -29,32 +35,31 @@ namespace cve
         Texture(const Texture&) = delete;
         Texture& operator=(const Texture&) = delete;
 
-        static void bind(VkCommandBuffer& commandBuffer, VkPipelineLayout& pipelineLayout);
-
-        static void initBindless(Device& device, uint32_t maxTextures);
-        static void cleanupBindless(Device& device); 
-        static void updateBindless(Device& device, void* rawData);  
-    	static VkDescriptorSetLayout   s_BindlessSetLayout;
-        static VkDescriptorPool        s_BindlessPool;
-        static VkDescriptorSet         s_BindlessDescriptorSet;
         // Accessors
         VkImageView getImageView() const { return m_ImageView; }
         VkImage getImage() const { return m_Image;  }
         VkSampler   getSampler()   const { return m_Sampler; }
         uint32_t    getMipLevels() const { return m_MipLevels; }
+        VkDeviceSize getMemorySize() const { return m_MemorySize; }
+        bool        isCompressed() const { return m_Compressed; }
+        // the upload submit of a loaded texture, see Device::isUploadComplete
+        UploadToken getUploadToken() const { return m_UploadToken; }
 
 
     private:
         Device&        m_Device;
         VkImage        m_Image = VK_NULL_HANDLE;
-        VkDeviceMemory m_DeviceMemory = VK_NULL_HANDLE;
+        MemoryAllocation m_DeviceMemory{};
         VkImageView    m_ImageView = VK_NULL_HANDLE;
         VkSampler      m_Sampler = VK_NULL_HANDLE;
         uint32_t       m_MipLevels = 1;
+        VkDeviceSize   m_MemorySize = 0;
+        bool           m_Compressed = false;
+        UploadToken    m_UploadToken = 0;
 
 
 
-    	void createTexture(const std::string& filename, VkFormat format);
+    	void createTexture(const DecodedImage& image);
 
         void createImage(
             uint32_t width,
@@ -0,0 +1,154 @@
+#include "TextureDecoder.h"
+#include "Ktx2.h"
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <array>
+#include <filesystem>
+#include <iostream>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+namespace cve
+{
+
+    bool TextureDecoder::s_UseCompressedTextures = true;
+
+    void TextureDecoder::DecodedImage::PixelDeleter::operator()(unsigned char* pixels) const
+    {
+        stbi_image_free(pixels);
+    }
+
+    TextureDecoder::DecodedImage TextureDecoder::decode(const std::string& filename, VkFormat format)
+    {
+        int desiredChannels = STBI_rgb_alpha;  // default = 4
+        if (format == VK_FORMAT_R8_UNORM)    desiredChannels = STBI_grey;
+        if (format == VK_FORMAT_R8G8_UNORM)  desiredChannels = STBI_grey_alpha;
+        if (format == VK_FORMAT_R8G8B8_UNORM)desiredChannels = STBI_rgb;
+
+        // stb_image keeps no global state while decoding, so this is safe to call from several threads at once
+        DecodedImage image{};
+        image.filename = filename;
+        image.format = format;
+        image.channels = desiredChannels;
+
+        int texChannels;
+        image.pixels.reset(stbi_load(filename.c_str(), &image.width, &image.height, &texChannels, desiredChannels));
+        if (!image.pixels) {
+            throw std::runtime_error("Failed to load texture m_Image: " + filename);
+        }
+        return image;
+    }
+
+    TextureDecoder::DecodedImage TextureDecoder::load(const std::string& filename, VkFormat format, VkFormat compressedFormat)
+    {
+        if (s_UseCompressedTextures && compressedFormat != VK_FORMAT_UNDEFINED)
+        {
+            DecodedImage image{};
+            const std::string ktxPath = Ktx2::GetPath(filename, compressedFormat);
+            if (Ktx2::Read(ktxPath, filename, image) && image.format == compressedFormat)
+            {
+                image.filename = filename;
+                return image;
+            }
+            if (std::filesystem::exists(ktxPath))
+            {
+                std::cout << "[Texture] " << ktxPath << " is out of date or unreadable, decoding the source image (rerun the asset cooker)" << std::endl;
+            }
+        }
+        return decode(filename, format);
+    }
+
+    TextureDecoder::DecodedImage TextureDecoder::allocate(const std::string& filename, VkFormat format, int width, int height, int channels, uint32_t mipLevels, uint32_t blockBytes)
+    {
+        DecodedImage image{};
+        image.filename = filename;
+        image.format = format;
+        image.width = width;
+        image.height = height;
+        image.channels = channels;
+        image.mipLevels = mipLevels;
+        image.blockBytes = blockBytes;
+
+        // STBI_MALLOC so the PixelDeleter (stbi_image_free) can release it like a decoded image
+        image.pixels.reset(static_cast<unsigned char*>(STBI_MALLOC(static_cast<size_t>(image.getSize()))));
+        if (!image.pixels) {
+            throw std::runtime_error("Failed to allocate texture pixels: " + filename);
+        }
+        return image;
+    }
+
+    void TextureDecoder::generateMipChain(DecodedImage& image)
+    {
+        const uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(image.width, image.height)))) + 1;
+        if (image.mipLevels != 1 || image.blockBytes != 0 || mipLevels == 1) return;
+
+        const bool srgb = image.format == VK_FORMAT_R8_SRGB || image.format == VK_FORMAT_R8G8_SRGB ||
+            image.format == VK_FORMAT_R8G8B8_SRGB || image.format == VK_FORMAT_R8G8B8A8_SRGB;
+        const int channels = image.channels;
+        const int colorChannels = channels == 4 || channels == 2 ? channels - 1 : channels;
+
+        static const auto toLinear = []
+            {
+                std::array<float, 256> table{};
+                for (int i = 0; i < 256; ++i)
+                {
+                    float c = i / 255.0f;
+                    table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                }
+                return table;
+            }();
+        auto toSrgb = [](float c)
+            {
+                c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+                return static_cast<unsigned char>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+            };
+
+        DecodedImage chain = allocate(image.filename, image.format, image.width, image.height, channels, mipLevels);
+        unsigned char* pixels = chain.pixels.get();
+        std::memcpy(pixels, image.pixels.get(), static_cast<size_t>(image.getLevelSize(0)));
+
+        const unsigned char* src = pixels;
+        unsigned char* dst = pixels + image.getLevelSize(0);
+        for (uint32_t level = 1; level < mipLevels; ++level)
+        {
+            const int srcW = std::max(1, image.width >> (level - 1));
+            const int srcH = std::max(1, image.height >> (level - 1));
+            const int dstW = std::max(1, image.width >> level);
+            const int dstH = std::max(1, image.height >> level);
+
+            for (int y = 0; y < dstH; ++y)
+            {
+                const int y0 = std::min(2 * y, srcH - 1);
+                const int y1 = std::min(2 * y + 1, srcH - 1);
+                for (int x = 0; x < dstW; ++x)
+                {
+                    const int x0 = std::min(2 * x, srcW - 1);
+                    const int x1 = std::min(2 * x + 1, srcW - 1);
+                    const unsigned char* texels[4] = {
+                        src + (static_cast<size_t>(y0) * srcW + x0) * channels, src + (static_cast<size_t>(y0) * srcW + x1) * channels,
+                        src + (static_cast<size_t>(y1) * srcW + x0) * channels, src + (static_cast<size_t>(y1) * srcW + x1) * channels };
+
+                    unsigned char* out = dst + (static_cast<size_t>(y) * dstW + x) * channels;
+                    for (int c = 0; c < channels; ++c)
+                    {
+                        if (srgb && c < colorChannels)
+                        {
+                            float sum = toLinear[texels[0][c]] + toLinear[texels[1][c]] + toLinear[texels[2][c]] + toLinear[texels[3][c]];
+                            out[c] = toSrgb(sum * 0.25f);
+                        }
+                        else
+                        {
+                            out[c] = static_cast<unsigned char>((texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2) / 4);
+                        }
+                    }
+                }
+            }
+
+            src = dst;
+            dst += chain.getLevelSize(level);
+        }
+
+        image = std::move(chain);
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vulkan/vulkan.h>
+
+
+namespace cve
+{
+    // CPU half of the textures: image decoding, mip chains and the cooked KTX2 lookup. Only needs the VkFormat enums,
+    // never a device, so the asset cooker links it without the Vulkan loader or GLFW
+	class TextureDecoder final
+	{
+    public:
+        // result of decoding an image file, can be produced on worker threads
+        struct DecodedImage
+        {
+            struct PixelDeleter { void operator()(unsigned char* pixels) const; };
+
+            std::string filename;
+            VkFormat    format = VK_FORMAT_UNDEFINED;
+            int         width = 0;
+            int         height = 0;
+            int         channels = 0;
+            uint32_t    mipLevels = 1;  // levels stored back to back in pixels, 1 = the chain is generated on the GPU at upload
+            uint32_t    blockBytes = 0; // bytes per 4x4 block for block compressed formats, 0 = channels bytes per texel
+            std::unique_ptr<unsigned char, PixelDeleter> pixels;
+
+            VkDeviceSize getLevelSize(uint32_t level) const
+            {
+                const int levelWidth = std::max(1, width >> level);
+                const int levelHeight = std::max(1, height >> level);
+                if (blockBytes != 0)
+                {
+                    return static_cast<VkDeviceSize>((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockBytes;
+                }
+                return static_cast<VkDeviceSize>(levelWidth) * levelHeight * channels;
+            }
+            VkDeviceSize getSize() const
+            {
+                VkDeviceSize size = 0;
+                for (uint32_t level = 0; level < mipLevels; ++level) size += getLevelSize(level);
+                return size;
+            }
+        };
+
+        static DecodedImage decode(const std::string& filename, VkFormat format);
+
+        // the cooked KTX2 next to filename when it holds compressedFormat and s_UseCompressedTextures is set, decode() otherwise
+        static DecodedImage load(const std::string& filename, VkFormat format, VkFormat compressedFormat);
+        static bool s_UseCompressedTextures;
+
+        // uninitialized pixels for mipLevels levels, freed by the same deleter as decoded images
+        static DecodedImage allocate(const std::string& filename, VkFormat format, int width, int height, int channels, uint32_t mipLevels, uint32_t blockBytes = 0);
+
+        // appends the full mip chain to a single level image with a box filter (in linear space for sRGB formats), used by the asset cooker
+        static void generateMipChain(DecodedImage& image);
+    };
+
+}
@@ -0,0 +1,215 @@
+#include "TextureRegistry.h"
+#include "Utils.h"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <stdexcept>
+
+namespace cve
+{
+	VkDescriptorSetLayout TextureRegistry::s_SetLayout     = VK_NULL_HANDLE;
+	VkDescriptorPool      TextureRegistry::s_Pool          = VK_NULL_HANDLE;
+	VkDescriptorSet       TextureRegistry::s_DescriptorSet = VK_NULL_HANDLE;
+	uint32_t              TextureRegistry::s_Capacity      = 0;
+
+	std::vector<TextureRegistry::Slot>     TextureRegistry::s_Slots;
+	std::vector<uint32_t>                  TextureRegistry::s_FreeSlots;
+	std::unordered_map<uint64_t, uint32_t> TextureRegistry::s_SlotsByKey;
+	TextureRegistry::Stats                 TextureRegistry::s_Stats;
+
+	void TextureRegistry::Init(Device& device)
+	{
+		if (s_Pool != VK_NULL_HANDLE) return;
+
+		VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES };
+		VkPhysicalDeviceProperties2 properties2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+		properties2.pNext = &indexingProperties;
+		vkGetPhysicalDeviceProperties2(device.getPhysicalDevice(), &properties2);
+		s_Capacity = std::min({ MAX_TEXTURES,
+			indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+			indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+			indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages });
+
+		// single binding sized for the whole table, only the slots in use are ever written
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		binding.descriptorCount = s_Capacity;
+		binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		VkDescriptorBindingFlags flags =
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT |
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO };
+		flagsInfo.bindingCount = 1;
+		flagsInfo.pBindingFlags = &flags;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+		layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+		layoutInfo.pNext = &flagsInfo;
+		if (vkCreateDescriptorSetLayout(device.device(), &layoutInfo, nullptr, &s_SetLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create bindless texture set layout!");
+		}
+
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSize.descriptorCount = s_Capacity;
+
+		VkDescriptorPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		poolInfo.maxSets = 1;
+		if (vkCreateDescriptorPool(device.device(), &poolInfo, nullptr, &s_Pool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create bindless texture pool!");
+		}
+
+		VkDescriptorSetVariableDescriptorCountAllocateInfo varInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO };
+		varInfo.descriptorSetCount = 1;
+		varInfo.pDescriptorCounts = &s_Capacity;
+
+		VkDescriptorSetAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+		allocInfo.descriptorPool = s_Pool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &s_SetLayout;
+		allocInfo.pNext = &varInfo;
+		if (vkAllocateDescriptorSets(device.device(), &allocInfo, &s_DescriptorSet) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate bindless texture set!");
+		}
+
+		s_Slots.reserve(s_Capacity);
+		s_Stats = {};
+		s_Stats.capacity = s_Capacity;
+	}
+
+	void TextureRegistry::Cleanup(Device& device)
+	{
+		// anything still referenced at this point is destroyed with the table
+		s_SlotsByKey.clear();
+		s_FreeSlots.clear();
+		s_Slots.clear();
+
+		if (s_Pool != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorPool(device.device(), s_Pool, nullptr);
+			s_Pool = VK_NULL_HANDLE;
+		}
+		if (s_SetLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorSetLayout(device.device(), s_SetLayout, nullptr);
+			s_SetLayout = VK_NULL_HANDLE;
+		}
+		s_DescriptorSet = VK_NULL_HANDLE;
+		s_Capacity = 0;
+		s_Stats = {};
+	}
+
+	uint32_t TextureRegistry::Acquire(Device& device, const Texture::DecodedImage& image)
+	{
+		assert(s_Pool != VK_NULL_HANDLE && "TextureRegistry::Init was not called");
+
+		++s_Stats.acquireCount;
+		const uint64_t key = MakeKey(image);
+		if (auto it = s_SlotsByKey.find(key); it != s_SlotsByKey.end())
+		{
+			++s_Slots[it->second].refCount;
+			++s_Stats.sharedCount;
+			return it->second;
+		}
+
+		uint32_t slot = INVALID_SLOT;
+		if (!s_FreeSlots.empty())
+		{
+			slot = s_FreeSlots.back();
+			s_FreeSlots.pop_back();
+		}
+		else if (s_Slots.size() < s_Capacity)
+		{
+			slot = static_cast<uint32_t>(s_Slots.size());
+			s_Slots.emplace_back();
+		}
+		else
+		{
+			throw std::runtime_error("bindless texture table is full (" + std::to_string(s_Capacity) + " textures), can't add " + image.filename);
+		}
+
+		auto& entry = s_Slots[slot];
+		entry.texture = std::make_unique<Texture>(device, image);
+		entry.key = key;
+		entry.refCount = 1;
+		s_SlotsByKey.emplace(key, slot);
+		WriteDescriptor(device, slot);
+
+		++s_Stats.textureCount;
+		s_Stats.memorySize += entry.texture->getMemorySize();
+		return slot;
+	}
+
+	void TextureRegistry::Release(uint32_t slot)
+	{
+		// releases after Cleanup (models outliving the table at shutdown) have nothing left to free
+		if (slot >= s_Slots.size() || s_Slots[slot].refCount == 0) return;
+
+		auto& entry = s_Slots[slot];
+		if (--entry.refCount > 0) return;
+
+		// the descriptor keeps pointing at the destroyed view, that is fine with partially bound as long as no draw samples it
+		--s_Stats.textureCount;
+		s_Stats.memorySize -= entry.texture->getMemorySize();
+		s_SlotsByKey.erase(entry.key);
+		entry.texture.reset();
+		entry.key = 0;
+		s_FreeSlots.push_back(slot);
+	}
+
+	const Texture* TextureRegistry::Get(uint32_t slot)
+	{
+		return slot < s_Slots.size() ? s_Slots[slot].texture.get() : nullptr;
+	}
+
+	void TextureRegistry::Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout)
+	{
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			pipelineLayout,
+			0, 1,
+			&s_DescriptorSet,
+			0, nullptr
+		);
+	}
+
+	uint64_t TextureRegistry::MakeKey(const Texture::DecodedImage& image)
+	{
+		// the same file sampled in two formats (e.g. sRGB albedo and linear data) are two textures
+		uint64_t key = image.filename.empty()
+			? hashFNV1a(image.pixels.get(), static_cast<std::size_t>(image.getSize()))
+			: hashFNV1a(std::filesystem::path{ image.filename }.lexically_normal().generic_string());
+		return hashFNV1a(&image.format, sizeof(image.format), key);
+	}
+
+	void TextureRegistry::WriteDescriptor(Device& device, uint32_t slot)
+	{
+		const auto& texture = *s_Slots[slot].texture;
+		VkDescriptorImageInfo info{ texture.getSampler(), texture.getImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+		VkWriteDescriptorSet write{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+		write.dstSet = s_DescriptorSet;
+		write.dstBinding = 0;
+		write.dstArrayElement = slot;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pImageInfo = &info;
+		vkUpdateDescriptorSets(device.device(), 1, &write, 0, nullptr);
+	}
+}
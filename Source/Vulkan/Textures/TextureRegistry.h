@@ -0,0 +1,68 @@
+#pragma once
+#include "Device.h"
+#include "Texture.h"
+
+//std
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace cve
+{
+	// Process wide owner of the sampled material textures and the one bindless descriptor array (set 0, binding 0) they live in.
+	// Every texture gets a slot in that array, the slot is the index the shaders sample with. Textures are shared between models:
+	// acquiring an image with the same path and format (or the same pixels when it has no path) returns the existing slot and
+	// only bumps its refcount, the last release destroys the texture and puts the slot back on the free list.
+	// Render thread only. Init before the first pipeline layout is created, Cleanup once the device is idle.
+	class TextureRegistry final
+	{
+	public:
+		static constexpr uint32_t MAX_TEXTURES = 4096;	//clamped to the device's update after bind sampler limit
+		static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+
+		struct Stats
+		{
+			uint32_t     textureCount = 0;	//live textures, one per used slot
+			uint32_t     capacity = 0;
+			uint64_t     acquireCount = 0;
+			uint64_t     sharedCount = 0;	//acquires served by an already uploaded texture
+			VkDeviceSize memorySize = 0;
+		};
+
+		static void Init(Device& device);
+		static void Cleanup(Device& device);
+
+		// uploads the image unless an identical one is registered already, either way its refcount goes up by one
+		static uint32_t Acquire(Device& device, const Texture::DecodedImage& image);
+		// the texture is destroyed with its last reference, the GPU must not be using it anymore
+		static void Release(uint32_t slot);
+
+		static const Texture* Get(uint32_t slot);
+		static const Stats& GetStats() { return s_Stats; }
+
+		static VkDescriptorSetLayout GetSetLayout() { return s_SetLayout; }
+		static void Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout);
+
+	private:
+		struct Slot
+		{
+			std::unique_ptr<Texture> texture;
+			uint64_t                 key = 0;
+			uint32_t                 refCount = 0;
+		};
+
+		static uint64_t MakeKey(const Texture::DecodedImage& image);
+		static void WriteDescriptor(Device& device, uint32_t slot);
+
+		static VkDescriptorSetLayout s_SetLayout;
+		static VkDescriptorPool      s_Pool;
+		static VkDescriptorSet       s_DescriptorSet;
+		static uint32_t              s_Capacity;
+
+		static std::vector<Slot>                      s_Slots;
+		static std::vector<uint32_t>                  s_FreeSlots;
+		static std::unordered_map<uint64_t, uint32_t> s_SlotsByKey;
+		static Stats                                  s_Stats;
+	};
+}
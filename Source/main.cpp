@@ -3,15 +3,162 @@
 #include <stdexcept>
 #include <cstdlib>
 #include <filesystem>
+#include <cstring>
 
 #include "Application.h"
+#include "MeshCache.h"
+#include "AssetPackage.h"
 
-int main() 
+int main(int argc, char* argv[]) 
 {
 
 
 	try 
 	{
+		if (argc > 1 && std::strcmp(argv[1], "--benchmark-mesh-cache") == 0)
+		{
+			cve::MeshCache::RunStartupBenchmark({
+				"Resources/ABeautifulGame/glTF/ABeautifulGame.gltf",
+				"Resources/MetalRoughSpheres/glTF/MetalRoughSpheres.gltf",
+				"Resources/Sponza/glTF/Sponza.gltf"
+			});
+			return EXIT_SUCCESS;
+		}
+		if (argc > 1 && std::strcmp(argv[1], "--benchmark-texture-decode") == 0)
+		{
+			cve::Model::RunTextureDecodeBenchmark({
+				"Resources/ABeautifulGame/glTF/ABeautifulGame.gltf",
+				"Resources/MetalRoughSpheres/glTF/MetalRoughSpheres.gltf",
+				"Resources/Sponza/glTF/Sponza.gltf"
+			});
+			return EXIT_SUCCESS;
+		}
+
+		if (argc > 1 && std::strcmp(argv[1], "--benchmark-instancing") == 0)
+		{
+			cve::Model::RunInstancingBenchmark({
+				"Resources/ABeautifulGame/glTF/ABeautifulGame.gltf",
+				"Resources/Sponza/glTF/Sponza.gltf"
+			});
+			return EXIT_SUCCESS;
+		}
+
+		if (argc > 1 && std::strcmp(argv[1], "--benchmark-vertex-layout") == 0)
+		{
+			cve::Application::RunVertexLayoutBenchmark("Resources/Sponza/glTF/Sponza.gltf", 1000);
+			return EXIT_SUCCESS;
+		}
+
+		if (argc > 1 && std::strcmp(argv[1], "--benchmark-lod") == 0)
+		{
+			cve::Application::RunLodBenchmark("Resources/Sponza/glTF/Sponza.gltf", 1000);
+			return EXIT_SUCCESS;
+		}
+
+		if (argc > 1 && std::strcmp(argv[1], "--benchmark-texture-compression") == 0)
+		{
+			cve::Application::RunTextureCompressionBenchmark("Resources/Sponza/glTF/Sponza.gltf", 1000);
+			return EXIT_SUCCESS;
+		}
+
+		if (argc > 1 && std::strcmp(argv[1], "--benchmark-upload") == 0)
+		{
+			cve::Application::RunUploadBenchmark();
+			return EXIT_SUCCESS;
+		}
+
+		if (argc > 1 && std::strcmp(argv[1], "--benchmark-model-upload") == 0)
+		{
+			cve::Application::RunModelUploadBenchmark("Resources/Sponza/glTF/Sponza.gltf");
+			return EXIT_SUCCESS;
+		}
+
+		if (argc > 1 && std::strcmp(argv[1], "--benchmark-streaming") == 0)
+		{
+			cve::Application::RunStreamingBenchmark("Resources/Sponza/glTF/Sponza.gltf", "Resources/ABeautifulGame/glTF/ABeautifulGame.gltf", 3000);
+			return EXIT_SUCCESS;
+		}
+
+		if (argc > 1 && std::strcmp(argv[1], "--benchmark-geometry-arena") == 0)
+		{
+			cve::Application::RunGeometryArenaBenchmark({
+				"Resources/Sponza/glTF/Sponza.gltf",
+				"Resources/ABeautifulGame/glTF/ABeautifulGame.gltf",
+				"Resources/MetalRoughSpheres/glTF/MetalRoughSpheres.gltf"
+			}, 1000);
+			return EXIT_SUCCESS;
+		}
+
+		if (argc > 1 && std::strcmp(argv[1], "--benchmark-pipeline-cache") == 0)
+		{
+			cve::Application::RunPipelineCacheBenchmark("Resources/Sponza/glTF/Sponza.gltf");
+			return EXIT_SUCCESS;
+		}
+
+		if (argc > 1 && std::strcmp(argv[1], "--benchmark-lighting-variants") == 0)
+		{
+			cve::Application::RunLightingVariantBenchmark("Resources/Sponza/glTF/Sponza.gltf", 1000);
+			return EXIT_SUCCESS;
+		}
+
+		if (argc > 1 && std::strcmp(argv[1], "--report-attachment-memory") == 0)
+		{
+			cve::Application::RunAttachmentMemoryReport();
+			return EXIT_SUCCESS;
+		}
+
+		for (int i = 1; i < argc; ++i)
+		{
+			if (std::strcmp(argv[i], "--vertex-layout") == 0 && i + 1 < argc)
+			{
+				cve::Model::s_VertexLayout = std::strcmp(argv[i + 1], "full") == 0 ? cve::Model::VertexLayout::Full : cve::Model::VertexLayout::Compact;
+			}
+			else if (std::strcmp(argv[i], "--no-optimize-indices") == 0)
+			{
+				cve::Model::s_ImportOptions.optimizeIndices = false;
+			}
+			else if (std::strcmp(argv[i], "--sync-load") == 0)
+			{
+				cve::Application::s_StreamAssets = false;
+			}
+			else if (std::strcmp(argv[i], "--flatten") == 0)
+			{
+				cve::Model::s_ImportOptions.keepHierarchy = false;
+			}
+			else if (std::strcmp(argv[i], "--no-weld") == 0)
+			{
+				cve::Model::s_ImportOptions.weldVertices = false;
+			}
+			else if (std::strcmp(argv[i], "--no-lods") == 0)
+			{
+				cve::Model::s_ImportOptions.generateLods = false;
+			}
+			else if (std::strcmp(argv[i], "--no-packages") == 0)
+			{
+				cve::AssetPackage::s_LoadPackages = false;
+			}
+			else if (std::strcmp(argv[i], "--no-texture-compression") == 0)
+			{
+				cve::TextureDecoder::s_UseCompressedTextures = false;
+			}
+			else if (std::strcmp(argv[i], "--no-upload-batching") == 0)
+			{
+				cve::Device::s_BatchUploads = false;
+			}
+			else if (std::strcmp(argv[i], "--no-transfer-queue") == 0)
+			{
+				cve::Device::s_UseTransferQueue = false;
+			}
+			else if (std::strcmp(argv[i], "--no-pipeline-cache") == 0)
+			{
+				cve::Device::s_PipelineCachePath.clear();
+			}
+			else if (std::strcmp(argv[i], "--trace-frames") == 0 && i + 1 < argc)
+			{
+				cve::Application::s_FrameTracePath = argv[i + 1];
+			}
+		}
+
 		cve::Application app;
 		app.run();
 	}